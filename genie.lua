@@ -13,12 +13,17 @@ local project_list = {
 	"AG08_03",
 	"AG08_04",
 	"AG08_05",
+	"AG08_06",
 	"AG09",
+	"AG09_01",
+	"AG09_02",
+	"AG09_03",
 	"AG10_01",
 	"AG10_02",
 	"AG10_03",
 	"AG11",
 	"AG12",
+	"AG12_01",
 	"EJ02_01",
 	"EJ02_02",
 	"EJ02_03",
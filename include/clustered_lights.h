@@ -0,0 +1,87 @@
+#ifndef __CLUSTERED_LIGHTS_H__
+#define __CLUSTERED_LIGHTS_H__ 1
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "frame_uniforms.h"
+#include "gl_handle.h"
+
+class Shader;
+
+struct ClusterStats {
+	uint32_t lights = 0;	// In front of the camera
+	uint32_t references = 0;	// Light indices over all clusters
+	uint32_t maxPerCluster = 0;
+	uint32_t dropped = 0;	// References past the buffer texture size
+};
+
+// Clustered forward lighting. The view volume is split into k_TilesX x k_TilesY screen
+// tiles and k_Slices exponential depth slices. Point lights are assigned to the
+// clusters their range touches on the CPU, testing 8 spheres at a time with AVX2 or 4
+// with SSE, and every fragment only shades the lights of its cluster.
+//
+// The lists go to the GPU as buffer textures, read as in tests/AG08_06/cube.fs:
+//   lights: 4 RGBA32F texels per light, a PointLightData with the radius in the padding
+//   ranges: RG32UI offset and count per cluster, x fastest, then y, then the slice
+//   indices: R32UI light indices
+class ClusteredLights {
+public:
+	static const uint32_t k_TilesX = 16;
+	static const uint32_t k_TilesY = 9;
+	static const uint32_t k_Slices = 24;
+	static const uint32_t k_NumClusters = k_TilesX * k_TilesY * k_Slices;
+
+	ClusteredLights();
+
+	// Assigns the lights to the clusters of view and the perspective proj, and uploads them
+	void update(const PointLightData* lights, const uint32_t numLights, const glm::mat4& view,
+		const glm::mat4& proj);
+
+	// Binds the buffer textures to units firstUnit to firstUnit + 2 and sets the
+	// cluster uniforms of shader for a viewport width x height pixels big
+	void bind(const Shader& shader, const uint32_t firstUnit, const uint32_t width, const uint32_t height) const;
+
+	const ClusterStats& stats() const { return stats_; }
+
+	// Distance where the light's attenuation brings its brightest channel under what 8 bit color shows
+	static float lightRadius(const PointLightData& light);
+
+private:
+	// Light spheres in view space as structure of arrays, padded for the SIMD tests
+	struct SphereList {
+		std::vector<float> x, y, z, radius;
+		std::vector<uint32_t> ids;	// Index of each sphere's light
+		uint32_t size = 0;
+
+		void clear() { size = 0; }
+		void push(const float sx, const float sy, const float sz, const float sr, const uint32_t id);
+	};
+
+	// Recomputes the view space bounds of the clusters when the projection changes
+	void buildClusters(const glm::mat4& proj);
+	// Writes the positions in in of the spheres touching the box to passed, which holds
+	// in.size + 8 entries. Returns how many there are
+	static uint32_t testSpheres(const SphereList& in, const glm::vec3& min, const glm::vec3& max, uint32_t* passed);
+	void upload();
+
+	glm::mat4 proj_ = glm::mat4(0.0f);
+	float near_ = 0.0f, far_ = 0.0f;
+	// View space AABBs of every cluster and of every row of tiles in a slice
+	std::vector<glm::vec3> clusterMin_, clusterMax_;
+	std::vector<glm::vec3> rowMin_, rowMax_;
+
+	std::vector<SphereList> slices_;	// Lights touching each depth slice
+	SphereList row_;
+	std::vector<uint32_t> passed_;
+	std::vector<glm::uvec2> ranges_;
+	std::vector<uint32_t> indices_;
+	std::vector<glm::vec4> texels_;	// Lights as uploaded
+	int32_t maxTexels_;
+
+	GLBuffer lightBuffer_, rangeBuffer_, indexBuffer_;
+	GLTexture lightTexture_, rangeTexture_, indexTexture_;
+	ClusterStats stats_;
+};
+
+#endif
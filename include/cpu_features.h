@@ -0,0 +1,19 @@
+#ifndef __CPU_FEATURES_H__
+#define __CPU_FEATURES_H__ 1
+
+// x64 always has SSE2, AVX2 code is compiled for functions marked TARGET_AVX2
+// and only called when cpuHasAvx2() says so
+#if defined(_M_X64) || defined(__x86_64__)
+#define SIMD_X64 1
+#ifdef _MSC_VER
+// MSVC emits AVX intrinsics without /arch
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// Whether the CPU and the OS support AVX2, false off x64
+bool cpuHasAvx2();
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef __DEFERRED_RENDERER_H__
+#define __DEFERRED_RENDERER_H__ 1
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "frame_uniforms.h"
+#include "gl_handle.h"
+
+class Shader;
+
+struct DeferredStats {
+	uint32_t lights = 0;	// Volumes drawn, after frustum culling
+	uint32_t culled = 0;
+};
+
+// Deferred shading. Geometry is drawn once into a compact G-buffer, then every point
+// light draws a sphere bounding its range and shades only the pixels under it, so the
+// lighting cost follows the lit pixels instead of geometry x lights.
+//
+// G-buffer, read back from units 0 to 2, see tests/AG12_01/gbuffer.fs:
+//   location 0, RGBA8: albedo, specular intensity in alpha
+//   location 1, RG16: octahedral encoded world space normal
+//   depth, DEPTH_COMPONENT24 texture: positions are reconstructed from it
+//
+// Lighting shaders get gAlbedoSpec, gNormal, gDepth, viewProj, invViewProj and screenSize.
+// The volume shader reads the light at locations 1 to 4, the 4 vec4 of a
+// PointLightData with the radius in the padding, see tests/AG12_01/light_volume.vs
+class DeferredRenderer {
+public:
+	DeferredRenderer(const uint32_t width, const uint32_t height);
+
+	// Recreates the targets when the size changes
+	void resize(const uint32_t width, const uint32_t height);
+
+	// Binds and clears the G-buffer, geometry shaders write the outputs above
+	void beginGeometry();
+
+	// Copies the G-buffer depth into framebuffer target, which must have a DEPTH_COMPONENT24
+	// attachment like AG12_01's createFBO, and blends everything drawn until
+	// endLighting additively into it. view and proj must be the ones of the geometry pass
+	void beginLighting(const uint32_t target, const glm::mat4& view, const glm::mat4& proj);
+	// Full screen triangle with shader, for the ambient and directional terms
+	void drawFullScreen(const Shader& shader);
+	// One sphere per light in view with shader
+	void drawLights(const Shader& shader, const PointLightData* lights, const uint32_t numLights);
+	void endLighting();
+
+	// Of the last drawLights
+	const DeferredStats& stats() const { return stats_; }
+
+private:
+	void createTargets();
+	void createVolume();
+	// Binds the G-buffer and sets the reconstruction uniforms of shader
+	void bindGBuffer(const Shader& shader) const;
+
+	uint32_t width_, height_;
+	GLFramebuffer framebuffer_;
+	GLTexture albedoSpec_;
+	GLTexture normal_;
+	GLTexture depth_;
+
+	glm::mat4 viewProj_;
+	GLVertexArray emptyVAO_;	// Core profiles draw with some VAO bound
+	GLVertexArray volumeVAO_;
+	GLBuffer volumeVertices_, volumeIndices_;
+	uint32_t numVolumeIndices_;
+	GLBuffer lightBuffer_;
+	std::vector<PointLightData> visible_;	// Lights as uploaded
+	DeferredStats stats_;
+};
+
+#endif
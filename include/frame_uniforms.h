@@ -0,0 +1,88 @@
+#ifndef __FRAME_UNIFORMS_H__
+#define __FRAME_UNIFORMS_H__ 1
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "gl_handle.h"
+
+struct __GLsync;
+
+// Every shader with a FrameData uniform block reads it from this binding point
+const uint32_t k_FrameUniformBinding = 0;
+const uint32_t k_MaxPointLights = 8;
+
+// std140 mirrors of the GLSL structs. Each vec3 starts a 16 byte slot,
+// a float declared right after it fills the rest
+struct DirLightData {
+	glm::vec3 direction;
+	float padding0;
+	glm::vec3 ambient;
+	float padding1;
+	glm::vec3 diffuse;
+	float padding2;
+	glm::vec3 specular;
+	float padding3;
+};
+
+struct PointLightData {
+	glm::vec3 position;
+	float constant;
+	glm::vec3 ambient;
+	float linear;
+	glm::vec3 diffuse;
+	float quadratic;
+	glm::vec3 specular;
+	float padding;
+};
+
+// Matches, member by member:
+// layout (std140) uniform FrameData {
+//	mat4 view;
+//	mat4 proj;
+//	vec3 viewPos;
+//	int numPointLights;
+//	DirLight dirLight;
+//	PointLight pointLights[MAX_POINT_LIGHTS];
+// };
+struct FrameData {
+	glm::mat4 view;
+	glm::mat4 proj;
+	glm::vec3 viewPos;
+	int32_t numPointLights;
+	DirLightData dirLight;
+	PointLightData pointLights[k_MaxPointLights];
+};
+
+static_assert(sizeof(DirLightData) == 64, "DirLightData must follow std140");
+static_assert(sizeof(PointLightData) == 64, "PointLightData must follow std140");
+static_assert(offsetof(FrameData, dirLight) == 144, "FrameData must follow std140");
+static_assert(offsetof(FrameData, pointLights) == 208, "FrameData must follow std140");
+
+// Engine owned uniform buffer with the camera and lights of a frame, written once
+// and shared by every program, so frame data needs no per program glUniform calls.
+// The buffer holds k_NumRanges copies, update() writes the oldest one while the
+// GPU may still read the others and fences keep it from overtaking the GPU
+class FrameUniforms {
+public:
+	static const uint32_t k_NumRanges = 3;
+
+	// Needs a current context
+	FrameUniforms();
+	~FrameUniforms();
+
+	FrameUniforms(const FrameUniforms&) = delete;
+	FrameUniforms& operator=(const FrameUniforms&) = delete;
+
+	// Call once per frame before drawing. Copies data into the next range
+	// and binds it to k_FrameUniformBinding
+	void update(const FrameData& data);
+
+private:
+	GLBuffer buffer_;
+	uint32_t stride_;	// Range size rounded up to the offset alignment
+	uint32_t range_ = 0;
+	__GLsync* fences_[k_NumRanges] = {};
+};
+
+#endif
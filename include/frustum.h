@@ -0,0 +1,46 @@
+#ifndef __FRUSTUM_H__
+#define __FRUSTUM_H__ 1
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Planes of a clip volume facing inwards, a point p is inside when
+// dot(plane, vec4(p, 1)) >= 0 for all six
+struct Frustum {
+	// Planes of the volume matrix maps to clip space, in the space it maps from.
+	// proj * view gives world space planes, proj * view * model model space ones
+	explicit Frustum(const glm::mat4& matrix);
+
+	// Sphere as center and radius. Exact in the space of the planes, in model space
+	// only while the model matrix scales uniformly
+	bool intersects(const glm::vec4& sphere) const;
+	bool intersects(const glm::vec3& min, const glm::vec3& max) const;
+
+	glm::vec4 planes[6];	// Left, right, bottom, top, near, far, with unit normals
+};
+
+// Axis aligned boxes stored as structure of arrays, tested against a frustum
+// 8 at a time with AVX2 or 4 at a time with SSE
+class BoxList {
+public:
+	void clear();
+	void add(const glm::vec3& min, const glm::vec3& max);
+	void set(const uint32_t index, const glm::vec3& min, const glm::vec3& max);
+	uint32_t size() const { return size_; }
+
+	// Sets visible[i] to 1 when box i may intersect frustum and to 0 when it is
+	// outside, visible holds size() entries. Returns the number of visible boxes
+	uint32_t cull(const Frustum& frustum, uint8_t* visible) const;
+
+	// Instruction set cull runs with on this CPU
+	static const char* simdName();
+
+private:
+	// Padded to a multiple of 8 with empty boxes at the origin
+	std::vector<float> centerX_, centerY_, centerZ_;
+	std::vector<float> extentX_, extentY_, extentZ_;
+	uint32_t size_ = 0;
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef __GL_HANDLE_H__
+#define __GL_HANDLE_H__ 1
+
+#include <cstdint>
+
+// Owning GL object name, deleted with Traits::destroy when it goes out of
+// scope. Move-only, a moved from handle holds 0.
+template <typename Traits>
+class GLHandle {
+public:
+	GLHandle() = default;
+	explicit GLHandle(const uint32_t id) : id_(id) {}
+	~GLHandle() { reset(); }
+
+	GLHandle(const GLHandle&) = delete;
+	GLHandle& operator=(const GLHandle&) = delete;
+
+	GLHandle(GLHandle&& other) noexcept : id_(other.release()) {}
+	GLHandle& operator=(GLHandle&& other) noexcept {
+		if (this != &other) reset(other.release());
+		return *this;
+	}
+
+	uint32_t id() const { return id_; }
+	explicit operator bool() const { return id_ != 0; }
+
+	// Deletes the current object and takes ownership of id
+	void reset(const uint32_t id = 0) {
+		if (id_) Traits::destroy(id_);
+		id_ = id;
+	}
+
+	// Gives up ownership without deleting
+	uint32_t release() {
+		const uint32_t id = id_;
+		id_ = 0;
+		return id;
+	}
+
+private:
+	uint32_t id_ = 0;
+};
+
+struct GLBufferTraits {
+	static void destroy(const uint32_t id);
+};
+
+struct GLVertexArrayTraits {
+	static void destroy(const uint32_t id);
+};
+
+struct GLTextureTraits {
+	static void destroy(const uint32_t id);
+};
+
+struct GLFramebufferTraits {
+	static void destroy(const uint32_t id);
+};
+
+struct GLRenderbufferTraits {
+	static void destroy(const uint32_t id);
+};
+
+typedef GLHandle<GLBufferTraits> GLBuffer;
+typedef GLHandle<GLVertexArrayTraits> GLVertexArray;
+typedef GLHandle<GLTextureTraits> GLTexture;
+typedef GLHandle<GLFramebufferTraits> GLFramebuffer;
+typedef GLHandle<GLRenderbufferTraits> GLRenderbuffer;
+
+#endif
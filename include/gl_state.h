@@ -0,0 +1,64 @@
+#ifndef __GL_STATE_H__
+#define __GL_STATE_H__ 1
+
+#include <cstdint>
+
+struct GLStateStats {
+	uint32_t calls = 0;	// State changes asked for
+	uint32_t filtered = 0;	// Of those, the ones GL already had and were skipped
+};
+
+// Shadow copy of the GL state the engine touches, each setter only calls GL
+// when the value differs from the last one set. Unknown values always go through,
+// so everything starts unknown and invalidate() forgets it all again.
+// Main context only: code that changes this state with raw GL calls must call
+// invalidate() before going back to GLState, deleted objects are forgotten by
+// the GL handle, texture and shader destructors.
+class GLState {
+public:
+	static void useProgram(const uint32_t program);
+	static void bindVertexArray(const uint32_t VAO);
+	// Element array buffers are VAO state, changing the VAO forgets it
+	static void bindBuffer(const uint32_t target, const uint32_t buffer);
+	// Indexed bindings also change the target's generic one
+	static void bindBufferBase(const uint32_t target, const uint32_t index, const uint32_t buffer);
+	static void bindBufferRange(const uint32_t target, const uint32_t index, const uint32_t buffer,
+		const intptr_t offset, const intptr_t size);
+	static void bindFramebuffer(const uint32_t framebuffer);
+	// Makes unit active only when the bind is needed
+	static void bindTexture(const uint32_t unit, const uint32_t texture, const uint32_t target = 0x0DE1);
+	static void activeTexture(const uint32_t unit);
+
+	static void enable(const uint32_t capability);
+	static void disable(const uint32_t capability);
+	static void blendFunc(const uint32_t source, const uint32_t destination);
+	static void blendFuncSeparate(const uint32_t sourceColor, const uint32_t destinationColor,
+		const uint32_t sourceAlpha, const uint32_t destinationAlpha);
+	static void depthFunc(const uint32_t function);
+	static void depthMask(const bool write);
+	static void cullFace(const uint32_t face);
+	static void stencilFunc(const uint32_t function, const int32_t reference, const uint32_t mask);
+	static void stencilOp(const uint32_t stencilFail, const uint32_t depthFail, const uint32_t pass);
+	static void stencilMask(const uint32_t mask);
+	static void viewport(const int32_t x, const int32_t y, const int32_t width, const int32_t height);
+
+	// Forget everything, the next call of each setter reaches GL
+	static void invalidate();
+	// Deleted names may be reused, a cached binding of them must not skip the next bind
+	static void forgetProgram(const uint32_t program);
+	static void forgetVertexArray(const uint32_t VAO);
+	static void forgetBuffer(const uint32_t buffer);
+	static void forgetTexture(const uint32_t texture);
+	static void forgetFramebuffer(const uint32_t framebuffer);
+
+	static const GLStateStats& stats() { return stats_; }
+	static void resetStats() { stats_ = GLStateStats(); }
+
+private:
+	// True when the cached value already equals value, otherwise stores it
+	static bool cached(uint32_t* slot, const uint32_t value);
+
+	static GLStateStats stats_;
+};
+
+#endif
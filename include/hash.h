@@ -0,0 +1,29 @@
+#ifndef __HASH_H__
+#define __HASH_H__ 1
+
+#include <cstddef>
+#include <cstdint>
+
+const uint64_t k_FNVOffset = 14695981039346656037ull;
+const uint64_t k_FNVPrime = 1099511628211ull;
+
+// 64-bit FNV-1a, pass a previous result as hash to continue it
+inline uint64_t hashBytes(const void* data, const size_t size, uint64_t hash = k_FNVOffset) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= k_FNVPrime;
+	}
+	return hash;
+}
+
+// Same hash of a null terminated string, can run at compile time
+constexpr uint64_t hashString(const char* string, uint64_t hash = k_FNVOffset) {
+	while (*string) {
+		hash ^= static_cast<uint8_t>(*string++);
+		hash *= k_FNVPrime;
+	}
+	return hash;
+}
+
+#endif
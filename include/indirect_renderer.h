@@ -0,0 +1,98 @@
+#ifndef __INDIRECT_RENDERER_H__
+#define __INDIRECT_RENDERER_H__ 1
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "gl_handle.h"
+
+class Model;
+class Shader;
+struct LodView;
+
+// Layout of glMultiDrawElementsIndirect records, written by the culling shader
+struct DrawElementsIndirectCommand {
+	uint32_t count;
+	uint32_t instanceCount;	// 0 when culled
+	uint32_t firstIndex;
+	int32_t baseVertex;
+	uint32_t baseInstance;	// Instance whose matrix the draw reads
+};
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "Indirect commands are five words");
+
+// Shader storage bindings of the culling shader
+const uint32_t k_CullTransformsBinding = 0;	// mat4 transforms[], see Model::appendInstances
+const uint32_t k_CullMeshesBinding = 1;	// CullMesh meshes[]
+const uint32_t k_CullCommandsBinding = 2;	// DrawElementsIndirectCommand commands[]
+const uint32_t k_CullLodsBinding = 3;	// CullLod lods[]
+
+// GPU driven drawing of many instances of a merged Model, GL 4.3 and up.
+// A compute shader tests the bounding sphere of every mesh of every instance
+// against the frustum and writes one indirect command per pair, grouped by
+// mesh. Each mesh is then one glMultiDrawElementsIndirect over the merged
+// buffers, so the CPU does the same work for ten instances or a million.
+// Culled pairs draw zero instances, the baseInstance makes the instance matrix
+// attribute of InstanceRenderer shaders (k_InstanceMatrixLocation) read the right one,
+// already times the world transform of the mesh's node. Each pair also picks the
+// LOD its distance allows from the mesh's range table, the same test as
+// Model::selectLods.
+//
+// The culling shader gets the buffers above plus the uniforms
+// vec4 planes[6], int numInstances, int numMeshes, vec3 viewPosition and
+// float lodScale (pixels per unit over the pixel error, 0 draws LOD 0), one
+// invocation per pair with the mesh index as gid / numInstances, see tests/AG09_03/cull.cs
+class IndirectRenderer {
+public:
+	// Size of the culling shader's work groups
+	static const uint32_t k_GroupSize = 64;
+
+	// Whether the current context runs compute shaders and indirect draws
+	static bool isSupported();
+
+	// model must be merged, see ModelOptions::merge, and outlive the renderer
+	explicit IndirectRenderer(const Model& model);
+
+	// Replaces the instances, uploaded right away with the node transforms of the model.
+	// Call again once Model::updateScene moved nodes
+	void setInstances(const glm::mat4* transforms, const uint32_t count);
+
+	// Culls against the frustum of viewProj with cull and draws what is left with shader,
+	// which needs its other uniforms set already. Without lods every pair draws LOD 0.
+	// Returns the number of draw calls
+	uint32_t draw(const Shader& cull, const Shader& shader, const glm::mat4& viewProj,
+		const LodView* lods = nullptr);
+
+	// Mesh and instance pairs the last draw did not cull. Waits for the GPU, only for stats
+	uint32_t countVisible() const;
+
+	uint32_t numInstances() const { return numInstances_; }
+
+private:
+	// std430 layout of the culling shader's mesh table
+	struct CullMesh {
+		glm::vec4 boundingSphere;
+		uint32_t firstLod;	// Of its ranges in the LOD table
+		uint32_t numLods;
+		int32_t baseVertex;
+		uint32_t firstTransform;	// Block of the mesh's node, set by setInstances
+	};
+	// std430 layout of the LOD table, one entry per LOD of every mesh
+	struct CullLod {
+		uint32_t firstIndex;
+		uint32_t count;
+		float error;
+		uint32_t padding;
+	};
+	// Writes the bounds and LOD ranges of the model's meshes once they are in the merged buffers
+	void uploadMeshes();
+
+	const Model& model_;
+	GLBuffer transforms_, meshes_, commands_, lods_;
+	uint32_t numInstances_ = 0;
+	bool uploaded_ = false;	// Of the mesh and LOD tables
+	std::vector<CullMesh> cullMeshes_;
+	std::vector<CullLod> cullLods_;
+	std::vector<glm::mat4> matrices_;	// Kept to reuse the memory
+};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef __INSTANCE_RENDERER_H__
+#define __INSTANCE_RENDERER_H__ 1
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include "gl_handle.h"
+#include "mesh.h"
+
+class Model;
+class Shader;
+struct LodView;
+
+struct InstanceStats {
+	uint32_t instances = 0;
+	uint32_t batches = 0;	// Distinct models and raw geometry drawn
+	uint32_t drawCalls = 0;
+};
+
+// Draws many placements of loaded geometry, a Model is loaded once and each
+// instance is only its transform. Instances of the same model or raw geometry
+// are drawn with one glDrawElementsInstanced per mesh, their matrices streamed
+// into one attribute buffer per frame, times the node transforms of models that
+// have some, see Model::appendInstances. Shaders read them as
+// layout (location = 5) in mat4 instanceModel, see k_InstanceMatrixLocation.
+// Given a LodView, the instances of models with LODs are bucketed per mesh by
+// the LOD each needs and every bucket is one draw, see Model::appendInstanceLods
+class InstanceRenderer {
+public:
+	// Starts a frame, forgets the instances of the last one
+	void begin();
+
+	// Places model at transform
+	void add(const Model& model, const glm::mat4& transform);
+	// Places numIndices 32 bit indices of VAO at transform. textures[i] goes to unit i
+	// and must live until flush
+	void add(const uint32_t VAO, const uint32_t numIndices, const uint32_t* textures, const uint32_t numTextures,
+		const glm::mat4& transform);
+
+	// Uploads the matrices and draws every batch with shader, which needs its
+	// other uniforms set already. Without lods every instance draws LOD 0
+	void flush(const Shader& shader, const LodView* lods = nullptr);
+
+	// Of the last flush
+	const InstanceStats& stats() const { return stats_; }
+
+private:
+	struct Batch {
+		const Model* model;	// Null for raw geometry
+		uint32_t VAO;
+		uint32_t numIndices;
+		const uint32_t* textures;
+		uint32_t numTextures;
+		std::vector<glm::mat4> transforms;
+		uint32_t first;	// Of its matrices in buffer_, set by upload
+		uint32_t firstRange;	// Of its LOD ranges in ranges_ when drawn with LODs, else ~0u
+	};
+	// Batch for key, its transforms are kept across frames to reuse their memory
+	Batch& batch(const uint64_t key);
+	// Copies the matrices of every batch into buffer_, growing it when needed
+	void upload(const LodView* lods);
+
+	std::unordered_map<uint64_t, uint32_t> batchIds_;
+	std::vector<Batch> batches_;
+	std::vector<glm::mat4> matrices_;
+	std::vector<InstanceRange> ranges_;
+	GLBuffer buffer_;
+	size_t capacity_ = 0;	// Bytes
+	InstanceStats stats_;
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef __MAPPED_FILE_H__
+#define __MAPPED_FILE_H__ 1
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only view of a whole file mapped into memory
+class MappedFile {
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Maps the file at path, returns false if it can not be opened or is empty
+	bool open(const std::string& path);
+	void close();
+
+	bool isOpen() const { return data_ != nullptr; }
+	const uint8_t* data() const { return data_; }
+	size_t size() const { return size_; }
+
+private:
+	const uint8_t* data_ = nullptr;
+	size_t size_ = 0;
+#ifdef _WIN32
+	void* file_ = nullptr;
+	void* mapping_ = nullptr;
+#endif
+};
+
+#endif
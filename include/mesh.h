@@ -4,8 +4,9 @@
 #include <glm/glm.hpp>
 #include <string>
 #include <vector>
-
-class Shader;
+#include "gl_handle.h"
+#include "shader.h"
+#include "texture_registry.h"
 
 struct Vertex {
 	glm::vec3 Position;
@@ -16,26 +17,158 @@ struct Vertex {
 };
 
 struct Texture {
-	uint32_t id;
+	TextureHandle handle;	// Shared GL texture, see TextureRegistry
 	std::string type;
 	std::string path;
+
+	uint32_t id() const { return handle ? handle->id : 0; }
+};
+
+// First of the four attribute locations of the per instance model matrix,
+// after the ones of both vertex formats
+const uint32_t k_InstanceMatrixLocation = 5;
+
+// Instance matrices drawn with one LOD of one mesh, see Model::appendInstanceLods
+struct InstanceRange {
+	uint32_t first;
+	uint32_t count;
+};
+
+// Interned Texture::type, samplers are named after it
+enum class TextureType : uint8_t {
+	Diffuse = 0,	// texture_diffuseN
+	Specular = 1,	// texture_specularN
+	Normal = 2,	// texture_normalN
+	Height = 3,	// texture_heightN
+	Other = 4,	// Sampler named after the type alone
+};
+
+// Texture unit, texture and sampler of one material texture, resolved when the
+// mesh is built so drawing does no string work
+struct TextureBinding {
+	const TextureResource* texture;	// Its id is read at bind time, streamed textures get theirs late
+	UniformName sampler;
+	uint8_t unit;
+	TextureType type;
+};
+
+// Layout of the vertex buffer on the GPU
+enum class VertexFormat : uint8_t {
+	Full,	// Vertex
+	Packed	// PackedVertex, see vertex_packing.h
 };
 
+// Index range of one level of detail, LOD 0 is the full mesh
+struct MeshLod {
+	uint32_t firstIndex;	// Relative to the mesh's own indices
+	uint32_t numIndices;
+	float error;	// Furthest the surface moved from the full mesh, in model units
+};
+
+// Owns its GL buffers and VAO, so it can be moved but not copied
 class Mesh {
 public:
-	Mesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices, std::vector<Texture> textures);
+	// Takes over the arrays without copying them. Without upload the buffers are
+	// created elsewhere and handed over with setupBuffers
+	Mesh(std::vector<Vertex>&& vertices, std::vector<uint32_t>&& indices, std::vector<Texture>&& textures,
+		const bool upload = true);
+	// Uploads the arrays straight to the GPU without keeping a CPU copy
+	Mesh(const Vertex* vertices, const uint32_t numVertices, const uint32_t* indices,
+		const uint32_t numIndices, std::vector<Texture>&& textures, const bool upload = true);
+
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+	Mesh(Mesh&&) = default;
+	Mesh& operator=(Mesh&&) = default;
+
+	// Creates this mesh's own buffers and VAO
+	void setupMesh(const Vertex* vertices, const uint32_t numVertices, const uint32_t* indices,
+		const uint32_t numIndices);
+	// Builds the VAO around buffers that already hold this mesh's data and takes them over
+	void setupBuffers(const uint32_t VBO, const uint32_t EBO);
+	// Frees vertices_ and indices_ once they are on the GPU
+	void releaseCpuData();
+	// Makes the buffers expect PackedVertex data, called before they are set up.
+	// Draws then set the positionScale and positionOffset uniforms
+	void setPacked(const glm::vec3& positionScale, const glm::vec3& positionOffset, const bool shortIndices);
+
+	VertexFormat format() const { return format_; }
+	uint32_t vertexSize() const;
+	uint32_t indexSize() const { return indexSize_; }
+	// False until the buffers are uploaded, Draw skips the mesh meanwhile
+	bool isReady() const { return static_cast<bool>(VAO_); }
 
+	// Picks the level of detail drawn next, clamped to the available ones
+	void setLod(const uint32_t lod);
+	uint32_t lod() const { return lod_; }
+	// Levels of detail, 1 without LODs
+	uint32_t numLods() const { return lods_.empty() ? 1 : static_cast<uint32_t>(lods_.size()); }
+
+	// Places the mesh inside buffers shared with other meshes, drawn with drawRange
+	void setRange(const int32_t baseVertex, const uint32_t firstIndex);
+
+	// Binds its own VAO and draws
 	void Draw(const Shader& shader) const;
+	// Binds the textures and draws the index range, the VAO holding it must be bound
+	void drawRange(const Shader& shader) const;
+	// The two halves of drawRange, so draws sharing the textures can skip binding them
+	void bindTextures(const Shader& shader) const;
+	// What bindTextures sets, sampler and unit of each texture
+	const std::vector<TextureBinding>& bindings() const { return bindings_; }
+	// Draws numInstances copies when above one, see setupInstanceLayout
+	void drawElements(const Shader& shader, const uint32_t numInstances = 1) const;
+	// Same with lod instead of the selected one
+	void drawElements(const Shader& shader, const uint32_t numInstances, const uint32_t lod) const;
+	// Sets the positionScale and positionOffset uniforms when the vertices are packed
+	void setPackedUniforms(const Shader& shader) const;
+	// Indices drawn for the selected LOD, firstIndex counts from the start of the index buffer
+	void indexRange(uint32_t* firstIndex, uint32_t* numIndices) const;
+	// Indices of lod, clamped to the available ones
+	void indexRange(const uint32_t lod, uint32_t* firstIndex, uint32_t* numIndices) const;
+	int32_t baseVertex() const { return baseVertex_; }
+
+	// Own VAO, 0 when the buffers are shared
+	uint32_t vertexArray() const { return VAO_.id(); }
+
+	// Creates a vertex and an index buffer holding the data
+	static void createBuffers(const void* vertices, const size_t vertexBytes, const void* indices,
+		const size_t indexBytes, uint32_t* VBO, uint32_t* EBO);
+	// Sets the attributes of the format on the bound VAO from the bound GL_ARRAY_BUFFER
+	static void setupVertexLayout(const VertexFormat format = VertexFormat::Full);
+	// Points the instance matrix attribute of the bound VAO at the mat4s of buffer,
+	// starting at firstInstance and advancing once per instance
+	static void setupInstanceLayout(const uint32_t buffer, const uint32_t firstInstance);
 
 	std::vector<Vertex> vertices_;
 	std::vector<uint32_t> indices_;
 	std::vector<Texture> textures_;
-	uint32_t VAO_;
+	// Coarser index lists are stored after the full one, empty without LODs
+	std::vector<MeshLod> lods_;
+	// Center and radius in model space, used to pick the LOD
+	glm::vec4 boundingSphere_ = glm::vec4(0.0f);
+	// AABB in model space, used to cull
+	glm::vec3 boundsMin_ = glm::vec3(0.0f), boundsMax_ = glm::vec3(0.0f);
+
+	// AABB of the vertices, empty at the origin without them
+	static void computeBounds(const Vertex* vertices, const uint32_t numVertices, glm::vec3* min, glm::vec3* max);
+	// Sphere around the AABB of the vertices
+	static glm::vec4 computeBoundingSphere(const Vertex* vertices, const uint32_t numVertices);
+	static TextureType textureType(const std::string& type);
 
 private:
-	void setupMesh();
+	// Fills bindings_ from textures_
+	void buildBindings();
 
-	uint32_t VBO_, EBO_;
+	std::vector<TextureBinding> bindings_;
+	GLVertexArray VAO_;
+	GLBuffer VBO_, EBO_;	// Empty when the buffers are shared, see setRange
+	uint32_t numIndices_;	// All LODs
+	uint32_t lod_ = 0;
+	VertexFormat format_ = VertexFormat::Full;
+	uint32_t indexSize_ = sizeof(uint32_t);
+	glm::vec3 positionScale_ = glm::vec3(1.0f), positionOffset_ = glm::vec3(0.0f);
+	int32_t baseVertex_ = 0;
+	uint32_t firstIndex_ = 0;
 };
 
 #endif
\ No newline at end of file
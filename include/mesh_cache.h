@@ -0,0 +1,54 @@
+#ifndef __MESH_CACHE_H__
+#define __MESH_CACHE_H__ 1
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mapped_file.h"
+#include "mesh.h"
+#include "scene_graph.h"
+
+// Bump whenever the layout of the cache file or of Vertex changes
+const uint32_t k_MeshCacheVersion = 5;
+
+// On-disk cache of the processed meshes of a Model. Holds the final
+// interleaved vertices, the indices with their LODs, the texture references and the
+// node hierarchy so a warm load only has to map the file and upload it.
+class MeshCache {
+public:
+	// Processed mesh pointing into the mapped cache file
+	struct MeshView {
+		const Vertex* vertices;
+		uint32_t numVertices;
+		const uint32_t* indices;
+		uint32_t numIndices;
+		std::vector<Texture> textures;	// Only type and path are filled
+		std::vector<MeshLod> lods;	// Their indices are part of indices
+		glm::vec4 boundingSphere;
+		glm::vec3 boundsMin, boundsMax;
+	};
+
+	// Hash of the source file contents, the MTL files an OBJ references, the import
+	// flags, the engine side processing options and the cache version
+	static uint64_t computeKey(const std::string& sourcePath, const uint32_t importFlags,
+		const uint32_t processFlags = 0);
+
+	// Writes the meshes and the nodes placing them to path, tagged with key
+	static bool write(const std::string& path, const uint64_t key, const std::vector<Mesh>& meshes,
+		const SceneGraph& scene);
+
+	// Maps the cache at path, returns false if missing, corrupt or its key does not match
+	bool open(const std::string& path, const uint64_t key);
+	void close();
+
+	// Valid while the cache stays open
+	const std::vector<MeshView>& meshes() const { return meshes_; }
+	const SceneGraph& scene() const { return scene_; }
+
+private:
+	MappedFile file_;
+	std::vector<MeshView> meshes_;
+	SceneGraph scene_;
+};
+
+#endif
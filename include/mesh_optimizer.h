@@ -0,0 +1,49 @@
+#ifndef __MESH_OPTIMIZER_H__
+#define __MESH_OPTIMIZER_H__ 1
+
+#include <cstdint>
+#include <vector>
+#include "mesh.h"
+
+// Post-transform vertex cache behaviour of an index buffer
+struct VertexCacheStats {
+	uint32_t numTriangles = 0;
+	uint32_t numVertices = 0;	// Distinct vertices referenced
+	uint32_t numTransforms = 0;	// Cache misses, one vertex shader run each
+
+	// Average cache miss ratio: transforms per triangle, 0.5 at best and 3 at worst
+	float acmr() const { return numTriangles ? static_cast<float>(numTransforms) / numTriangles : 0.0f; }
+	// Average transform to vertex ratio: transforms per vertex, 1 at best
+	float atvr() const { return numVertices ? static_cast<float>(numTransforms) / numVertices : 0.0f; }
+
+	VertexCacheStats& operator+=(const VertexCacheStats& other);
+};
+
+// Reorders imported triangle lists so the GPU transforms and shades less.
+// optimize() runs every step in the right order.
+class MeshOptimizer {
+public:
+	// FIFO size used to report the statistics, close to what GPUs have
+	static const uint32_t k_StatsCacheSize = 16;
+
+	// Welds, reorders for the vertex cache, then overdraw, then vertex fetch
+	static void optimize(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices,
+		VertexCacheStats* before = nullptr, VertexCacheStats* after = nullptr);
+
+	// Merges bitwise identical vertices and remaps the indices
+	static void weldVertices(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices);
+	// Orders triangles to reuse recently transformed vertices (Forsyth)
+	static void optimizeVertexCache(std::vector<uint32_t>* indices, const uint32_t numVertices);
+	// Splits the cache optimized order into clusters and draws the outward facing ones
+	// first (Sander et al.). threshold bounds how much ACMR the extra splits may cost
+	static void optimizeOverdraw(std::vector<uint32_t>* indices, const std::vector<Vertex>& vertices,
+		const float threshold = 1.05f);
+	// Renumbers vertices in order of first use and drops unused ones
+	static void optimizeVertexFetch(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices);
+
+	// Simulates a FIFO post-transform cache of cacheSize entries
+	static VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, const uint32_t numVertices,
+		const uint32_t cacheSize = k_StatsCacheSize);
+};
+
+#endif
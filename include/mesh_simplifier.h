@@ -0,0 +1,28 @@
+#ifndef __MESH_SIMPLIFIER_H__
+#define __MESH_SIMPLIFIER_H__ 1
+
+#include <cstdint>
+#include <vector>
+#include "mesh.h"
+
+// Quadric error edge collapse on an indexed triangle list. Vertices are
+// never moved or created, a simplified mesh is a new index list over the
+// same vertex array. Vertices sharing a position with different normals or
+// UVs (seams) and open borders only collapse along the seam or border.
+class MeshSimplifier {
+public:
+	// LODs stop once a step removes less than this fraction of the triangles
+	static constexpr float k_MinReduction = 0.15f;
+
+	// Collapses edges until at most targetIndices are left or the next collapse would move the
+	// surface further than maxError (model units). Returns the error reached, in model units
+	static float simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+		const uint32_t targetIndices, const float maxError, std::vector<uint32_t>* result);
+
+	// Appends up to maxLods coarser versions of indices to it, each about half of the previous one.
+	// Returns every LOD including the full mesh as LOD 0, errors are relative to the full mesh
+	static std::vector<MeshLod> buildLodChain(const std::vector<Vertex>& vertices, std::vector<uint32_t>* indices,
+		const uint32_t maxLods = 4, const float maxRelativeError = 0.05f);
+};
+
+#endif
@@ -2,39 +2,217 @@
 #define __MODEL_H__ 1
 
 #include <string>
+#include "frustum.h"
 #include "mesh.h"
+#include "mesh_optimizer.h"
+#include "render_queue.h"
+#include "scene_graph.h"
+#include "vertex_packing.h"
 #include "assimp/material.h"
 
 class aiNode;
 struct aiScene;
 class aiMesh;
 class aiMaterial;
+class UploadService;
+class MeshCache;
+class Camera;
+
+// How a Model is loaded and laid out on the GPU
+struct ModelOptions {
+	bool gamma = false;
+	// Store the processed meshes next to the model as <path>.meshcache
+	bool useCache = true;
+	// Stream the GPU data in the background, meshes show up as they finish
+	// and the model must outlive its pending uploads
+	UploadService* uploads = nullptr;
+	// Pack every mesh into one vertex and one index buffer drawn under a single VAO
+	bool merge = false;
+	// Weld vertices and reorder triangles and vertices for the GPU caches after import
+	bool optimize = true;
+	// Upload PackedVertex data and 16 bit indices where they fit, about a third of the
+	// memory. The shaders must decode it, see PackedVertex
+	bool pack = false;
+	// Read .obj files with the native ObjLoader instead of ASSIMP. Off until tests/AG09_01
+	// has compared both on a build with ASSIMP, the native half alone matches the face
+	// counts of the Freighter but not a mesh-by-mesh check against ASSIMP
+	bool nativeObj = false;
+	// Free Mesh::vertices_ and indices_ once they are uploaded, about halves resident memory
+	bool releaseCpuData = false;
+	// Build simplified LODs of every mesh, picked per frame with Model::selectLods
+	bool lods = false;
+};
+
+// What processing the meshes of a Model went through, nothing is filled when they
+// came from the mesh cache
+struct ModelLoadStats {
+	bool fromCache = false;
+	VertexCacheStats before, after;	// Over every mesh, when optimized
+	std::vector<uint32_t> lodTriangles;	// Per LOD level over every mesh, when built
+};
+
+// Viewpoint LODs are picked for, the coarsest LOD whose error covers at most
+// maxPixelError pixels on a viewport viewportHeight pixels high
+struct LodView {
+	glm::vec3 position;
+	float pixelsPerUnit;	// Pixels one unit covers at distance one
+	float maxPixelError;
+
+	// fov is the vertical field of view in degrees
+	LodView(const glm::vec3& position, const float fov, const float viewportHeight,
+		const float maxPixelError = 1.0f);
+};
 
 class Model {
 
 public:
-	std::vector<Texture> textures_loaded_;	//stores all the textures loaded
 	std::vector<Mesh> meshes_;
 	std::string directory_;
 	bool gammaCorrection_;
 
 	// Consturctor, expects a filepath to a 3D model
-	Model(std::string const &path, bool gamma = false);
+	Model(std::string const &path, const ModelOptions& options = ModelOptions());
 
-	// Draws the model, and thus all its meshes
+	// Pending uploads call back into the model, so it stays where it was built
+	Model(const Model&) = delete;
+	Model& operator=(const Model&) = delete;
+
+	// Draws the model, and thus all its meshes the last cull left in, with the model
+	// matrix the caller set. The node transforms are not applied, models that have some
+	// log an error once and should use the overload below
 	void Draw(const Shader& shader) const;
+	// Same, placing each node's meshes with model times the node's world transform.
+	// Sets the "model" uniform and "normalMat" when the shader has it
+	void Draw(const Shader& shader, const glm::mat4& model) const;
+	// Hands every mesh that is ready and not culled to the queue instead of drawing it,
+	// placed by its node
+	void submit(RenderQueue* queue, const Shader& shader, const glm::mat4& model,
+		const RenderPass pass = RenderPass::Opaque) const;
+
+	// Draws numInstances copies of every mesh with one instanced draw each, placed by the
+	// matrices appendInstances wrote to instanceBuffer from firstInstance on. All of them
+	// use LOD 0, appendInstanceLods picks one per instance.
+	// Returns the number of draw calls
+	uint32_t drawInstanced(const Shader& shader, const uint32_t instanceBuffer, const uint32_t firstInstance,
+		const uint32_t numInstances) const;
+	// Appends the instance matrices of count placements: the transforms as they are when
+	// every node with meshes is at the model's origin, else a block of count per such node
+	// in node order, each transform times the node's world transform. Stale once
+	// updateScene moves a node
+	void appendInstances(const glm::mat4* transforms, const uint32_t count, std::vector<glm::mat4>* matrices) const;
+	// Appends a block of count matrices per mesh, placed like appendInstances, with the
+	// placements ordered by the LOD of the mesh seen from view. Appends a range per LOD of
+	// every mesh in mesh order, first counts from the start of matrices
+	void appendInstanceLods(const glm::mat4* transforms, const uint32_t count, const LodView& view,
+		std::vector<glm::mat4>* matrices, std::vector<InstanceRange>* ranges) const;
+	// Draws every range appendInstanceLods wrote with its LOD, placed by the matrices in
+	// instanceBuffer. Returns the number of draw calls
+	uint32_t drawInstanceLods(const Shader& shader, const uint32_t instanceBuffer, const InstanceRange* ranges) const;
+	// Whether any mesh has LODs to pick from
+	bool hasLods() const;
+	// Blocks appendInstances writes, 1 when the nodes need no transform
+	uint32_t numInstanceBlocks() const { return instanceNodes_.empty() ? 1 : static_cast<uint32_t>(instanceNodes_.size()); }
+	// Block whose matrices place mesh
+	uint32_t instanceBlock(const uint32_t mesh) const { return meshBlocks_.empty() ? 0 : meshBlocks_[mesh]; }
+
+	const ModelLoadStats& loadStats() const { return loadStats_; }
+
+	// Shared VAO of a merged model, 0 otherwise or while streaming
+	uint32_t vertexArray() const { return VAO_.id(); }
+
+	// Node hierarchy of the file, formats without one get a single root holding every mesh
+	const SceneGraph& scene() const { return scene_; }
+	// Moves a node relative to its parent, it and its subtree follow on the next updateScene
+	void setNodeTransform(const uint32_t node, const glm::mat4& local);
+	// Updates the world transforms and bounds of the moved subtrees, returns the nodes updated
+	uint32_t updateScene();
+
+	// Tests the bounds of every mesh against the frustum of viewProj with the model matrix.
+	// Draw and submit skip the meshes outside until the next cull. Returns the meshes left
+	uint32_t cull(const glm::mat4& viewProj, const glm::mat4& model);
+
+	// Picks for each mesh the coarsest LOD whose error covers at most maxPixelError pixels
+	// on a viewport viewportHeight pixels high, seen from camera with the model matrix
+	void selectLods(const Camera& camera, const glm::mat4& model, const float viewportHeight,
+		const float maxPixelError = 1.0f);
+	// Same, seen from view. Draw and submit use the LODs, instances pick their own
+	void selectLods(const LodView& view, const glm::mat4& model);
 
 private:
+	// Vertex and index arrays of one mesh, waiting to be uploaded
+	struct MeshSource {
+		const Vertex* vertices;
+		uint32_t numVertices;
+		const uint32_t* indices;
+		uint32_t numIndices;
+	};
+	// The same mesh in the format the GPU reads
+	struct MeshBytes {
+		const void* vertices;
+		size_t vertexBytes;
+		const void* indices;
+		size_t indexBytes;
+	};
+
 	// Loads a model with supported ASSIMP extensions from file and stores resulting meshes
 	void loadModel(std::string const path);
+	// Builds the meshes from an open processed mesh cache
+	void loadCache(const MeshCache& cache);
+
+	// CPU side result of processing one aiMesh, textures only have type and path
+	struct MeshData {
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		std::vector<Texture> textures;
+		VertexCacheStats before, after;	// Only filled when optimized
+		std::vector<MeshLod> lods;	// Their indices follow the full ones
+		glm::vec4 boundingSphere;
+		glm::vec3 boundsMin, boundsMax;
+	};
+
+	// Imports a Wavefront OBJ with ObjLoader, returns false on errors
+	bool loadObj(const std::string& path, std::vector<MeshData>* data);
+	// Collects the meshes of a node and its children recursively, in draw order, and
+	// adds the nodes to scene_ under parent
+	void processNode(aiNode *node, const aiScene *scene, const uint32_t parent, std::vector<aiMesh*>* meshes);
+	// Converts the meshes in parallel
+	void processMeshes(const std::vector<aiMesh*>& meshes, const aiScene *scene, std::vector<MeshData>* data);
+	// Converts one mesh, touches no GL state so it can run on any thread
+	static MeshData processMesh(aiMesh *mesh, const aiScene *scene);
+	// Optimizes the imported meshes and builds their LODs in parallel, then moves them into meshes_ in order
+	void buildMeshes(std::vector<MeshData>* data);
+
+	// Checks all material textures of a given type and returns their references
+	static std::vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, std::string typeName);
+	// Acquires a texture relative to the model directory from the TextureRegistry
+	Texture loadTexture(const char* path, const std::string& typeName);
 
-	// Processes a node in a recursive fashion. Processes eachi individual mesh
-	void processNode(aiNode *node, const aiScene *scene);
-	Mesh processMesh(aiMesh *mesh, const aiScene *scene);
+	// Creates the GPU buffers of meshes_ as the options ask for
+	void uploadMeshes(const std::vector<MeshSource>& sources);
+	// Quantizes the sources into the packed arrays, which must outlive the uploads of bytes
+	void packMeshes(const std::vector<MeshSource>& sources, std::vector<MeshBytes>* bytes,
+		std::vector<std::vector<PackedVertex>>* vertices, std::vector<std::vector<uint16_t>>* indices);
+	// Concatenates every mesh into the shared buffers, each mesh keeps its range
+	void mergeMeshes(const std::vector<MeshBytes>& bytes);
+	// Builds the shared VAO around the merged buffers
+	void setupMergedBuffers(const uint32_t VBO, const uint32_t EBO);
+	// Moves the culling boxes of the node's meshes to where its world transform puts them
+	void placeBounds(const uint32_t node);
+	// Lists the nodes with meshes when any of them is away from the model's origin
+	void findInstanceNodes();
 
-	// Checks all material textures of a given type and loads the textures
-	// The required info is returned as a Texture struct
-	std::vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, std::string typeName);
+	ModelOptions options_;
+	ModelLoadStats loadStats_;
+	GLVertexArray VAO_;	// Shared buffers when merged
+	GLBuffer VBO_, EBO_;
+	SceneGraph scene_;
+	std::vector<uint32_t> updatedNodes_;	// Kept between updates to reuse the memory
+	BoxList bounds_;	// AABB of every mesh in model space, placed by its node
+	std::vector<uint8_t> visible_;	// Per mesh, set by cull
+	std::vector<uint32_t> meshNodes_;	// Node of each mesh
+	std::vector<uint32_t> instanceNodes_;	// Empty when every node is at the origin
+	std::vector<uint32_t> meshBlocks_;	// Instance block of each mesh, with instanceNodes_
+	mutable bool warnedNodes_ = false;	// Draw without the node transforms logged it
 };
 
 #endif
\ No newline at end of file
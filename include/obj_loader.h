@@ -0,0 +1,37 @@
+#ifndef __OBJ_LOADER_H__
+#define __OBJ_LOADER_H__ 1
+
+#include <string>
+#include <vector>
+#include "mesh.h"
+
+// Native Wavefront OBJ/MTL reader. Maps the file, parses line aligned chunks
+// in parallel on the ThreadPool and builds the same meshes ASSIMP does with
+// aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace,
+// one per object and material, without going through an aiScene.
+//
+// Quads are split like ASSIMP does. Larger polygons are ear clipped following
+// aiProcess_Triangulate, concave ones included, but the triangles have not been
+// compared with ASSIMP's output, tests/AG09_01 reports the difference.
+class ObjLoader {
+public:
+	// Textures only have type and path, as Model::MeshData
+	struct ObjMesh {
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		std::vector<Texture> textures;
+	};
+
+	// Returns false if the file can not be read or references missing data
+	bool load(const std::string& path);
+
+	std::vector<ObjMesh>& meshes() { return meshes_; }
+
+	// Names of the MTL files an OBJ text references, relative to its directory
+	static std::vector<std::string> materialLibraries(const char* data, const size_t size);
+
+private:
+	std::vector<ObjMesh> meshes_;
+};
+
+#endif
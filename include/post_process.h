@@ -0,0 +1,101 @@
+#ifndef __POST_PROCESS_H__
+#define __POST_PROCESS_H__ 1
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "gl_handle.h"
+#include "shader.h"
+
+class RenderGraph;
+
+// Full screen effects applied one after the other, ping-ponging between two targets
+// of the chain's size that are only allocated by the first apply and resize. Added to a
+// RenderGraph instead, every pass writes a graph target and the graph aliases them.
+//
+// Effects are turned into as few passes as possible when the chain is built. Per pixel
+// effects need no neighbours and are fused into the pass before them, or into one
+// copy pass at the start. A separable kernel is a horizontal and a vertical pass,
+// 2 * (2 * radius + 1) taps instead of (2 * radius + 1)^2.
+//
+// Kernels run at scale times the chain's size by drawing into part of the targets, the
+// passes after them read that part back with bilinear filtering.
+class PostProcessChain {
+public:
+	PostProcessChain(const uint32_t width, const uint32_t height);
+
+	// Reallocates the targets when the size changes and apply made them
+	void resize(const uint32_t width, const uint32_t height);
+
+	// Effects apply in the order added, each add returns the index of the effect.
+	// code is GLSL statements changing vec4 color, the pixel being processed. It may
+	// call sampleSource(vec2 uv) and use uv, texelSize and the uniforms declared in uniforms
+	uint32_t addPixel(const std::string& code, const std::string& uniforms = std::string());
+	// 3x3 convolution, weights row by row from the top
+	uint32_t addKernel(const float weights[9], const float scale = 1.0f);
+	// Symmetric separable convolution, weights[0] is the center and weights[i] the taps i
+	// texels away on both sides
+	uint32_t addSeparable(const std::vector<float>& weights, const float scale = 1.0f);
+	uint32_t addGaussian(const uint32_t radius, const float sigma, const float scale = 1.0f);
+	void clear();
+
+	// Generates and compiles the passes, apply does it when effects changed since
+	void build();
+	// Runs the chain on source, a texture of the chain's size, and writes the result to
+	// framebuffer target. Leaves the viewport covering the chain
+	void apply(const uint32_t source, const uint32_t target);
+	// Adds one pass per built pass to graph, the first reading target source, the last
+	// writing the graph's output. The chain must outlive the graph and not change meanwhile
+	void addToGraph(RenderGraph* graph, const uint32_t source);
+
+	// Of the last build
+	uint32_t numPasses() const { return static_cast<uint32_t>(passes_.size()); }
+	// Shader running effect, to set the uniforms of a per pixel effect. Valid after build
+	const Shader& effectShader(const uint32_t effect) const { return *passes_[effectPasses_[effect]].shader; }
+
+	// Normalized weights of a Gaussian for addSeparable
+	static std::vector<float> gaussianWeights(const uint32_t radius, const float sigma);
+
+private:
+	enum class Kind {
+		Pixel,
+		Kernel,
+		Separable,
+	};
+
+	struct Effect {
+		Kind kind;
+		std::string code;
+		std::string uniforms;
+		std::vector<float> weights;
+		float scale;
+	};
+
+	struct Pass {
+		std::string sampling;	// GLSL setting color from the source
+		std::string code;	// Fused per pixel effects
+		std::string uniforms;
+		float scale;
+		std::unique_ptr<Shader> shader;
+	};
+
+	void createTargets();
+	// Appends a pass reading the source with sampling
+	void addPass(const std::string& sampling, const float scale);
+	// Draws pass into the bound framebuffer, input covers inputScale of its texture
+	void drawPass(const Pass& pass, const uint32_t input, const glm::vec2& inputScale,
+		const glm::vec2& texelSize, const glm::vec2& size) const;
+
+	uint32_t width_, height_;
+	GLTexture textures_[2];
+	GLFramebuffer framebuffers_[2];
+	GLVertexArray emptyVAO_;	// Core profiles draw with some VAO bound
+
+	std::vector<Effect> effects_;
+	std::vector<Pass> passes_;
+	std::vector<uint32_t> effectPasses_;	// Pass of the last part of each effect
+	bool dirty_ = false;
+};
+
+#endif
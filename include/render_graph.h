@@ -0,0 +1,96 @@
+#ifndef __RENDER_GRAPH_H__
+#define __RENDER_GRAPH_H__ 1
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "gl_handle.h"
+
+struct RenderGraphStats {
+	uint32_t passes = 0;	// Run by execute
+	uint32_t culled = 0;	// Nothing alive reads what they write
+	uint32_t targets = 0;	// Used by the passes run
+	uint32_t textures = 0;	// Allocated for them
+	size_t bytes = 0;
+	size_t unaliasedBytes = 0;	// With a texture per target
+};
+
+// Frame described as passes declaring the targets they read and write, set up once
+// and compiled, then executed every frame without allocating.
+//
+// compile works out what the frame needs:
+//   passes whose writes nothing reads are culled, walking back from the output passes
+//   each target lives from the first to the last pass using it
+//   targets of the same format and scale whose lifetimes do not overlap share a texture,
+//   GL 3.3 has no memory aliasing so sharing the object is the alias
+//   every pass gets a framebuffer with its writes attached, colors in write order
+//
+// Targets are textures sized scale times the graph's size, resize recreates them.
+// Passes clear what they write themselves, an aliased texture holds the last user's data.
+class RenderGraph {
+public:
+	typedef std::function<void(const RenderGraph&)> Execute;
+
+	RenderGraph(const uint32_t width, const uint32_t height);
+
+	// format is a sized internal format, GL_RGBA8, GL_DEPTH_COMPONENT24...
+	uint32_t addTarget(const std::string& name, const uint32_t format, const float scale = 1.0f);
+	// Passes run in the order added
+	uint32_t addPass(const std::string& name, Execute execute);
+	void read(const uint32_t pass, const uint32_t target);
+	void write(const uint32_t pass, const uint32_t target);
+	// The pass draws into framebuffer output, it is never culled
+	void writeOutput(const uint32_t pass);
+
+	void compile();
+	void resize(const uint32_t width, const uint32_t height);
+	// Binds the framebuffer and viewport of each pass and runs it, compiling if needed
+	void execute(const uint32_t output = 0);
+
+	// Texture of target, for passes to bind the targets they read
+	uint32_t texture(const uint32_t target) const;
+	uint32_t width() const { return width_; }
+	uint32_t height() const { return height_; }
+
+	// Of the last compile
+	const RenderGraphStats& stats() const { return stats_; }
+
+private:
+	struct Target {
+		std::string name;
+		uint32_t format;
+		float scale;
+		uint32_t first, last;	// Passes using it, first > last if none
+		uint32_t texture;	// Index in textures_
+	};
+
+	struct Pass {
+		std::string name;
+		Execute execute;
+		std::vector<uint32_t> reads;
+		std::vector<uint32_t> writes;
+		bool output;
+		bool alive;
+		GLFramebuffer framebuffer;
+	};
+
+	struct Texture {
+		uint32_t format;
+		float scale;
+		uint32_t last;	// Last pass of the targets sharing it
+		GLTexture texture;
+	};
+
+	// Creates the textures and attaches them to the framebuffers
+	void allocate();
+
+	uint32_t width_, height_;
+	std::vector<Target> targets_;
+	std::vector<Pass> passes_;
+	std::vector<Texture> textures_;
+	bool compiled_ = false;
+	RenderGraphStats stats_;
+};
+
+#endif
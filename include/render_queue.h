@@ -0,0 +1,88 @@
+#ifndef __RENDER_QUEUE_H__
+#define __RENDER_QUEUE_H__ 1
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+
+class Mesh;
+class Shader;
+
+// Passes are drawn in this order. Opaque draws go front to back, transparent ones back to front
+enum class RenderPass : uint8_t {
+	Opaque = 0,
+	Transparent = 1,
+};
+
+// State changes a list of draws needs
+struct RenderQueueStats {
+	uint32_t draws = 0;
+	uint32_t programChanges = 0;
+	uint32_t textureChanges = 0;	// Whole texture sets bound
+	uint32_t vertexArrayChanges = 0;
+};
+
+// Collects the draws of a frame and submits them sorted by a 64 bit key
+// made of pass, program, texture set, VAO and depth, so state only changes
+// when it has to. Shaders need their per frame uniforms set before flush,
+// the queue sets "model" and, when the shader has it, "normalMat".
+class RenderQueue {
+public:
+	// Bits of each key field, from the most significant down
+	static const uint32_t k_PassBits = 4;
+	static const uint32_t k_ProgramBits = 10;
+	static const uint32_t k_TextureBits = 14;
+	static const uint32_t k_VertexArrayBits = 12;
+	static const uint32_t k_DepthBits = 24;
+
+	// Starts a frame seen through view, draws are sorted by their depth in it
+	void begin(const glm::mat4& view);
+
+	// Mesh drawn with its own textures and LOD from VAO, its own or the one it was merged into
+	void submit(const Mesh& mesh, const uint32_t VAO, const Shader& shader, const glm::mat4& model,
+		const RenderPass pass = RenderPass::Opaque);
+	// Draws numIndices 32 bit indices of VAO. textures[i] goes to unit i and must live until flush
+	void submit(const uint32_t VAO, const uint32_t numIndices, const uint32_t* textures, const uint32_t numTextures,
+		const Shader& shader, const glm::mat4& model, const RenderPass pass = RenderPass::Opaque);
+
+	// Sorts and draws everything submitted since begin
+	void flush();
+
+	// What the last flush would have changed in submission order, and what it changed sorted
+	const RenderQueueStats& submittedStats() const { return submittedStats_; }
+	const RenderQueueStats& sortedStats() const { return sortedStats_; }
+	// Writes both to std::cout
+	void printStats() const;
+
+private:
+	struct DrawItem {
+		const Shader* shader;
+		const Mesh* mesh;	// Null for raw draws
+		const uint32_t* textures;
+		uint32_t numTextures;
+		uint32_t numIndices;
+		uint32_t VAO;
+		uint32_t program;
+		uint64_t textureSet;	// Hash of the texture ids with their samplers and units
+		glm::mat4 model;
+	};
+	struct SortEntry {
+		uint64_t key;
+		uint32_t item;
+	};
+	void push(DrawItem&& item, const glm::vec3& center, const RenderPass pass);
+	// Small id for value that fits in bits, numbered in submission order from begin
+	static uint32_t compactId(std::unordered_map<uint64_t, uint32_t>* ids, const uint64_t value, const uint32_t bits);
+	// LSD radix sort of entries_ by key, one byte per pass
+	void sortEntries();
+	RenderQueueStats countChanges(const std::vector<SortEntry>& entries) const;
+
+	glm::mat4 view_ = glm::mat4(1.0f);
+	std::vector<DrawItem> items_;
+	std::vector<SortEntry> entries_, scratch_;
+	std::unordered_map<uint64_t, uint32_t> programIds_, textureSetIds_, vertexArrayIds_;
+	RenderQueueStats submittedStats_, sortedStats_;
+};
+
+#endif
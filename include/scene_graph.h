@@ -0,0 +1,49 @@
+#ifndef __SCENE_GRAPH_H__
+#define __SCENE_GRAPH_H__ 1
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Parent of the root nodes
+const uint32_t k_NoParent = ~0u;
+
+// Transform hierarchy stored as flat arrays in depth first order, so every parent
+// comes before its children and the subtree of a node is the range after it.
+// Changing a node only recomputes its subtree on the next update
+class SceneGraph {
+public:
+	// Appends a node under parent, which must be k_NoParent, the last node added or one
+	// of its ancestors. The node owns the meshes [firstMesh, firstMesh + numMeshes) of
+	// the list the graph belongs to. Returns the node index, k_NoParent on errors
+	uint32_t addNode(const uint32_t parent, const glm::mat4& local, const uint32_t firstMesh = 0,
+		const uint32_t numMeshes = 0);
+	void clear();
+
+	uint32_t size() const { return static_cast<uint32_t>(parents_.size()); }
+	uint32_t parent(const uint32_t node) const { return parents_[node]; }
+	// One past the last node of the subtree of node
+	uint32_t subtreeEnd(const uint32_t node) const { return subtreeEnds_[node]; }
+	uint32_t firstMesh(const uint32_t node) const { return firstMeshes_[node]; }
+	uint32_t numMeshes(const uint32_t node) const { return numMeshes_[node]; }
+
+	const glm::mat4& local(const uint32_t node) const { return locals_[node]; }
+	// Transform to the space of the roots, as of the last update
+	const glm::mat4& world(const uint32_t node) const { return worlds_[node]; }
+
+	// Replaces the transform relative to the parent, the subtree is updated later
+	void setLocal(const uint32_t node, const glm::mat4& local);
+
+	// Recomputes the world transforms of the changed subtrees, each in one forward pass.
+	// Appends the recomputed nodes to updated when given. Returns how many there were
+	uint32_t update(std::vector<uint32_t>* updated = nullptr);
+
+private:
+	std::vector<uint32_t> parents_, subtreeEnds_;
+	std::vector<uint32_t> firstMeshes_, numMeshes_;
+	std::vector<glm::mat4> locals_, worlds_;
+	std::vector<uint8_t> dirty_;	// Per node, set on the nodes setLocal changed
+	std::vector<uint32_t> dirtyNodes_;	// The nodes dirty_ is set on
+};
+
+#endif
@@ -1,9 +1,37 @@
 #ifndef __SHADER_H__
-#define __SHADER_H_ 1
+#define __SHADER_H__ 1
 
 #include <glm/glm.hpp>
 #include <string>
 #include <vector>
+#include "hash.h"
+
+// Uniform name as its hash. Literals hash at compile time when the
+// name is constexpr, e.g. constexpr UniformName k_Model("model")
+struct UniformName {
+	constexpr UniformName(const char* name) : hash(hashString(name)) {}
+
+	uint64_t hash;
+};
+
+// Tags the Shader constructor taking GLSL code instead of paths
+struct FromSource {};
+
+// Bump whenever the layout of the program cache files changes
+const uint32_t k_ProgramCacheVersion = 1;
+// Files the program cache keeps at most, a program takes the slot its key picks
+const uint32_t k_ProgramCacheSlots = 64;
+
+struct ProgramCacheStats {
+	uint32_t loaded = 0;	// Programs read back from the cache, nothing compiled
+	uint32_t compiled = 0;
+	uint32_t rejected = 0;	// Cached binaries the driver refused, compiled instead
+};
+
+struct UniformStats {
+	uint32_t sets = 0;
+	uint32_t uploads = 0;	// Values that changed and went to GL
+};
 
 class Shader {
 	enum class Type {
@@ -11,37 +39,93 @@ class Shader {
 		Fragment = 1,
 		Geometry = 2,
 		Program = 3,
+		Compute = 4,
 	};
 
 	public:
 		Shader() = delete;	//Delete Shader without parameters
 		Shader(const char* vertexPath, const char* fragmentPath,
 			const char* geometryPath = nullptr);
+		// Program from code generated at run time
+		Shader(FromSource, const char* vertexCode, const char* fragmentCode,
+			const char* geometryCode = nullptr);
+		// Compute program, needs a GL 4.3 context
+		explicit Shader(const char* computePath);
 		~Shader();
 
 		void use() const;
+		uint32_t id() const { return id_; }
 
-		void set(const char* name, const bool value) const;
-		void set(const char* name, const int value) const;
-		void set(const char* name, const float value) const;
-		void set(const char* name, const float value1, const float value2) const;
-		void set(const char* name, const float value1, const float value2,
+		void set(const UniformName name, const bool value) const;
+		void set(const UniformName name, const int value) const;
+		void set(const UniformName name, const float value) const;
+		void set(const UniformName name, const float value1, const float value2) const;
+		void set(const UniformName name, const float value1, const float value2,
 			const float value3) const;
-		void set(const char* name, const float value1, const float value2,
+		void set(const UniformName name, const float value1, const float value2,
 			const float value3, const float value4) const;
-		void set(const char* name, const glm::vec2& value) const;
-		void set(const char* name, const glm::vec3& value) const;
-		void set(const char* name, const glm::vec4& value) const;
-		void set(const char* name, const glm::mat2& value) const;
-		void set(const char* name, const glm::mat3& value) const;
-		void set(const char* name, const glm::mat4& value) const;
+		void set(const UniformName name, const glm::vec2& value) const;
+		void set(const UniformName name, const glm::vec3& value) const;
+		void set(const UniformName name, const glm::vec4& value) const;
+		void set(const UniformName name, const glm::mat2& value) const;
+		void set(const UniformName name, const glm::mat3& value) const;
+		void set(const UniformName name, const glm::mat4& value) const;
+
+		// Whether the linked program has an active uniform called name
+		bool hasUniform(const UniformName name) const;
+
+		// Every set call and the glUniform calls it needed, for all shaders since the last reset.
+		// Without the cache each set was a glGetUniformLocation and a glUniform
+		static const UniformStats& stats() { return stats_; }
+		static void resetStats() { stats_ = UniformStats(); }
+
+		// Linked programs are stored in directory, shader_cache by default and created when
+		// missing, under a key hashing the code of every stage, defines included, and the driver.
+		// A program whose key is there is loaded with glProgramBinary instead of compiled.
+		// The key picks one of k_ProgramCacheSlots files and a program with another key
+		// replaces it, so regenerated code never grows the directory. Empty turns the cache
+		// off. Needs GL 4.1 or ARB_get_program_binary, without them every program is compiled
+		static void setProgramCache(const std::string& directory) { cacheDirectory_ = directory; }
+		static const ProgramCacheStats& cacheStats() { return cacheStats_; }
 
 	private:
+		// Location and last value of an active uniform
+		struct Uniform {
+			uint64_t hash;
+			int32_t location;	// -1 marks an empty slot
+			uint32_t offset;	// Start of the value in shadow_, in words
+			uint32_t words;
+			bool known;	// False until the first set, GL may hold anything
+		};
+
 		void checkErrors(const uint32_t shader, const Type type) const;
 		void loadShader(const char* path, std::string* code);
+		// Compiles and links the stages into id_, or loads them from the program cache
+		void build(const char* vertexCode, const char* fragmentCode, const char* geometryCode);
+		// Cache key of the stage codes, null for a missing stage. 0 when the cache is off
+		static uint64_t programKey(const char* const* codes, const uint32_t numCodes);
+		// Creates id_ from the cached binary of key, false when missing or rejected
+		bool loadProgram(const uint64_t key);
+		// Links the attached stages into id_ and caches the result under key
+		void linkProgram(const uint64_t key);
+		void storeProgram(const uint64_t key) const;
+		// Uniform table and shared blocks of the just linked program
+		void setupProgram();
+		// Fills the uniform table from the linked program
+		void reflectUniforms();
+		Uniform* findUniform(const UniformName name) const;
+		// Location to upload value to, or -1 when the uniform is missing or already holds it
+		int32_t changedLocation(const UniformName name, const void* value, const uint32_t words) const;
 
 		std::vector<Shader> list_;
 		uint32_t id_;
+		// Open addressing table, a power of two at most half full
+		mutable std::vector<Uniform> uniforms_;
+		mutable std::vector<uint32_t> shadow_;
+
+		static UniformStats stats_;
+		static std::string cacheDirectory_;
+		static ProgramCacheStats cacheStats_;
 };
 
 #endif
\ No newline at end of file
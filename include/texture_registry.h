@@ -0,0 +1,50 @@
+#ifndef __TEXTURE_REGISTRY_H__
+#define __TEXTURE_REGISTRY_H__ 1
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class UploadService;
+
+// GL texture shared by every user of the same image, deleted with its last handle
+struct TextureResource {
+	~TextureResource();
+
+	uint32_t id = 0;	// 0 while a streamed upload is pending
+	std::vector<std::string> paths;	// Canonical absolute paths it was requested by
+	uint64_t contentHash = 0;
+};
+
+typedef std::shared_ptr<TextureResource> TextureHandle;
+
+// Process-wide table of loaded textures keyed by canonical path, so an image
+// is decoded and uploaded once no matter how many models use it.
+// Main thread only.
+class TextureRegistry {
+public:
+	static TextureRegistry& instance();
+
+	// Returns the texture for path, loading it if nobody holds it yet
+	// With uploads the image streams in the background and id stays 0 until it lands
+	TextureHandle acquire(const std::string& path, UploadService* uploads = nullptr);
+
+	// Also match files by a hash of their contents, catches copies under other paths
+	void setHashContents(const bool hashContents) { hashContents_ = hashContents; }
+
+	// Number of live textures
+	size_t size() const { return count_; }
+
+private:
+	friend struct TextureResource;
+	void release(const TextureResource& resource);
+
+	std::unordered_map<std::string, std::weak_ptr<TextureResource>> byPath_;
+	std::unordered_map<uint64_t, std::weak_ptr<TextureResource>> byContent_;
+	size_t count_ = 0;
+	bool hashContents_ = false;
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__ 1
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for CPU-only work (no GL calls)
+class ThreadPool {
+public:
+	// Shared pool sized to the number of hardware threads
+	static ThreadPool& instance();
+
+	explicit ThreadPool(const uint32_t numThreads);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Runs job(i) for every i in [0, count) and waits for all of them
+	// The calling thread works too, so it is safe to call with no workers
+	void parallelFor(const uint32_t count, const std::function<void(uint32_t)>& job);
+
+	uint32_t numThreads() const { return static_cast<uint32_t>(workers_.size()) + 1; }
+
+private:
+	void workerLoop();
+	void runJobs();
+
+	std::vector<std::thread> workers_;
+	std::mutex mutex_;
+	std::condition_variable wake_, done_;
+	std::mutex callMutex_;	// One parallelFor at a time
+
+	const std::function<void(uint32_t)>* job_ = nullptr;
+	uint32_t count_ = 0;
+	std::atomic<uint32_t> next_{ 0 };
+	uint32_t busy_ = 0;
+	uint64_t generation_ = 0;
+	bool quit_ = false;
+};
+
+#endif
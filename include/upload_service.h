@@ -0,0 +1,82 @@
+#ifndef __UPLOAD_SERVICE_H__
+#define __UPLOAD_SERVICE_H__ 1
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct GLFWwindow;
+struct __GLsync;
+
+// Streams buffers and textures to the GPU from a second GL context that shares
+// objects with the main one. The worker signals each finished job with a fence,
+// update() runs the completion callbacks on the main thread once it has passed.
+// Destroy it before glfwTerminate, jobs still pending then never call back and
+// the objects they made are deleted.
+class UploadService {
+public:
+	// Must be created on the main thread, after the window's context
+	explicit UploadService(GLFWwindow* mainWindow, const size_t bytesPerFrame = 8 * 1024 * 1024);
+	~UploadService();
+
+	UploadService(const UploadService&) = delete;
+	UploadService& operator=(const UploadService&) = delete;
+
+	// Uploads the arrays into a new VBO/EBO pair, data is copied before returning
+	void uploadMesh(const void* vertices, const size_t verticesSize, const void* indices,
+		const size_t indicesSize, std::function<void(uint32_t VBO, uint32_t EBO)> onReady);
+	// Decodes the image file and uploads it as a mipmapped 2D texture
+	void uploadTexture(const std::string& path, std::function<void(uint32_t id)> onReady);
+
+	// Call once per frame on the main thread. Runs the callbacks of finished jobs
+	// until budgetMs is spent and allows the worker to stream bytesPerFrame more
+	void update(const double budgetMs);
+
+	// True when nothing is queued, in flight or waiting for its callback
+	bool idle();
+
+private:
+	struct Job {
+		std::vector<uint8_t> vertices, indices;
+		std::function<void(uint32_t, uint32_t)> onMeshReady;
+		std::string path;
+		std::function<void(uint32_t)> onTextureReady;
+	};
+
+	struct Completion {
+		__GLsync* fence;
+		std::function<void()> finish;
+		uint32_t buffers[2];	// What finish hands over, deleted when it never runs
+		uint32_t texture;
+	};
+
+	void workerLoop();
+	void uploadMeshJob(Job& job);
+	void uploadTextureJob(Job& job);
+	// Copies size bytes into the bound GL_COPY_WRITE_BUFFER through the staging buffer
+	void streamBuffer(const uint8_t* data, const size_t size);
+	// Blocks until the frame budget has room for more bytes
+	void acquire(const size_t bytes);
+	// Queues finish behind a fence, with the objects it hands over
+	void complete(std::function<void()> finish, const uint32_t VBO, const uint32_t EBO, const uint32_t texture);
+
+	GLFWwindow* context_;
+	std::thread worker_;
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::deque<Job> jobs_;
+	std::deque<Completion> completions_;
+	uint32_t inFlight_ = 0;
+	const size_t bytesPerFrame_;
+	int64_t credit_;
+	bool quit_ = false;
+
+	uint32_t staging_ = 0, pbo_ = 0;	// Owned by the worker context
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef __VERTEX_PACKING_H__
+#define __VERTEX_PACKING_H__ 1
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "mesh.h"
+
+// Compact 20 byte version of Vertex. Shaders reading it must decode
+// positionOffset + positionScale * aPos.xyz, the octahedral normal and
+// tangent, and rebuild the bitangent as cross(N, T) * aPos.w
+struct PackedVertex {
+	int16_t Position[4];	// Snorm xyz inside the mesh AABB, w is the tangent handedness
+	int16_t Normal[2];	// Snorm octahedral
+	uint16_t TexCoords[2];	// Half floats
+	int16_t Tangent[2];	// Snorm octahedral
+};
+
+// Undoes the position quantization: offset + scale * q
+struct PositionDecode {
+	glm::vec3 scale = glm::vec3(1.0f);
+	glm::vec3 offset = glm::vec3(0.0f);
+};
+
+// Converts between Vertex and PackedVertex, and 32 to 16 bit indices
+class VertexPacking {
+public:
+	// Meshes with fewer vertices than this get 16 bit indices
+	static const uint32_t k_ShortIndexLimit = 65536;
+
+	// Quantizes the vertices against their AABB, returns how to decode the positions
+	static PositionDecode packVertices(const Vertex* vertices, const uint32_t numVertices, PackedVertex* packed);
+	// Expands a packed vertex back to floats, the bitangent is rebuilt
+	static Vertex unpackVertex(const PackedVertex& packed, const PositionDecode& decode);
+
+	// Indices must be below k_ShortIndexLimit
+	static void packIndices(const uint32_t* indices, const uint32_t numIndices, uint16_t* packed);
+
+	// Octahedral mapping of a unit vector to snorm16, picks the rounding closest to n
+	static void encodeOctahedral(const glm::vec3& n, int16_t* encoded);
+	static glm::vec3 decodeOctahedral(const int16_t* encoded);
+};
+
+#endif
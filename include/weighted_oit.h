@@ -0,0 +1,44 @@
+#ifndef __WEIGHTED_OIT_H__
+#define __WEIGHTED_OIT_H__ 1
+
+#include <cstdint>
+#include "gl_handle.h"
+
+class Shader;
+
+// Weighted blended order independent transparency (McGuire and Bavoil 2013).
+// Transparent surfaces are drawn in any order into an accumulation target, one
+// composite pass then blends their weighted average over the opaque image. Needs no
+// sorting, but stacked surfaces only approximate the sorted result, a RenderQueue
+// Transparent pass draws them exactly back to front.
+//
+// Transparent shaders write two outputs, see tests/AG10_03/blend_oit.fs:
+//   location 0: vec4(color.rgb * color.a * weight, color.a)
+//   location 1: vec4(color.a * weight)
+class WeightedOit {
+public:
+	WeightedOit(const uint32_t width, const uint32_t height);
+
+	// Recreates the targets when the size changes
+	void resize(const uint32_t width, const uint32_t height);
+
+	// Copies the depth of the opaque framebuffer source, which must be DEPTH24_STENCIL8 like
+	// the default one, clears the targets and sets up their blending. Depth writes stay off
+	// until composite
+	void begin(const uint32_t source);
+	// Blends the transparent surfaces over framebuffer target with shader, a full screen
+	// triangle reading the accumulation from unit 0 and the weights from unit 1
+	void composite(const Shader& shader, const uint32_t target);
+
+private:
+	void createTargets();
+
+	uint32_t width_, height_;
+	GLFramebuffer framebuffer_;
+	GLTexture accumulation_;	// Weighted premultiplied color, revealage in alpha
+	GLTexture weights_;	// Sum of the alpha weights
+	GLRenderbuffer depth_;
+	GLVertexArray emptyVAO_;	// Core profiles draw with some VAO bound
+};
+
+#endif
@@ -0,0 +1,281 @@
+#include "clustered_lights.h"
+#include "cpu_features.h"
+#include "gl_state.h"
+#include "shader.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifdef SIMD_X64
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const uint32_t k_Lanes = 8;
+const float k_CutoffIntensity = 1.0f / 256.0f;
+const uint32_t k_TexelsPerLight = 4;
+
+constexpr UniformName k_LightsUniform("clusterLights");
+constexpr UniformName k_RangesUniform("clusterRanges");
+constexpr UniformName k_IndicesUniform("clusterIndices");
+constexpr UniformName k_GridUniform("clusterGrid");
+constexpr UniformName k_TileScaleUniform("clusterTileScale");
+constexpr UniformName k_DepthScaleUniform("clusterDepthScale");
+
+#ifndef SIMD_X64
+
+// Distance from each sphere center to the box, squared, against the squared radius
+uint32_t testSpheresScalar(const float* x, const float* y, const float* z, const float* radius, const uint32_t count,
+	const glm::vec3& min, const glm::vec3& max, uint32_t* passed) {
+	uint32_t numPassed = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		const float dx = std::max(std::max(min.x - x[i], 0.0f), x[i] - max.x);
+		const float dy = std::max(std::max(min.y - y[i], 0.0f), y[i] - max.y);
+		const float dz = std::max(std::max(min.z - z[i], 0.0f), z[i] - max.z);
+		if (dx * dx + dy * dy + dz * dz <= radius[i] * radius[i]) passed[numPassed++] = i;
+	}
+	return numPassed;
+}
+
+#else
+
+TARGET_AVX2 uint32_t testSpheresAvx2(const float* x, const float* y, const float* z, const float* radius,
+	const uint32_t count, const glm::vec3& min, const glm::vec3& max, uint32_t* passed) {
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 minX = _mm256_set1_ps(min.x), minY = _mm256_set1_ps(min.y), minZ = _mm256_set1_ps(min.z);
+	const __m256 maxX = _mm256_set1_ps(max.x), maxY = _mm256_set1_ps(max.y), maxZ = _mm256_set1_ps(max.z);
+	uint32_t numPassed = 0;
+	for (uint32_t i = 0; i < count; i += k_Lanes) {
+		const __m256 cx = _mm256_loadu_ps(x + i), cy = _mm256_loadu_ps(y + i), cz = _mm256_loadu_ps(z + i);
+		const __m256 r = _mm256_loadu_ps(radius + i);
+		const __m256 dx = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(minX, cx), zero), _mm256_sub_ps(cx, maxX));
+		const __m256 dy = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(minY, cy), zero), _mm256_sub_ps(cy, maxY));
+		const __m256 dz = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(minZ, cz), zero), _mm256_sub_ps(cz, maxZ));
+		const __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+			_mm256_mul_ps(dz, dz));
+		uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(distance, _mm256_mul_ps(r, r), _CMP_LE_OQ)));
+		// Lanes past the end hold stale spheres
+		if (count - i < k_Lanes) mask &= (1u << (count - i)) - 1;
+		for (uint32_t lane = 0; mask; lane++, mask >>= 1) {
+			if (mask & 1) passed[numPassed++] = i + lane;
+		}
+	}
+	return numPassed;
+}
+
+uint32_t testSpheresSse(const float* x, const float* y, const float* z, const float* radius, const uint32_t count,
+	const glm::vec3& min, const glm::vec3& max, uint32_t* passed) {
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 minX = _mm_set1_ps(min.x), minY = _mm_set1_ps(min.y), minZ = _mm_set1_ps(min.z);
+	const __m128 maxX = _mm_set1_ps(max.x), maxY = _mm_set1_ps(max.y), maxZ = _mm_set1_ps(max.z);
+	uint32_t numPassed = 0;
+	for (uint32_t i = 0; i < count; i += 4) {
+		const __m128 cx = _mm_loadu_ps(x + i), cy = _mm_loadu_ps(y + i), cz = _mm_loadu_ps(z + i);
+		const __m128 r = _mm_loadu_ps(radius + i);
+		const __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minX, cx), zero), _mm_sub_ps(cx, maxX));
+		const __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minY, cy), zero), _mm_sub_ps(cy, maxY));
+		const __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minZ, cz), zero), _mm_sub_ps(cz, maxZ));
+		const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(distance, _mm_mul_ps(r, r))));
+		if (count - i < 4) mask &= (1u << (count - i)) - 1;
+		for (uint32_t lane = 0; mask; lane++, mask >>= 1) {
+			if (mask & 1) passed[numPassed++] = i + lane;
+		}
+	}
+	return numPassed;
+}
+
+#endif
+
+uint32_t createBufferTexture(const GLenum format, const uint32_t buffer) {
+	uint32_t texture;
+	glGenTextures(1, &texture);
+	GLState::bindTexture(0, texture, GL_TEXTURE_BUFFER);
+	glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+	return texture;
+}
+
+uint32_t createBuffer() {
+	uint32_t buffer;
+	glGenBuffers(1, &buffer);
+	// The buffer texture needs a data store
+	GLState::bindBuffer(GL_TEXTURE_BUFFER, buffer);
+	glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+	return buffer;
+}
+
+template <typename T>
+void uploadBuffer(const uint32_t buffer, const std::vector<T>& data) {
+	// Orphans last frame's store, the GPU may still read it
+	GLState::bindBuffer(GL_TEXTURE_BUFFER, buffer);
+	glBufferData(GL_TEXTURE_BUFFER, std::max<size_t>(data.size() * sizeof(T), 16), nullptr, GL_STREAM_DRAW);
+	if (!data.empty()) glBufferSubData(GL_TEXTURE_BUFFER, 0, data.size() * sizeof(T), data.data());
+}
+
+}
+
+void ClusteredLights::SphereList::push(const float sx, const float sy, const float sz, const float sr,
+	const uint32_t id) {
+	// A whole group of lanes past the end stays readable
+	if (size + k_Lanes > x.size()) {
+		const size_t grown = std::max<size_t>(x.size() * 2, size + k_Lanes);
+		x.resize(grown);
+		y.resize(grown);
+		z.resize(grown);
+		radius.resize(grown);
+		ids.resize(grown);
+	}
+	x[size] = sx;
+	y[size] = sy;
+	z[size] = sz;
+	radius[size] = sr;
+	ids[size] = id;
+	size++;
+}
+
+ClusteredLights::ClusteredLights() :
+	slices_(k_Slices), ranges_(k_NumClusters) {
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels_);
+	lightBuffer_.reset(createBuffer());
+	rangeBuffer_.reset(createBuffer());
+	indexBuffer_.reset(createBuffer());
+	lightTexture_.reset(createBufferTexture(GL_RGBA32F, lightBuffer_.id()));
+	rangeTexture_.reset(createBufferTexture(GL_RG32UI, rangeBuffer_.id()));
+	indexTexture_.reset(createBufferTexture(GL_R32UI, indexBuffer_.id()));
+}
+
+float ClusteredLights::lightRadius(const PointLightData& light) {
+	const glm::vec3 color = light.ambient + light.diffuse + light.specular;
+	const float intensity = std::max(std::max(color.r, color.g), color.b);
+	// Solves constant + linear * d + quadratic * d^2 = intensity / cutoff
+	const float target = intensity / k_CutoffIntensity - light.constant;
+	if (target <= 0.0f) return 0.0f;
+	if (light.quadratic <= 0.0f) return light.linear > 0.0f ? target / light.linear : 1e30f;
+	return (-light.linear + std::sqrt(light.linear * light.linear + 4.0f * light.quadratic * target)) /
+		(2.0f * light.quadratic);
+}
+
+void ClusteredLights::buildClusters(const glm::mat4& proj) {
+	proj_ = proj;
+	near_ = proj[3][2] / (proj[2][2] - 1.0f);
+	far_ = proj[3][2] / (proj[2][2] + 1.0f);
+	const float tanX = 1.0f / proj[0][0], tanY = 1.0f / proj[1][1];
+
+	clusterMin_.resize(k_NumClusters);
+	clusterMax_.resize(k_NumClusters);
+	rowMin_.resize(k_TilesY * k_Slices);
+	rowMax_.resize(k_TilesY * k_Slices);
+	for (uint32_t slice = 0; slice < k_Slices; slice++) {
+		// Exponential slices keep clusters about as deep as they are wide
+		const float depthNear = near_ * std::pow(far_ / near_, static_cast<float>(slice) / k_Slices);
+		const float depthFar = near_ * std::pow(far_ / near_, static_cast<float>(slice + 1) / k_Slices);
+		for (uint32_t y = 0; y < k_TilesY; y++) {
+			const float bottom = (-1.0f + 2.0f * y / k_TilesY) * tanY, top = (-1.0f + 2.0f * (y + 1) / k_TilesY) * tanY;
+			const float minY = std::min(bottom * depthNear, bottom * depthFar), maxY = std::max(top * depthNear, top * depthFar);
+			const uint32_t row = slice * k_TilesY + y;
+			rowMin_[row] = glm::vec3(-tanX * depthFar, minY, -depthFar);
+			rowMax_[row] = glm::vec3(tanX * depthFar, maxY, -depthNear);
+			for (uint32_t x = 0; x < k_TilesX; x++) {
+				const float left = (-1.0f + 2.0f * x / k_TilesX) * tanX, right = (-1.0f + 2.0f * (x + 1) / k_TilesX) * tanX;
+				const uint32_t cluster = row * k_TilesX + x;
+				clusterMin_[cluster] = glm::vec3(std::min(left * depthNear, left * depthFar), minY, -depthFar);
+				clusterMax_[cluster] = glm::vec3(std::max(right * depthNear, right * depthFar), maxY, -depthNear);
+			}
+		}
+	}
+}
+
+uint32_t ClusteredLights::testSpheres(const SphereList& in, const glm::vec3& min, const glm::vec3& max,
+	uint32_t* passed) {
+#ifdef SIMD_X64
+	if (cpuHasAvx2()) {
+		return testSpheresAvx2(in.x.data(), in.y.data(), in.z.data(), in.radius.data(), in.size, min, max, passed);
+	}
+	return testSpheresSse(in.x.data(), in.y.data(), in.z.data(), in.radius.data(), in.size, min, max, passed);
+#else
+	return testSpheresScalar(in.x.data(), in.y.data(), in.z.data(), in.radius.data(), in.size, min, max, passed);
+#endif
+}
+
+void ClusteredLights::update(const PointLightData* lights, const uint32_t numLights, const glm::mat4& view,
+	const glm::mat4& proj) {
+	stats_ = ClusterStats();
+	if (proj != proj_) buildClusters(proj);
+
+	// Lights the buffer texture has no room for are left out
+	const uint32_t maxLights = std::min(numLights, static_cast<uint32_t>(maxTexels_) / k_TexelsPerLight);
+	texels_.resize(maxLights * k_TexelsPerLight);
+	for (SphereList& slice : slices_) slice.clear();
+	const float sliceScale = k_Slices / std::log(far_ / near_);
+	for (uint32_t i = 0; i < maxLights; i++) {
+		const float radius = lightRadius(lights[i]);
+		memcpy(&texels_[i * k_TexelsPerLight], &lights[i], sizeof(PointLightData));
+		texels_[i * k_TexelsPerLight + 3].w = radius;
+
+		// Each light only goes to the slices its depth range covers
+		const glm::vec3 center = glm::vec3(view * glm::vec4(lights[i].position, 1.0f));
+		const float depthNear = std::max(-center.z - radius, near_), depthFar = std::min(-center.z + radius, far_);
+		if (depthNear > depthFar) continue;
+		const uint32_t first = std::min(static_cast<uint32_t>(std::log(depthNear / near_) * sliceScale), k_Slices - 1);
+		const uint32_t last = std::min(static_cast<uint32_t>(std::log(depthFar / near_) * sliceScale), k_Slices - 1);
+		for (uint32_t slice = first; slice <= last; slice++) {
+			slices_[slice].push(center.x, center.y, center.z, radius, i);
+		}
+		stats_.lights++;
+	}
+
+	// Slice, then row, then cluster, each level only tests what the one above passed
+	indices_.clear();
+	for (uint32_t slice = 0; slice < k_Slices; slice++) {
+		const SphereList& sliceLights = slices_[slice];
+		passed_.resize(std::max<size_t>(passed_.size(), sliceLights.size + k_Lanes));
+		for (uint32_t y = 0; y < k_TilesY; y++) {
+			const uint32_t row = slice * k_TilesY + y;
+			row_.clear();
+			const uint32_t numRow = testSpheres(sliceLights, rowMin_[row], rowMax_[row], passed_.data());
+			for (uint32_t i = 0; i < numRow; i++) {
+				const uint32_t j = passed_[i];
+				row_.push(sliceLights.x[j], sliceLights.y[j], sliceLights.z[j], sliceLights.radius[j], sliceLights.ids[j]);
+			}
+
+			for (uint32_t x = 0; x < k_TilesX; x++) {
+				const uint32_t cluster = row * k_TilesX + x;
+				const uint32_t numPassed = testSpheres(row_, clusterMin_[cluster], clusterMax_[cluster], passed_.data());
+				const uint32_t offset = static_cast<uint32_t>(indices_.size());
+				const uint32_t count = std::min(numPassed, static_cast<uint32_t>(maxTexels_) - offset);
+				for (uint32_t i = 0; i < count; i++) indices_.push_back(row_.ids[passed_[i]]);
+				ranges_[cluster] = glm::uvec2(offset, count);
+				stats_.maxPerCluster = std::max(stats_.maxPerCluster, count);
+				stats_.dropped += numPassed - count;
+			}
+		}
+	}
+	stats_.references = static_cast<uint32_t>(indices_.size());
+
+	upload();
+}
+
+void ClusteredLights::upload() {
+	uploadBuffer(lightBuffer_.id(), texels_);
+	uploadBuffer(rangeBuffer_.id(), ranges_);
+	uploadBuffer(indexBuffer_.id(), indices_);
+}
+
+void ClusteredLights::bind(const Shader& shader, const uint32_t firstUnit, const uint32_t width,
+	const uint32_t height) const {
+	shader.use();
+	shader.set(k_LightsUniform, static_cast<int>(firstUnit));
+	shader.set(k_RangesUniform, static_cast<int>(firstUnit + 1));
+	shader.set(k_IndicesUniform, static_cast<int>(firstUnit + 2));
+	shader.set(k_GridUniform, glm::vec3(k_TilesX, k_TilesY, k_Slices));
+	shader.set(k_TileScaleUniform, glm::vec2(static_cast<float>(k_TilesX) / width, static_cast<float>(k_TilesY) / height));
+	// slice = log(depth) * x - y
+	const float scale = k_Slices / std::log(far_ / near_);
+	shader.set(k_DepthScaleUniform, glm::vec2(scale, scale * std::log(near_)));
+
+	GLState::bindTexture(firstUnit, lightTexture_.id(), GL_TEXTURE_BUFFER);
+	GLState::bindTexture(firstUnit + 1, rangeTexture_.id(), GL_TEXTURE_BUFFER);
+	GLState::bindTexture(firstUnit + 2, indexTexture_.id(), GL_TEXTURE_BUFFER);
+}
@@ -0,0 +1,37 @@
+#include "cpu_features.h"
+
+#ifdef SIMD_X64
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+#endif
+
+namespace {
+
+bool detectAvx2() {
+#ifdef SIMD_X64
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) return false;
+	// The OS must save the YMM registers too
+	__cpuid(info, 1);
+	const int osxsave = 1 << 27, avx = 1 << 28;
+	if ((info[2] & (osxsave | avx)) != (osxsave | avx) || (_xgetbv(0) & 6) != 6) return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+#else
+	return false;
+#endif
+}
+
+}
+
+bool cpuHasAvx2() {
+	static const bool avx2 = detectAvx2();
+	return avx2;
+}
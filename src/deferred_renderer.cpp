@@ -0,0 +1,213 @@
+#include "deferred_renderer.h"
+#include "clustered_lights.h"
+#include "frustum.h"
+#include "gl_state.h"
+#include "shader.h"
+#include <glad/glad.h>
+#include <glm/gtc/constants.hpp>
+#include <cmath>
+#include <iostream>
+
+namespace {
+
+// Light volume tessellation, coarse spheres are enough to bound a light
+const uint32_t k_VolumeRings = 8;
+const uint32_t k_VolumeSegments = 12;
+const uint32_t k_LightLocation = 1;	// Locations 1 to 4
+
+constexpr UniformName k_AlbedoSpecUniform("gAlbedoSpec");
+constexpr UniformName k_NormalUniform("gNormal");
+constexpr UniformName k_DepthUniform("gDepth");
+constexpr UniformName k_ViewProjUniform("viewProj");
+constexpr UniformName k_InvViewProjUniform("invViewProj");
+constexpr UniformName k_ScreenSizeUniform("screenSize");
+
+uint32_t createTexture(const GLenum internalFormat, const GLenum format, const GLenum type, const uint32_t width,
+	const uint32_t height) {
+	uint32_t texture;
+	glGenTextures(1, &texture);
+	GLState::bindTexture(0, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	return texture;
+}
+
+}
+
+DeferredRenderer::DeferredRenderer(const uint32_t width, const uint32_t height) :
+	width_(width), height_(height), viewProj_(1.0f) {
+	uint32_t VAO;
+	glGenVertexArrays(1, &VAO);
+	emptyVAO_.reset(VAO);
+	createTargets();
+	createVolume();
+}
+
+void DeferredRenderer::resize(const uint32_t width, const uint32_t height) {
+	if (width == width_ && height == height_) return;
+	width_ = width;
+	height_ = height;
+	createTargets();
+}
+
+void DeferredRenderer::createTargets() {
+	// 8 bytes of color per pixel, the position costs nothing as it comes from the depth
+	albedoSpec_.reset(createTexture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, width_, height_));
+	normal_.reset(createTexture(GL_RG16, GL_RG, GL_UNSIGNED_SHORT, width_, height_));
+	depth_.reset(createTexture(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, width_, height_));
+
+	uint32_t framebuffer;
+	glGenFramebuffers(1, &framebuffer);
+	framebuffer_.reset(framebuffer);
+	GLState::bindFramebuffer(framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedoSpec_.id(), 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normal_.id(), 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth_.id(), 0);
+	const GLenum buffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, buffers);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cout << "Error G-Buffer FrameBuffer Not Complete" << std::endl;
+	}
+}
+
+void DeferredRenderer::createVolume() {
+	// The flat faces of a UV sphere cut inside the round one, grown so they enclose it
+	const float grow = 1.0f / (std::cos(glm::pi<float>() / k_VolumeSegments) *
+		std::cos(glm::pi<float>() / (2.0f * k_VolumeRings)));
+	std::vector<glm::vec3> vertices;
+	for (uint32_t ring = 0; ring <= k_VolumeRings; ring++) {
+		const float theta = glm::pi<float>() * ring / k_VolumeRings;
+		for (uint32_t segment = 0; segment < k_VolumeSegments; segment++) {
+			const float phi = glm::two_pi<float>() * segment / k_VolumeSegments;
+			vertices.push_back(grow * glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta),
+				std::sin(theta) * std::sin(phi)));
+		}
+	}
+	std::vector<uint32_t> indices;
+	for (uint32_t ring = 0; ring < k_VolumeRings; ring++) {
+		for (uint32_t segment = 0; segment < k_VolumeSegments; segment++) {
+			const uint32_t next = (segment + 1) % k_VolumeSegments;
+			const uint32_t a = ring * k_VolumeSegments + segment, b = ring * k_VolumeSegments + next;
+			const uint32_t c = a + k_VolumeSegments, d = b + k_VolumeSegments;
+			// Counter clockwise seen from outside
+			indices.insert(indices.end(), { a, b, c, b, d, c });
+		}
+	}
+	numVolumeIndices_ = static_cast<uint32_t>(indices.size());
+
+	uint32_t VAO, buffers[3];
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(3, buffers);
+	volumeVAO_.reset(VAO);
+	volumeVertices_.reset(buffers[0]);
+	volumeIndices_.reset(buffers[1]);
+	lightBuffer_.reset(buffers[2]);
+
+	GLState::bindVertexArray(VAO);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), vertices.data(), GL_STATIC_DRAW);
+	GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+	glEnableVertexAttribArray(0);
+
+	// One light per instance, a PointLightData is 4 vec4
+	GLState::bindBuffer(GL_ARRAY_BUFFER, buffers[2]);
+	for (uint32_t i = 0; i < 4; i++) {
+		glVertexAttribPointer(k_LightLocation + i, 4, GL_FLOAT, GL_FALSE, sizeof(PointLightData),
+			(void*)(i * sizeof(glm::vec4)));
+		glEnableVertexAttribArray(k_LightLocation + i);
+		glVertexAttribDivisor(k_LightLocation + i, 1);
+	}
+	GLState::bindVertexArray(0);
+}
+
+void DeferredRenderer::beginGeometry() {
+	GLState::bindFramebuffer(framebuffer_.id());
+	GLState::enable(GL_DEPTH_TEST);
+	GLState::depthMask(true);
+	GLState::disable(GL_BLEND);
+	// Depth 1 marks the pixels nothing was drawn to
+	const float clear[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	glClearBufferfv(GL_COLOR, 0, clear);
+	glClearBufferfv(GL_COLOR, 1, clear);
+	glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void DeferredRenderer::beginLighting(const uint32_t target, const glm::mat4& view, const glm::mat4& proj) {
+	viewProj_ = proj * view;
+
+	// The volumes test against the scene depth. The read binding goes back to the draw one,
+	// as GLState expects
+	GLState::bindFramebuffer(target);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer_.id());
+	glBlitFramebuffer(0, 0, width_, height_, 0, 0, width_, height_, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, target);
+
+	GLState::depthMask(false);
+	GLState::enable(GL_BLEND);
+	GLState::blendFunc(GL_ONE, GL_ONE);
+}
+
+void DeferredRenderer::bindGBuffer(const Shader& shader) const {
+	shader.use();
+	shader.set(k_AlbedoSpecUniform, 0);
+	shader.set(k_NormalUniform, 1);
+	shader.set(k_DepthUniform, 2);
+	shader.set(k_ViewProjUniform, viewProj_);
+	shader.set(k_InvViewProjUniform, glm::inverse(viewProj_));
+	shader.set(k_ScreenSizeUniform, glm::vec2(width_, height_));
+	GLState::bindTexture(0, albedoSpec_.id());
+	GLState::bindTexture(1, normal_.id());
+	GLState::bindTexture(2, depth_.id());
+}
+
+void DeferredRenderer::drawFullScreen(const Shader& shader) {
+	bindGBuffer(shader);
+	GLState::disable(GL_DEPTH_TEST);
+	GLState::bindVertexArray(emptyVAO_.id());
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+void DeferredRenderer::drawLights(const Shader& shader, const PointLightData* lights, const uint32_t numLights) {
+	stats_ = DeferredStats();
+	const Frustum frustum(viewProj_);
+	visible_.clear();
+	for (uint32_t i = 0; i < numLights; i++) {
+		const float radius = ClusteredLights::lightRadius(lights[i]);
+		if (!frustum.intersects(glm::vec4(lights[i].position, radius))) {
+			stats_.culled++;
+			continue;
+		}
+		visible_.push_back(lights[i]);
+		visible_.back().padding = radius;
+	}
+	stats_.lights = static_cast<uint32_t>(visible_.size());
+	if (visible_.empty()) return;
+
+	// Orphans last frame's store, the GPU may still read it
+	GLState::bindBuffer(GL_ARRAY_BUFFER, lightBuffer_.id());
+	glBufferData(GL_ARRAY_BUFFER, visible_.size() * sizeof(PointLightData), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, visible_.size() * sizeof(PointLightData), visible_.data());
+
+	// Back faces behind the scene depth: the pixels whose surface is in front of the far side
+	// of the sphere. Still right with the camera inside it
+	bindGBuffer(shader);
+	GLState::enable(GL_DEPTH_TEST);
+	GLState::depthFunc(GL_GEQUAL);
+	GLState::enable(GL_CULL_FACE);
+	GLState::cullFace(GL_FRONT);
+	GLState::bindVertexArray(volumeVAO_.id());
+	glDrawElementsInstanced(GL_TRIANGLES, numVolumeIndices_, GL_UNSIGNED_INT, 0,
+		static_cast<GLsizei>(visible_.size()));
+	GLState::cullFace(GL_BACK);
+	GLState::depthFunc(GL_LESS);
+}
+
+void DeferredRenderer::endLighting() {
+	GLState::disable(GL_BLEND);
+	GLState::enable(GL_DEPTH_TEST);
+	GLState::depthMask(true);
+}
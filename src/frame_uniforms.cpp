@@ -0,0 +1,59 @@
+#include "frame_uniforms.h"
+#include "gl_state.h"
+#include <glad/glad.h>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// One second, a range older than k_NumRanges frames is normally long done
+const uint64_t k_FenceTimeout = 1000000000;
+
+}
+
+FrameUniforms::FrameUniforms() {
+	int32_t alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	stride_ = static_cast<uint32_t>((sizeof(FrameData) + alignment - 1) / alignment * alignment);
+
+	uint32_t buffer;
+	glGenBuffers(1, &buffer);
+	buffer_.reset(buffer);
+	GLState::bindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, stride_ * k_NumRanges, nullptr, GL_DYNAMIC_DRAW);
+}
+
+FrameUniforms::~FrameUniforms() {
+	for (__GLsync* fence : fences_) {
+		if (fence) glDeleteSync(fence);
+	}
+}
+
+void FrameUniforms::update(const FrameData& data) {
+	// Everything drawn so far read the current range
+	if (fences_[range_]) glDeleteSync(fences_[range_]);
+	fences_[range_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	range_ = (range_ + 1) % k_NumRanges;
+	if (fences_[range_]) {
+		const GLenum result = glClientWaitSync(fences_[range_], GL_SYNC_FLUSH_COMMANDS_BIT, k_FenceTimeout);
+		if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED) {
+			std::cout << "Error Waiting For Frame Uniforms" << std::endl;
+		}
+		glDeleteSync(fences_[range_]);
+		fences_[range_] = nullptr;
+	}
+
+	// The fence already covers the range, the driver needs no synchronization of its own
+	const GLintptr offset = static_cast<GLintptr>(range_) * stride_;
+	GLState::bindBuffer(GL_UNIFORM_BUFFER, buffer_.id());
+	void* mapped = glMapBufferRange(GL_UNIFORM_BUFFER, offset, sizeof(FrameData),
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (mapped) {
+		memcpy(mapped, &data, sizeof(FrameData));
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+	} else {
+		glBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(FrameData), &data);
+	}
+	GLState::bindBufferRange(GL_UNIFORM_BUFFER, k_FrameUniformBinding, buffer_.id(), offset, sizeof(FrameData));
+}
@@ -0,0 +1,171 @@
+#include "frustum.h"
+#include "cpu_features.h"
+
+#ifdef SIMD_X64
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const uint32_t k_Lanes = 8;
+
+// Distance of the box corner furthest along the plane normal, negative when the whole box is behind it
+float boxDistance(const glm::vec4& plane, const glm::vec3& center, const glm::vec3& extent) {
+	return glm::dot(glm::vec3(plane), center) + glm::dot(glm::abs(glm::vec3(plane)), extent) + plane.w;
+}
+
+#ifdef SIMD_X64
+
+TARGET_AVX2 uint32_t cullAvx2(const glm::vec4 planes[6], const float* const soa[6], const uint32_t count,
+	uint8_t* visible) {
+	uint32_t numVisible = 0;
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 signMask = _mm256_set1_ps(-0.0f);
+	for (uint32_t i = 0; i < count; i += k_Lanes) {
+		const __m256 cx = _mm256_loadu_ps(soa[0] + i), cy = _mm256_loadu_ps(soa[1] + i), cz = _mm256_loadu_ps(soa[2] + i);
+		const __m256 ex = _mm256_loadu_ps(soa[3] + i), ey = _mm256_loadu_ps(soa[4] + i), ez = _mm256_loadu_ps(soa[5] + i);
+		__m256 outside = zero;
+		for (uint32_t p = 0; p < 6; p++) {
+			const __m256 nx = _mm256_set1_ps(planes[p].x), ny = _mm256_set1_ps(planes[p].y), nz = _mm256_set1_ps(planes[p].z);
+			__m256 distance = _mm256_add_ps(_mm256_mul_ps(nx, cx), _mm256_set1_ps(planes[p].w));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(ny, cy));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(nz, cz));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_andnot_ps(signMask, nx), ex));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_andnot_ps(signMask, ny), ey));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_andnot_ps(signMask, nz), ez));
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, zero, _CMP_LT_OQ));
+		}
+		const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(outside));
+		const uint32_t lanes = count - i < k_Lanes ? count - i : k_Lanes;
+		for (uint32_t lane = 0; lane < lanes; lane++) {
+			visible[i + lane] = static_cast<uint8_t>(((mask >> lane) & 1) ^ 1);
+			numVisible += visible[i + lane];
+		}
+	}
+	return numVisible;
+}
+
+// SSE2 is part of x64, no check needed
+uint32_t cullSse(const glm::vec4 planes[6], const float* const soa[6], const uint32_t count, uint8_t* visible) {
+	uint32_t numVisible = 0;
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	for (uint32_t i = 0; i < count; i += 4) {
+		const __m128 cx = _mm_loadu_ps(soa[0] + i), cy = _mm_loadu_ps(soa[1] + i), cz = _mm_loadu_ps(soa[2] + i);
+		const __m128 ex = _mm_loadu_ps(soa[3] + i), ey = _mm_loadu_ps(soa[4] + i), ez = _mm_loadu_ps(soa[5] + i);
+		__m128 outside = zero;
+		for (uint32_t p = 0; p < 6; p++) {
+			const __m128 nx = _mm_set1_ps(planes[p].x), ny = _mm_set1_ps(planes[p].y), nz = _mm_set1_ps(planes[p].z);
+			__m128 distance = _mm_add_ps(_mm_mul_ps(nx, cx), _mm_set1_ps(planes[p].w));
+			distance = _mm_add_ps(distance, _mm_mul_ps(ny, cy));
+			distance = _mm_add_ps(distance, _mm_mul_ps(nz, cz));
+			distance = _mm_add_ps(distance, _mm_mul_ps(_mm_andnot_ps(signMask, nx), ex));
+			distance = _mm_add_ps(distance, _mm_mul_ps(_mm_andnot_ps(signMask, ny), ey));
+			distance = _mm_add_ps(distance, _mm_mul_ps(_mm_andnot_ps(signMask, nz), ez));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, zero));
+		}
+		const uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(outside));
+		const uint32_t lanes = count - i < 4 ? count - i : 4;
+		for (uint32_t lane = 0; lane < lanes; lane++) {
+			visible[i + lane] = static_cast<uint8_t>(((mask >> lane) & 1) ^ 1);
+			numVisible += visible[i + lane];
+		}
+	}
+	return numVisible;
+}
+
+#endif
+
+}
+
+Frustum::Frustum(const glm::mat4& matrix) {
+	const glm::vec4 row0(matrix[0][0], matrix[1][0], matrix[2][0], matrix[3][0]);
+	const glm::vec4 row1(matrix[0][1], matrix[1][1], matrix[2][1], matrix[3][1]);
+	const glm::vec4 row2(matrix[0][2], matrix[1][2], matrix[2][2], matrix[3][2]);
+	const glm::vec4 row3(matrix[0][3], matrix[1][3], matrix[2][3], matrix[3][3]);
+	planes[0] = row3 + row0;
+	planes[1] = row3 - row0;
+	planes[2] = row3 + row1;
+	planes[3] = row3 - row1;
+	planes[4] = row3 + row2;
+	planes[5] = row3 - row2;
+	// Unit normals, so the plane distance compares with the sphere radius
+	for (uint32_t i = 0; i < 6; i++) planes[i] /= glm::length(glm::vec3(planes[i]));
+}
+
+bool Frustum::intersects(const glm::vec4& sphere) const {
+	for (uint32_t i = 0; i < 6; i++) {
+		if (glm::dot(glm::vec3(planes[i]), glm::vec3(sphere)) + planes[i].w < -sphere.w) return false;
+	}
+	return true;
+}
+
+bool Frustum::intersects(const glm::vec3& min, const glm::vec3& max) const {
+	const glm::vec3 center = (min + max) * 0.5f, extent = (max - min) * 0.5f;
+	for (uint32_t i = 0; i < 6; i++) {
+		if (boxDistance(planes[i], center, extent) < 0.0f) return false;
+	}
+	return true;
+}
+
+void BoxList::clear() {
+	centerX_.clear();
+	centerY_.clear();
+	centerZ_.clear();
+	extentX_.clear();
+	extentY_.clear();
+	extentZ_.clear();
+	size_ = 0;
+}
+
+void BoxList::add(const glm::vec3& min, const glm::vec3& max) {
+	// Grows a whole group at a time, the padding boxes are never reported
+	if (size_ % k_Lanes == 0) {
+		const size_t padded = size_ + k_Lanes;
+		centerX_.resize(padded, 0.0f);
+		centerY_.resize(padded, 0.0f);
+		centerZ_.resize(padded, 0.0f);
+		extentX_.resize(padded, 0.0f);
+		extentY_.resize(padded, 0.0f);
+		extentZ_.resize(padded, 0.0f);
+	}
+	size_++;
+	set(size_ - 1, min, max);
+}
+
+void BoxList::set(const uint32_t index, const glm::vec3& min, const glm::vec3& max) {
+	const glm::vec3 center = (min + max) * 0.5f, extent = (max - min) * 0.5f;
+	centerX_[index] = center.x;
+	centerY_[index] = center.y;
+	centerZ_[index] = center.z;
+	extentX_[index] = extent.x;
+	extentY_[index] = extent.y;
+	extentZ_[index] = extent.z;
+}
+
+uint32_t BoxList::cull(const Frustum& frustum, uint8_t* visible) const {
+#ifdef SIMD_X64
+	const float* const soa[6] = { centerX_.data(), centerY_.data(), centerZ_.data(),
+		extentX_.data(), extentY_.data(), extentZ_.data() };
+	return cpuHasAvx2() ? cullAvx2(frustum.planes, soa, size_, visible) : cullSse(frustum.planes, soa, size_, visible);
+#else
+	uint32_t numVisible = 0;
+	for (uint32_t i = 0; i < size_; i++) {
+		const glm::vec3 center(centerX_[i], centerY_[i], centerZ_[i]), extent(extentX_[i], extentY_[i], extentZ_[i]);
+		visible[i] = 1;
+		for (uint32_t p = 0; p < 6 && visible[i]; p++) {
+			if (boxDistance(frustum.planes[p], center, extent) < 0.0f) visible[i] = 0;
+		}
+		numVisible += visible[i];
+	}
+	return numVisible;
+#endif
+}
+
+const char* BoxList::simdName() {
+#ifdef SIMD_X64
+	return cpuHasAvx2() ? "AVX2" : "SSE";
+#else
+	return "Scalar";
+#endif
+}
@@ -0,0 +1,27 @@
+#include "gl_handle.h"
+#include "gl_state.h"
+#include <glad/glad.h>
+
+void GLBufferTraits::destroy(const uint32_t id) {
+	glDeleteBuffers(1, &id);
+	GLState::forgetBuffer(id);
+}
+
+void GLVertexArrayTraits::destroy(const uint32_t id) {
+	glDeleteVertexArrays(1, &id);
+	GLState::forgetVertexArray(id);
+}
+
+void GLTextureTraits::destroy(const uint32_t id) {
+	glDeleteTextures(1, &id);
+	GLState::forgetTexture(id);
+}
+
+void GLFramebufferTraits::destroy(const uint32_t id) {
+	glDeleteFramebuffers(1, &id);
+	GLState::forgetFramebuffer(id);
+}
+
+void GLRenderbufferTraits::destroy(const uint32_t id) {
+	glDeleteRenderbuffers(1, &id);
+}
@@ -0,0 +1,275 @@
+#include "gl_state.h"
+#include <glad/glad.h>
+#include <cstring>
+
+GLStateStats GLState::stats_;
+
+namespace {
+
+const uint32_t k_Unknown = ~0u;
+const uint32_t k_MaxTextureUnits = 32;
+const uint32_t k_NumBufferTargets = 10;
+const uint32_t k_NumCapabilities = 6;
+
+struct State {
+	uint32_t program;
+	uint32_t VAO;
+	uint32_t buffers[k_NumBufferTargets];
+	uint32_t framebuffer;
+	uint32_t activeUnit;
+	uint32_t textures[k_MaxTextureUnits];
+	uint32_t textureTargets[k_MaxTextureUnits];
+	uint32_t capabilities[k_NumCapabilities];	// 0 or 1 when known
+	uint32_t blend[4];	// Color source and destination, then alpha ones
+	uint32_t depthFunc;
+	uint32_t depthMask;
+	uint32_t cullFace;
+	uint32_t stencilFunc[3];
+	uint32_t stencilOp[3];
+	uint32_t stencilMask;
+	int32_t viewport[4];
+	bool viewportKnown;
+};
+
+State makeUnknown() {
+	State state;
+	// Every field is a run of uint32_t sized values, all bits set marks them unknown
+	memset(&state, 0xFF, sizeof(state));
+	state.viewportKnown = false;
+	return state;
+}
+
+State g_State = makeUnknown();
+
+// Slot of a buffer target, k_NumBufferTargets when it is not tracked
+uint32_t bufferSlot(const uint32_t target) {
+	switch (target) {
+	case GL_ARRAY_BUFFER: return 0;
+	case GL_ELEMENT_ARRAY_BUFFER: return 1;
+	case GL_UNIFORM_BUFFER: return 2;
+	case GL_COPY_READ_BUFFER: return 3;
+	case GL_COPY_WRITE_BUFFER: return 4;
+	case GL_PIXEL_PACK_BUFFER: return 5;
+	case GL_PIXEL_UNPACK_BUFFER: return 6;
+	case GL_TEXTURE_BUFFER: return 7;
+	case 0x8F3F: return 8;	// GL_DRAW_INDIRECT_BUFFER
+	case 0x90D2: return 9;	// GL_SHADER_STORAGE_BUFFER
+	default: return k_NumBufferTargets;
+	}
+}
+
+uint32_t capabilitySlot(const uint32_t capability) {
+	switch (capability) {
+	case GL_DEPTH_TEST: return 0;
+	case GL_CULL_FACE: return 1;
+	case GL_BLEND: return 2;
+	case GL_STENCIL_TEST: return 3;
+	case GL_SCISSOR_TEST: return 4;
+	case GL_FRAMEBUFFER_SRGB: return 5;
+	default: return k_NumCapabilities;
+	}
+}
+
+void setActiveUnit(const uint32_t unit) {
+	if (g_State.activeUnit == unit) return;
+	g_State.activeUnit = unit;
+	glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+}
+
+bool GLState::cached(uint32_t* slot, const uint32_t value) {
+	stats_.calls++;
+	if (*slot == value) {
+		stats_.filtered++;
+		return true;
+	}
+	*slot = value;
+	return false;
+}
+
+void GLState::useProgram(const uint32_t program) {
+	if (!cached(&g_State.program, program)) glUseProgram(program);
+}
+
+void GLState::bindVertexArray(const uint32_t VAO) {
+	if (cached(&g_State.VAO, VAO)) return;
+	glBindVertexArray(VAO);
+	g_State.buffers[bufferSlot(GL_ELEMENT_ARRAY_BUFFER)] = k_Unknown;
+}
+
+void GLState::bindBuffer(const uint32_t target, const uint32_t buffer) {
+	const uint32_t slot = bufferSlot(target);
+	if (slot == k_NumBufferTargets) {
+		stats_.calls++;
+		glBindBuffer(target, buffer);
+		return;
+	}
+	if (!cached(&g_State.buffers[slot], buffer)) glBindBuffer(target, buffer);
+}
+
+void GLState::bindBufferBase(const uint32_t target, const uint32_t index, const uint32_t buffer) {
+	stats_.calls++;
+	glBindBufferBase(target, index, buffer);
+	const uint32_t slot = bufferSlot(target);
+	if (slot != k_NumBufferTargets) g_State.buffers[slot] = buffer;
+}
+
+void GLState::bindBufferRange(const uint32_t target, const uint32_t index, const uint32_t buffer,
+	const intptr_t offset, const intptr_t size) {
+	stats_.calls++;
+	glBindBufferRange(target, index, buffer, offset, size);
+	const uint32_t slot = bufferSlot(target);
+	if (slot != k_NumBufferTargets) g_State.buffers[slot] = buffer;
+}
+
+void GLState::bindFramebuffer(const uint32_t framebuffer) {
+	if (!cached(&g_State.framebuffer, framebuffer)) glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+void GLState::bindTexture(const uint32_t unit, const uint32_t texture, const uint32_t target) {
+	if (unit >= k_MaxTextureUnits) {
+		stats_.calls++;
+		g_State.activeUnit = unit;
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(target, texture);
+		return;
+	}
+	// A texture of another target lives in its own slot of the unit, always bind it
+	if (g_State.textureTargets[unit] != target) g_State.textures[unit] = k_Unknown;
+	if (cached(&g_State.textures[unit], texture)) return;
+	g_State.textureTargets[unit] = target;
+	setActiveUnit(unit);
+	glBindTexture(target, texture);
+}
+
+void GLState::activeTexture(const uint32_t unit) {
+	if (!cached(&g_State.activeUnit, unit)) glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+void GLState::enable(const uint32_t capability) {
+	const uint32_t slot = capabilitySlot(capability);
+	if (slot == k_NumCapabilities) {
+		stats_.calls++;
+		glEnable(capability);
+		return;
+	}
+	if (!cached(&g_State.capabilities[slot], 1)) glEnable(capability);
+}
+
+void GLState::disable(const uint32_t capability) {
+	const uint32_t slot = capabilitySlot(capability);
+	if (slot == k_NumCapabilities) {
+		stats_.calls++;
+		glDisable(capability);
+		return;
+	}
+	if (!cached(&g_State.capabilities[slot], 0)) glDisable(capability);
+}
+
+void GLState::blendFunc(const uint32_t source, const uint32_t destination) {
+	blendFuncSeparate(source, destination, source, destination);
+}
+
+void GLState::blendFuncSeparate(const uint32_t sourceColor, const uint32_t destinationColor,
+	const uint32_t sourceAlpha, const uint32_t destinationAlpha) {
+	stats_.calls++;
+	if (g_State.blend[0] == sourceColor && g_State.blend[1] == destinationColor &&
+		g_State.blend[2] == sourceAlpha && g_State.blend[3] == destinationAlpha) {
+		stats_.filtered++;
+		return;
+	}
+	g_State.blend[0] = sourceColor;
+	g_State.blend[1] = destinationColor;
+	g_State.blend[2] = sourceAlpha;
+	g_State.blend[3] = destinationAlpha;
+	glBlendFuncSeparate(sourceColor, destinationColor, sourceAlpha, destinationAlpha);
+}
+
+void GLState::depthFunc(const uint32_t function) {
+	if (!cached(&g_State.depthFunc, function)) glDepthFunc(function);
+}
+
+void GLState::depthMask(const bool write) {
+	if (!cached(&g_State.depthMask, write ? 1 : 0)) glDepthMask(write ? GL_TRUE : GL_FALSE);
+}
+
+void GLState::cullFace(const uint32_t face) {
+	if (!cached(&g_State.cullFace, face)) glCullFace(face);
+}
+
+void GLState::stencilFunc(const uint32_t function, const int32_t reference, const uint32_t mask) {
+	stats_.calls++;
+	const uint32_t values[3] = { function, static_cast<uint32_t>(reference), mask };
+	if (memcmp(g_State.stencilFunc, values, sizeof(values)) == 0) {
+		stats_.filtered++;
+		return;
+	}
+	memcpy(g_State.stencilFunc, values, sizeof(values));
+	glStencilFunc(function, reference, mask);
+}
+
+void GLState::stencilOp(const uint32_t stencilFail, const uint32_t depthFail, const uint32_t pass) {
+	stats_.calls++;
+	const uint32_t values[3] = { stencilFail, depthFail, pass };
+	if (memcmp(g_State.stencilOp, values, sizeof(values)) == 0) {
+		stats_.filtered++;
+		return;
+	}
+	memcpy(g_State.stencilOp, values, sizeof(values));
+	glStencilOp(stencilFail, depthFail, pass);
+}
+
+void GLState::stencilMask(const uint32_t mask) {
+	// All bits set is a valid mask too, so the first call always goes through
+	stats_.calls++;
+	if (g_State.stencilMask == mask && g_State.stencilMask != k_Unknown) {
+		stats_.filtered++;
+		return;
+	}
+	g_State.stencilMask = mask;
+	glStencilMask(mask);
+}
+
+void GLState::viewport(const int32_t x, const int32_t y, const int32_t width, const int32_t height) {
+	stats_.calls++;
+	const int32_t values[4] = { x, y, width, height };
+	if (g_State.viewportKnown && memcmp(g_State.viewport, values, sizeof(values)) == 0) {
+		stats_.filtered++;
+		return;
+	}
+	memcpy(g_State.viewport, values, sizeof(values));
+	g_State.viewportKnown = true;
+	glViewport(x, y, width, height);
+}
+
+void GLState::invalidate() {
+	g_State = makeUnknown();
+}
+
+void GLState::forgetProgram(const uint32_t program) {
+	if (g_State.program == program) g_State.program = k_Unknown;
+}
+
+void GLState::forgetVertexArray(const uint32_t VAO) {
+	if (g_State.VAO == VAO) {
+		g_State.VAO = k_Unknown;
+		g_State.buffers[bufferSlot(GL_ELEMENT_ARRAY_BUFFER)] = k_Unknown;
+	}
+}
+
+void GLState::forgetBuffer(const uint32_t buffer) {
+	for (uint32_t& bound : g_State.buffers) {
+		if (bound == buffer) bound = k_Unknown;
+	}
+}
+
+void GLState::forgetTexture(const uint32_t texture) {
+	for (uint32_t& bound : g_State.textures) {
+		if (bound == texture) bound = k_Unknown;
+	}
+}
+
+void GLState::forgetFramebuffer(const uint32_t framebuffer) {
+	if (g_State.framebuffer == framebuffer) g_State.framebuffer = k_Unknown;
+}
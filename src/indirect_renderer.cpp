@@ -0,0 +1,167 @@
+#include "indirect_renderer.h"
+#include "frustum.h"
+#include "gl_state.h"
+#include "mesh.h"
+#include "model.h"
+#include "shader.h"
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <cstring>
+
+namespace {
+
+// GL 4.3 names the 3.3 loader does not know
+const GLenum k_ShaderStorageBuffer = 0x90D2;
+const GLenum k_DrawIndirectBuffer = 0x8F3F;
+const GLbitfield k_CommandBarrierBit = 0x00000040;
+const GLbitfield k_BufferUpdateBarrierBit = 0x00000200;
+
+typedef void (APIENTRYP DispatchComputeProc)(GLuint groupsX, GLuint groupsY, GLuint groupsZ);
+typedef void (APIENTRYP MemoryBarrierProc)(GLbitfield barriers);
+typedef void (APIENTRYP MultiDrawElementsIndirectProc)(GLenum mode, GLenum type, const void* indirect,
+	GLsizei drawCount, GLsizei stride);
+
+DispatchComputeProc dispatchCompute = nullptr;
+MemoryBarrierProc memoryBarrier = nullptr;
+MultiDrawElementsIndirectProc multiDrawElementsIndirect = nullptr;
+
+constexpr UniformName k_PlaneUniforms[6] = {
+	"planes[0]", "planes[1]", "planes[2]", "planes[3]", "planes[4]", "planes[5]"
+};
+constexpr UniformName k_NumInstancesUniform("numInstances");
+constexpr UniformName k_NumMeshesUniform("numMeshes");
+constexpr UniformName k_ViewPositionUniform("viewPosition");
+constexpr UniformName k_LodScaleUniform("lodScale");
+
+bool loadFunctions() {
+	if (multiDrawElementsIndirect) return true;
+
+	int32_t major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	if (major < 4 || (major == 4 && minor < 3)) return false;
+
+	dispatchCompute = (DispatchComputeProc)glfwGetProcAddress("glDispatchCompute");
+	memoryBarrier = (MemoryBarrierProc)glfwGetProcAddress("glMemoryBarrier");
+	multiDrawElementsIndirect = (MultiDrawElementsIndirectProc)glfwGetProcAddress("glMultiDrawElementsIndirect");
+	if (!dispatchCompute || !memoryBarrier || !multiDrawElementsIndirect) {
+		multiDrawElementsIndirect = nullptr;
+		return false;
+	}
+	return true;
+}
+
+uint32_t createBuffer() {
+	uint32_t buffer;
+	glGenBuffers(1, &buffer);
+	return buffer;
+}
+
+}
+
+bool IndirectRenderer::isSupported() {
+	return loadFunctions();
+}
+
+IndirectRenderer::IndirectRenderer(const Model& model) : model_(model),
+	transforms_(createBuffer()), meshes_(createBuffer()), commands_(createBuffer()), lods_(createBuffer()) {
+	loadFunctions();
+	cullMeshes_.resize(model_.meshes_.size());
+	uint32_t numLods = 0;
+	for (uint32_t i = 0; i < cullMeshes_.size(); i++) {
+		cullMeshes_[i].firstLod = numLods;
+		cullMeshes_[i].numLods = model_.meshes_[i].numLods();
+		numLods += cullMeshes_[i].numLods;
+	}
+	cullLods_.resize(numLods);
+}
+
+void IndirectRenderer::setInstances(const glm::mat4* transforms, const uint32_t count) {
+	numInstances_ = count;
+	matrices_.clear();
+	model_.appendInstances(transforms, count, &matrices_);
+	for (uint32_t i = 0; i < cullMeshes_.size(); i++) cullMeshes_[i].firstTransform = model_.instanceBlock(i) * count;
+	GLState::bindBuffer(k_ShaderStorageBuffer, transforms_.id());
+	glBufferData(k_ShaderStorageBuffer, matrices_.size() * sizeof(glm::mat4), matrices_.data(), GL_STATIC_DRAW);
+
+	// One command per mesh and instance, rewritten by every draw
+	GLState::bindBuffer(k_ShaderStorageBuffer, commands_.id());
+	glBufferData(k_ShaderStorageBuffer, count * cullMeshes_.size() * sizeof(DrawElementsIndirectCommand),
+		nullptr, GL_DYNAMIC_COPY);
+}
+
+void IndirectRenderer::uploadMeshes() {
+	for (size_t i = 0; i < cullMeshes_.size(); i++) {
+		const Mesh& mesh = model_.meshes_[i];
+		CullMesh& cullMesh = cullMeshes_[i];
+		cullMesh.boundingSphere = mesh.boundingSphere_;
+		cullMesh.baseVertex = mesh.baseVertex();
+		for (uint32_t lod = 0; lod < cullMesh.numLods; lod++) {
+			CullLod& cullLod = cullLods_[cullMesh.firstLod + lod];
+			mesh.indexRange(lod, &cullLod.firstIndex, &cullLod.count);
+			cullLod.error = mesh.lods_.empty() ? 0.0f : mesh.lods_[lod].error;
+			cullLod.padding = 0;
+		}
+	}
+	GLState::bindBuffer(k_ShaderStorageBuffer, meshes_.id());
+	glBufferData(k_ShaderStorageBuffer, cullMeshes_.size() * sizeof(CullMesh), cullMeshes_.data(), GL_STATIC_DRAW);
+	GLState::bindBuffer(k_ShaderStorageBuffer, lods_.id());
+	glBufferData(k_ShaderStorageBuffer, cullLods_.size() * sizeof(CullLod), cullLods_.data(), GL_STATIC_DRAW);
+	uploaded_ = true;
+}
+
+uint32_t IndirectRenderer::draw(const Shader& cull, const Shader& shader, const glm::mat4& viewProj,
+	const LodView* lods) {
+	if (!multiDrawElementsIndirect || !numInstances_ || !model_.vertexArray()) return 0;
+	// The ranges are known once the merged buffers are
+	if (!uploaded_) uploadMeshes();
+
+	const Frustum frustum(viewProj);
+	const uint32_t numMeshes = static_cast<uint32_t>(cullMeshes_.size());
+	cull.use();
+	for (uint32_t i = 0; i < 6; i++) cull.set(k_PlaneUniforms[i], frustum.planes[i]);
+	cull.set(k_NumInstancesUniform, static_cast<int>(numInstances_));
+	cull.set(k_NumMeshesUniform, static_cast<int>(numMeshes));
+	cull.set(k_ViewPositionUniform, lods ? lods->position : glm::vec3(0.0f));
+	cull.set(k_LodScaleUniform, lods ? lods->pixelsPerUnit / lods->maxPixelError : 0.0f);
+	GLState::bindBufferBase(k_ShaderStorageBuffer, k_CullTransformsBinding, transforms_.id());
+	GLState::bindBufferBase(k_ShaderStorageBuffer, k_CullMeshesBinding, meshes_.id());
+	GLState::bindBufferBase(k_ShaderStorageBuffer, k_CullCommandsBinding, commands_.id());
+	GLState::bindBufferBase(k_ShaderStorageBuffer, k_CullLodsBinding, lods_.id());
+	const uint32_t pairs = numInstances_ * numMeshes;
+	dispatchCompute((pairs + k_GroupSize - 1) / k_GroupSize, 1, 1);
+	// The draws read the commands as indirect arguments
+	memoryBarrier(k_CommandBarrierBit);
+
+	// The matrices are the instance attribute too, baseInstance picks the instance
+	shader.use();
+	GLState::bindVertexArray(model_.vertexArray());
+	Mesh::setupInstanceLayout(transforms_.id(), 0);
+	GLState::bindBuffer(k_DrawIndirectBuffer, commands_.id());
+	const GLenum type = model_.meshes_[0].indexSize() == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	for (uint32_t i = 0; i < numMeshes; i++) {
+		const Mesh& mesh = model_.meshes_[i];
+		mesh.bindTextures(shader);
+		mesh.setPackedUniforms(shader);
+		const size_t offset = static_cast<size_t>(i) * numInstances_ * sizeof(DrawElementsIndirectCommand);
+		multiDrawElementsIndirect(GL_TRIANGLES, type, (void*)offset, numInstances_, 0);
+	}
+	return numMeshes;
+}
+
+uint32_t IndirectRenderer::countVisible() const {
+	const size_t size = static_cast<size_t>(numInstances_) * cullMeshes_.size() * sizeof(DrawElementsIndirectCommand);
+	if (!multiDrawElementsIndirect || !size) return 0;
+
+	memoryBarrier(k_BufferUpdateBarrierBit);
+	uint32_t visible = 0;
+	GLState::bindBuffer(k_ShaderStorageBuffer, commands_.id());
+	const void* mapped = glMapBufferRange(k_ShaderStorageBuffer, 0, size, GL_MAP_READ_BIT);
+	if (mapped) {
+		const DrawElementsIndirectCommand* commands = static_cast<const DrawElementsIndirectCommand*>(mapped);
+		const size_t numCommands = size / sizeof(DrawElementsIndirectCommand);
+		for (size_t i = 0; i < numCommands; i++) visible += commands[i].instanceCount;
+		glUnmapBuffer(k_ShaderStorageBuffer);
+	}
+	return visible;
+}
@@ -0,0 +1,99 @@
+#include "instance_renderer.h"
+#include "gl_state.h"
+#include "hash.h"
+#include "mesh.h"
+#include "model.h"
+#include "shader.h"
+#include <glad/glad.h>
+#include <algorithm>
+
+void InstanceRenderer::begin() {
+	for (Batch& batch : batches_) batch.transforms.clear();
+}
+
+InstanceRenderer::Batch& InstanceRenderer::batch(const uint64_t key) {
+	const auto inserted = batchIds_.emplace(key, static_cast<uint32_t>(batches_.size()));
+	if (inserted.second) batches_.push_back(Batch{ nullptr, 0, 0, nullptr, 0, {}, 0, ~0u });
+	return batches_[inserted.first->second];
+}
+
+void InstanceRenderer::add(const Model& model, const glm::mat4& transform) {
+	const Model* pointer = &model;
+	Batch& entry = batch(hashBytes(&pointer, sizeof(pointer)));
+	entry.model = &model;
+	entry.transforms.push_back(transform);
+}
+
+void InstanceRenderer::add(const uint32_t VAO, const uint32_t numIndices, const uint32_t* textures,
+	const uint32_t numTextures, const glm::mat4& transform) {
+	// The same geometry with other textures is another batch
+	uint64_t key = hashBytes(&VAO, sizeof(VAO));
+	key = hashBytes(&numIndices, sizeof(numIndices), key);
+	key = hashBytes(textures, numTextures * sizeof(uint32_t), key);
+
+	Batch& entry = batch(key);
+	entry.model = nullptr;
+	entry.VAO = VAO;
+	entry.numIndices = numIndices;
+	entry.textures = textures;
+	entry.numTextures = numTextures;
+	entry.transforms.push_back(transform);
+}
+
+void InstanceRenderer::upload(const LodView* lods) {
+	matrices_.clear();
+	ranges_.clear();
+	for (Batch& batch : batches_) {
+		batch.first = static_cast<uint32_t>(matrices_.size());
+		batch.firstRange = ~0u;
+		const uint32_t count = static_cast<uint32_t>(batch.transforms.size());
+		if (batch.model && count && lods && batch.model->hasLods()) {
+			batch.firstRange = static_cast<uint32_t>(ranges_.size());
+			batch.model->appendInstanceLods(batch.transforms.data(), count, *lods, &matrices_, &ranges_);
+		} else if (batch.model) {
+			batch.model->appendInstances(batch.transforms.data(), count, &matrices_);
+		} else {
+			matrices_.insert(matrices_.end(), batch.transforms.begin(), batch.transforms.end());
+		}
+	}
+
+	if (!buffer_) {
+		uint32_t buffer;
+		glGenBuffers(1, &buffer);
+		buffer_.reset(buffer);
+	}
+	GLState::bindBuffer(GL_ARRAY_BUFFER, buffer_.id());
+	const size_t bytes = matrices_.size() * sizeof(glm::mat4);
+	// Orphaning gives the driver fresh memory while the last frame's draws may still read the old one
+	if (bytes > capacity_) {
+		capacity_ = std::max(bytes, capacity_ * 2);
+	}
+	glBufferData(GL_ARRAY_BUFFER, capacity_, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, matrices_.data());
+}
+
+void InstanceRenderer::flush(const Shader& shader, const LodView* lods) {
+	stats_ = InstanceStats();
+	upload(lods);
+	if (matrices_.empty()) return;
+
+	shader.use();
+	for (const Batch& batch : batches_) {
+		const uint32_t count = static_cast<uint32_t>(batch.transforms.size());
+		if (!count) continue;
+
+		if (batch.firstRange != ~0u) {
+			stats_.drawCalls += batch.model->drawInstanceLods(shader, buffer_.id(), ranges_.data() + batch.firstRange);
+		} else if (batch.model) {
+			stats_.drawCalls += batch.model->drawInstanced(shader, buffer_.id(), batch.first, count);
+		} else {
+			GLState::bindVertexArray(batch.VAO);
+			Mesh::setupInstanceLayout(buffer_.id(), batch.first);
+			for (uint32_t i = 0; i < batch.numTextures; i++) GLState::bindTexture(i, batch.textures[i]);
+			glDrawElementsInstanced(GL_TRIANGLES, batch.numIndices, GL_UNSIGNED_INT, 0, count);
+			stats_.drawCalls++;
+		}
+		stats_.instances += count;
+		stats_.batches++;
+	}
+}
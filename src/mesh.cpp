@@ -1,25 +1,108 @@
 #include "mesh.h"
+#include "gl_state.h"
 #include "shader.h"
+#include "vertex_packing.h"
 #include <glad/glad.h>
+#include <algorithm>
 
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices, std::vector<Texture> textures): 
-	vertices_(vertices), indices_(indices), textures_(textures) {
-		setupMesh();
+namespace {
+
+constexpr UniformName k_PositionScaleUniform("positionScale");
+constexpr UniformName k_PositionOffsetUniform("positionOffset");
+
+}
+
+Mesh::Mesh(std::vector<Vertex>&& vertices, std::vector<uint32_t>&& indices, std::vector<Texture>&& textures,
+	const bool upload) :
+	vertices_(std::move(vertices)), indices_(std::move(indices)), textures_(std::move(textures)),
+	numIndices_(static_cast<uint32_t>(indices_.size())) {
+		buildBindings();
+		if (upload) {
+			setupMesh(vertices_.data(), static_cast<uint32_t>(vertices_.size()), indices_.data(), numIndices_);
+		}
+}
+
+Mesh::Mesh(const Vertex* vertices, const uint32_t numVertices, const uint32_t* indices,
+	const uint32_t numIndices, std::vector<Texture>&& textures, const bool upload) :
+	textures_(std::move(textures)), numIndices_(numIndices) {
+		buildBindings();
+		if (upload) {
+			setupMesh(vertices, numVertices, indices, numIndices);
+		}
+}
+
+void Mesh::setupMesh(const Vertex* vertices, const uint32_t numVertices, const uint32_t* indices,
+	const uint32_t numIndices) {
+	uint32_t VBO, EBO;
+	createBuffers(vertices, numVertices * sizeof(Vertex), indices, numIndices * sizeof(uint32_t), &VBO, &EBO);
+	setupBuffers(VBO, EBO);
 }
 
-void Mesh::setupMesh() {
-	// Create buffers/arrays
-	glGenVertexArrays(1, &VAO_);
-	glGenBuffers(1, &VBO_);
-	glGenBuffers(1, &EBO_);
+void Mesh::createBuffers(const void* vertices, const size_t vertexBytes, const void* indices,
+	const size_t indexBytes, uint32_t* VBO, uint32_t* EBO) {
+	glGenBuffers(1, VBO);
+	glGenBuffers(1, EBO);
 
-	glBindVertexArray(VAO_);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO_);
+	// Element buffers are VAO state, so both are filled through the array target
+	GLState::bindBuffer(GL_ARRAY_BUFFER, *VBO);
+	glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertices, GL_STATIC_DRAW);
 
-	glBufferData(GL_ARRAY_BUFFER, vertices_.size() * sizeof(Vertex), &vertices_[0], GL_STATIC_DRAW);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, *EBO);
+	glBufferData(GL_ARRAY_BUFFER, indexBytes, indices, GL_STATIC_DRAW);
+}
+
+void Mesh::setupBuffers(const uint32_t VBO, const uint32_t EBO) {
+	VBO_.reset(VBO);
+	EBO_.reset(EBO);
+
+	// Create array
+	uint32_t VAO;
+	glGenVertexArrays(1, &VAO);
+	VAO_.reset(VAO);
+	GLState::bindVertexArray(VAO);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, VBO);
+	GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	setupVertexLayout(format_);
+	// Keeps later buffer binds out of the new VAO
+	GLState::bindVertexArray(0);
+}
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices_.size() * sizeof(uint32_t), &indices_[0], GL_STATIC_DRAW);
+void Mesh::releaseCpuData() {
+	// Swapping is the only way to really give the memory back
+	std::vector<Vertex>().swap(vertices_);
+	std::vector<uint32_t>().swap(indices_);
+}
+
+void Mesh::setPacked(const glm::vec3& positionScale, const glm::vec3& positionOffset, const bool shortIndices) {
+	format_ = VertexFormat::Packed;
+	positionScale_ = positionScale;
+	positionOffset_ = positionOffset;
+	indexSize_ = shortIndices ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+uint32_t Mesh::vertexSize() const {
+	return format_ == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+}
+
+void Mesh::setupVertexLayout(const VertexFormat format) {
+	if (format == VertexFormat::Packed) {
+		// Position and tangent handedness
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 4, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)0);
+
+		// Octahedral normal
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Normal));
+
+		// Half float texture coords
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, TexCoords));
+
+		// Octahedral tangent, the bitangent is rebuilt in the shader
+		glEnableVertexAttribArray(3);
+		glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Tangent));
+		return;
+	}
 
 	// Vertex positions
 	glEnableVertexAttribArray(0);
@@ -40,42 +123,136 @@ void Mesh::setupMesh() {
 	// Vertex bitangent
 	glEnableVertexAttribArray(4);
 	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+}
+
+void Mesh::setupInstanceLayout(const uint32_t buffer, const uint32_t firstInstance) {
+	GLState::bindBuffer(GL_ARRAY_BUFFER, buffer);
+	// A mat4 attribute is read as four vec4 columns
+	for (uint32_t column = 0; column < 4; column++) {
+		const uint32_t location = k_InstanceMatrixLocation + column;
+		const size_t offset = firstInstance * sizeof(glm::mat4) + column * sizeof(glm::vec4);
+		glEnableVertexAttribArray(location);
+		glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)offset);
+		glVertexAttribDivisor(location, 1);
+	}
+}
+
+void Mesh::setLod(const uint32_t lod) {
+	lod_ = lods_.empty() ? 0 : std::min(lod, static_cast<uint32_t>(lods_.size() - 1));
+}
+
+void Mesh::computeBounds(const Vertex* vertices, const uint32_t numVertices, glm::vec3* min, glm::vec3* max) {
+	if (!numVertices) {
+		*min = *max = glm::vec3(0.0f);
+		return;
+	}
+
+	*min = *max = vertices[0].Position;
+	for (uint32_t i = 1; i < numVertices; i++) {
+		*min = glm::min(*min, vertices[i].Position);
+		*max = glm::max(*max, vertices[i].Position);
+	}
+}
+
+glm::vec4 Mesh::computeBoundingSphere(const Vertex* vertices, const uint32_t numVertices) {
+	if (!numVertices) return glm::vec4(0.0f);
+
+	glm::vec3 min, max;
+	computeBounds(vertices, numVertices, &min, &max);
+	const glm::vec3 center = (min + max) * 0.5f;
+	float radius = 0.0f;
+	for (uint32_t i = 0; i < numVertices; i++) {
+		radius = std::max(radius, glm::length(vertices[i].Position - center));
+	}
+	return glm::vec4(center, radius);
+}
 
-	glBindVertexArray(0);
+void Mesh::setRange(const int32_t baseVertex, const uint32_t firstIndex) {
+	baseVertex_ = baseVertex;
+	firstIndex_ = firstIndex;
 }
 
 void Mesh::Draw(const Shader& shader) const {
-	// Bind appropiate textures
-	uint32_t diffuseNr = 1;
-	uint32_t specularNr = 1;
-	uint32_t normalNr = 1;
-	uint32_t heightNr = 1;
-
-	for (uint8_t i = 0; i < textures_.size(); i++) {
-		glActiveTexture(GL_TEXTURE0 + i); // Active proper texutre unit before binding
-		// retrieve texture number (the N in diffuse_textureN)
-		std::string number;
-		std::string name = textures_[i].type;
-		if (name == "texture_diffuse")
-			number = std::to_string(diffuseNr++);
-		else if (name == "texture_specular")
-			number = std::to_string(specularNr++); // Transfer unsigned int to stream
-		else if (name == "texture_normal")
-			number = std::to_string(normalNr++); // Transfer unsigned int to stream
-		else if (name == "texture_height")
-			number = std::to_string(heightNr++); // Transfer unsigned int to stream
-
-		// Set the sampler to the correct texture unit
-		shader.set((name + number).c_str(), i);
-		// Bind texture
-		glBindTexture(GL_TEXTURE_2D, textures_[i].id);
+	if (!isReady()) return;
+
+	GLState::bindVertexArray(VAO_.id());
+	drawRange(shader);
+}
+
+void Mesh::drawRange(const Shader& shader) const {
+	bindTextures(shader);
+	drawElements(shader);
+}
+
+TextureType Mesh::textureType(const std::string& type) {
+	if (type == "texture_diffuse") return TextureType::Diffuse;
+	if (type == "texture_specular") return TextureType::Specular;
+	if (type == "texture_normal") return TextureType::Normal;
+	if (type == "texture_height") return TextureType::Height;
+	return TextureType::Other;
+}
+
+void Mesh::buildBindings() {
+	// Textures of a type are numbered from 1 in order, the N in texture_diffuseN
+	uint32_t numbers[static_cast<size_t>(TextureType::Other)] = {};
+
+	bindings_.clear();
+	bindings_.reserve(textures_.size());
+	for (size_t i = 0; i < textures_.size(); i++) {
+		const Texture& texture = textures_[i];
+		const TextureType type = textureType(texture.type);
+		std::string sampler = texture.type;
+		if (type != TextureType::Other) sampler += std::to_string(++numbers[static_cast<size_t>(type)]);
+
+		bindings_.push_back(TextureBinding{ texture.handle.get(), UniformName(sampler.c_str()),
+			static_cast<uint8_t>(i), type });
 	}
+}
 
-	// Draw mesh
-	glBindVertexArray(VAO_);
-	glDrawElements(GL_TRIANGLES, indices_.size(), GL_UNSIGNED_INT, 0);
-	glBindVertexArray(0);
+void Mesh::bindTextures(const Shader& shader) const {
+	for (const TextureBinding& binding : bindings_) {
+		// The shader keeps the sampler's location and value, a unit it already holds is skipped
+		shader.set(binding.sampler, static_cast<int>(binding.unit));
+		GLState::bindTexture(binding.unit, binding.texture ? binding.texture->id : 0);
+	}
+}
+
+void Mesh::setPackedUniforms(const Shader& shader) const {
+	if (format_ == VertexFormat::Packed) {
+		shader.set(k_PositionScaleUniform, positionScale_);
+		shader.set(k_PositionOffsetUniform, positionOffset_);
+	}
+}
+
+void Mesh::indexRange(uint32_t* firstIndex, uint32_t* numIndices) const {
+	indexRange(lod_, firstIndex, numIndices);
+}
 
-	// Set everything back to defaults once configured
-	glActiveTexture(GL_TEXTURE0);
-}
\ No newline at end of file
+void Mesh::indexRange(const uint32_t lod, uint32_t* firstIndex, uint32_t* numIndices) const {
+	// Only that LOD when there are several
+	*firstIndex = firstIndex_;
+	*numIndices = numIndices_;
+	if (!lods_.empty()) {
+		const MeshLod& range = lods_[std::min(lod, static_cast<uint32_t>(lods_.size() - 1))];
+		*firstIndex += range.firstIndex;
+		*numIndices = range.numIndices;
+	}
+}
+
+void Mesh::drawElements(const Shader& shader, const uint32_t numInstances) const {
+	drawElements(shader, numInstances, lod_);
+}
+
+void Mesh::drawElements(const Shader& shader, const uint32_t numInstances, const uint32_t lod) const {
+	setPackedUniforms(shader);
+
+	uint32_t firstIndex, numIndices;
+	indexRange(lod, &firstIndex, &numIndices);
+	const GLenum type = indexSize_ == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	void* offset = (void*)(firstIndex * static_cast<size_t>(indexSize_));
+	if (numInstances > 1) {
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, numIndices, type, offset, numInstances, baseVertex_);
+	} else {
+		glDrawElementsBaseVertex(GL_TRIANGLES, numIndices, type, offset, baseVertex_);
+	}
+}
@@ -0,0 +1,248 @@
+#include "mesh_cache.h"
+#include "hash.h"
+#include "obj_loader.h"
+#include <cctype>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const char k_Magic[4] = { 'M', 'S', 'H', 'C' };
+
+struct FileHeader {
+	char magic[4];
+	uint32_t version;
+	uint64_t key;
+	uint32_t vertexSize;
+	uint32_t numMeshes;
+	uint32_t numNodes;
+	uint32_t padding;
+};
+
+struct MeshRecord {
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	uint32_t numVertices;
+	uint32_t numIndices;
+	uint32_t numTextures;
+	uint32_t numLods;
+	float boundingSphere[4];
+	float boundsMin[3];
+	float boundsMax[3];
+};
+
+struct NodeRecord {
+	uint32_t parent;
+	uint32_t firstMesh;
+	uint32_t numMeshes;
+	float local[16];
+};
+
+size_t alignUp(const size_t value, const size_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+void appendString(std::string* blob, const std::string& value) {
+	uint32_t length = static_cast<uint32_t>(value.size());
+	blob->append(reinterpret_cast<const char*>(&length), sizeof(length));
+	blob->append(value);
+}
+
+bool readString(const uint8_t* data, const size_t size, size_t* offset, std::string* value) {
+	uint32_t length;
+	if (*offset + sizeof(length) > size) return false;
+	memcpy(&length, data + *offset, sizeof(length));
+	*offset += sizeof(length);
+	if (*offset + length > size) return false;
+	value->assign(reinterpret_cast<const char*>(data + *offset), length);
+	*offset += length;
+	return true;
+}
+
+}
+
+uint64_t MeshCache::computeKey(const std::string& sourcePath, const uint32_t importFlags,
+	const uint32_t processFlags) {
+	MappedFile source;
+	if (!source.open(sourcePath)) return 0;
+
+	uint64_t hash = hashBytes(source.data(), source.size());
+
+	// The cached texture references come from the materials, an edited MTL must miss
+	std::string extension = sourcePath.substr(sourcePath.find_last_of('.') + 1);
+	for (char& c : extension) c = static_cast<char>(tolower(c));
+	if (extension == "obj") {
+		const std::string directory = sourcePath.substr(0, sourcePath.find_last_of('/') + 1);
+		const char* text = reinterpret_cast<const char*>(source.data());
+		for (const std::string& name : ObjLoader::materialLibraries(text, source.size())) {
+			hash = hashBytes(name.data(), name.size(), hash);
+			MappedFile library;
+			if (library.open(directory + name)) hash = hashBytes(library.data(), library.size(), hash);
+		}
+	}
+
+	const uint32_t salt[4] = { importFlags, processFlags, k_MeshCacheVersion, static_cast<uint32_t>(sizeof(Vertex)) };
+	hash = hashBytes(salt, sizeof(salt), hash);
+	return hash ? hash : 1;	// 0 is reserved for "no key"
+}
+
+bool MeshCache::write(const std::string& path, const uint64_t key, const std::vector<Mesh>& meshes,
+	const SceneGraph& scene) {
+	// Texture references and LOD tables go right after the mesh table
+	std::string strings;
+	for (const Mesh& mesh : meshes) {
+		for (const Texture& texture : mesh.textures_) {
+			appendString(&strings, texture.type);
+			appendString(&strings, texture.path);
+		}
+		strings.append(reinterpret_cast<const char*>(mesh.lods_.data()), mesh.lods_.size() * sizeof(MeshLod));
+	}
+
+	// The node table follows the mesh table
+	std::vector<NodeRecord> nodes(scene.size());
+	for (uint32_t i = 0; i < scene.size(); i++) {
+		nodes[i].parent = scene.parent(i);
+		nodes[i].firstMesh = scene.firstMesh(i);
+		nodes[i].numMeshes = scene.numMeshes(i);
+		memcpy(nodes[i].local, &scene.local(i), sizeof(nodes[i].local));
+	}
+
+	std::vector<MeshRecord> records(meshes.size());
+	size_t offset = alignUp(sizeof(FileHeader) + records.size() * sizeof(MeshRecord) +
+		nodes.size() * sizeof(NodeRecord) + strings.size(), 16);
+	for (size_t i = 0; i < meshes.size(); i++) {
+		MeshRecord& record = records[i];
+		record.numVertices = static_cast<uint32_t>(meshes[i].vertices_.size());
+		record.numIndices = static_cast<uint32_t>(meshes[i].indices_.size());
+		record.numTextures = static_cast<uint32_t>(meshes[i].textures_.size());
+		record.numLods = static_cast<uint32_t>(meshes[i].lods_.size());
+		memcpy(record.boundingSphere, &meshes[i].boundingSphere_, sizeof(record.boundingSphere));
+		memcpy(record.boundsMin, &meshes[i].boundsMin_, sizeof(record.boundsMin));
+		memcpy(record.boundsMax, &meshes[i].boundsMax_, sizeof(record.boundsMax));
+		record.vertexOffset = offset;
+		offset = alignUp(offset + record.numVertices * sizeof(Vertex), 16);
+		record.indexOffset = offset;
+		offset = alignUp(offset + record.numIndices * sizeof(uint32_t), 16);
+	}
+
+	std::ofstream file(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+	if (!file) {
+		std::cout << "Error Writing Mesh Cache " << path << std::endl;
+		return false;
+	}
+
+	// The key is patched in last, so an interrupted write never looks valid
+	FileHeader header;
+	memcpy(header.magic, k_Magic, sizeof(k_Magic));
+	header.version = k_MeshCacheVersion;
+	header.key = 0;
+	header.vertexSize = sizeof(Vertex);
+	header.numMeshes = static_cast<uint32_t>(meshes.size());
+	header.numNodes = static_cast<uint32_t>(nodes.size());
+	header.padding = 0;
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(MeshRecord));
+	file.write(reinterpret_cast<const char*>(nodes.data()), nodes.size() * sizeof(NodeRecord));
+	file.write(strings.data(), strings.size());
+
+	const char zeros[16] = {};
+	for (size_t i = 0; i < meshes.size(); i++) {
+		file.write(zeros, records[i].vertexOffset - static_cast<size_t>(file.tellp()));
+		file.write(reinterpret_cast<const char*>(meshes[i].vertices_.data()), records[i].numVertices * sizeof(Vertex));
+		file.write(zeros, records[i].indexOffset - static_cast<size_t>(file.tellp()));
+		file.write(reinterpret_cast<const char*>(meshes[i].indices_.data()), records[i].numIndices * sizeof(uint32_t));
+	}
+
+	file.seekp(offsetof(FileHeader, key));
+	file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+	return static_cast<bool>(file);
+}
+
+bool MeshCache::open(const std::string& path, const uint64_t key) {
+	close();
+	if (!key || !file_.open(path)) return false;
+
+	const uint8_t* data = file_.data();
+	const size_t size = file_.size();
+
+	FileHeader header;
+	if (size < sizeof(header)) {
+		close();
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, k_Magic, sizeof(k_Magic)) != 0 || header.version != k_MeshCacheVersion ||
+		header.key != key || header.vertexSize != sizeof(Vertex)) {
+		close();
+		return false;
+	}
+
+	size_t offset = sizeof(header);
+	if (offset + header.numMeshes * sizeof(MeshRecord) > size) {
+		close();
+		return false;
+	}
+	std::vector<MeshRecord> records(header.numMeshes);
+	memcpy(records.data(), data + offset, records.size() * sizeof(MeshRecord));
+	offset += records.size() * sizeof(MeshRecord);
+
+	if (offset + header.numNodes * sizeof(NodeRecord) > size) {
+		close();
+		return false;
+	}
+	for (uint32_t i = 0; i < header.numNodes; i++) {
+		NodeRecord node;
+		memcpy(&node, data + offset, sizeof(node));
+		offset += sizeof(node);
+		glm::mat4 local;
+		memcpy(&local, node.local, sizeof(node.local));
+		if (static_cast<uint64_t>(node.firstMesh) + node.numMeshes > header.numMeshes ||
+			scene_.addNode(node.parent, local, node.firstMesh, node.numMeshes) == k_NoParent) {
+			close();
+			return false;
+		}
+	}
+
+	meshes_.resize(records.size());
+	for (size_t i = 0; i < records.size(); i++) {
+		const MeshRecord& record = records[i];
+		MeshView& view = meshes_[i];
+		view.textures.resize(record.numTextures);
+		for (Texture& texture : view.textures) {
+			if (!readString(data, size, &offset, &texture.type) ||
+				!readString(data, size, &offset, &texture.path)) {
+				close();
+				return false;
+			}
+		}
+		if (offset + record.numLods * sizeof(MeshLod) > size) {
+			close();
+			return false;
+		}
+		view.lods.resize(record.numLods);
+		memcpy(view.lods.data(), data + offset, record.numLods * sizeof(MeshLod));
+		offset += record.numLods * sizeof(MeshLod);
+		memcpy(&view.boundingSphere, record.boundingSphere, sizeof(record.boundingSphere));
+		memcpy(&view.boundsMin, record.boundsMin, sizeof(record.boundsMin));
+		memcpy(&view.boundsMax, record.boundsMax, sizeof(record.boundsMax));
+
+		if (record.vertexOffset + record.numVertices * sizeof(Vertex) > size ||
+			record.indexOffset + record.numIndices * sizeof(uint32_t) > size) {
+			close();
+			return false;
+		}
+		view.vertices = reinterpret_cast<const Vertex*>(data + record.vertexOffset);
+		view.numVertices = record.numVertices;
+		view.indices = reinterpret_cast<const uint32_t*>(data + record.indexOffset);
+		view.numIndices = record.numIndices;
+	}
+	return true;
+}
+
+void MeshCache::close() {
+	meshes_.clear();
+	scene_.clear();
+	file_.close();
+}
@@ -0,0 +1,332 @@
+#include "mesh_optimizer.h"
+#include "hash.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const uint32_t k_Unused = 0xFFFFFFFFu;
+
+// Forsyth's scoring constants, tuned for a 32 entry LRU cache
+const uint32_t k_ForsythCacheSize = 32;
+const float k_CacheDecayPower = 1.5f;
+const float k_LastTriScore = 0.75f;
+const float k_ValenceBoostScale = 2.0f;
+const float k_ValenceBoostPower = 0.5f;
+
+float vertexScore(const int32_t cachePosition, const uint32_t remaining) {
+	if (remaining == 0) return -1.0f; // Nothing left to draw with it
+
+	float score = 0.0f;
+	if (cachePosition >= 0) {
+		if (cachePosition < 3) {
+			// Used by the last triangle, fixed score so strips are not favoured over fans
+			score = k_LastTriScore;
+		}
+		else {
+			const float scaler = 1.0f / (k_ForsythCacheSize - 3);
+			score = powf(1.0f - (cachePosition - 3) * scaler, k_CacheDecayPower);
+		}
+	}
+	// Vertices with few triangles left are finished first, so they leave the cache for good
+	score += k_ValenceBoostScale * powf(static_cast<float>(remaining), -k_ValenceBoostPower);
+	return score;
+}
+
+// FIFO cache simulated with timestamps, a vertex is a hit if it entered less than size misses ago
+class FifoCache {
+public:
+	FifoCache(const uint32_t numVertices, const uint32_t size) :
+		stamps_(numVertices, 0), size_(size), time_(size + 1) {}
+
+	bool access(const uint32_t vertex) {
+		if (time_ - stamps_[vertex] <= size_) return true;
+		stamps_[vertex] = time_++;
+		return false;
+	}
+
+	// Forgets everything without touching every entry
+	void flush() { time_ += size_ + 1; }
+
+private:
+	std::vector<uint32_t> stamps_;
+	uint32_t size_;
+	uint32_t time_;
+};
+
+}
+
+VertexCacheStats& VertexCacheStats::operator+=(const VertexCacheStats& other) {
+	numTriangles += other.numTriangles;
+	numVertices += other.numVertices;
+	numTransforms += other.numTransforms;
+	return *this;
+}
+
+void MeshOptimizer::optimize(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices,
+	VertexCacheStats* before, VertexCacheStats* after) {
+	if (before) *before = analyzeVertexCache(*indices, static_cast<uint32_t>(vertices->size()));
+
+	weldVertices(vertices, indices);
+	optimizeVertexCache(indices, static_cast<uint32_t>(vertices->size()));
+	optimizeOverdraw(indices, *vertices);
+	optimizeVertexFetch(vertices, indices);
+
+	if (after) *after = analyzeVertexCache(*indices, static_cast<uint32_t>(vertices->size()));
+}
+
+void MeshOptimizer::weldVertices(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices) {
+	const size_t count = vertices->size();
+
+	// Open addressing table of unique vertex indices, at most half full
+	size_t tableSize = 1;
+	while (tableSize < count * 2) tableSize <<= 1;
+	const size_t mask = tableSize - 1;
+	std::vector<uint32_t> table(tableSize, k_Unused);
+
+	std::vector<Vertex> unique;
+	unique.reserve(count);
+	std::vector<uint32_t> remap(count);
+	for (size_t i = 0; i < count; i++) {
+		const Vertex& vertex = (*vertices)[i];
+		size_t slot = hashBytes(&vertex, sizeof(Vertex)) & mask;
+		while (table[slot] != k_Unused && memcmp(&unique[table[slot]], &vertex, sizeof(Vertex)) != 0) {
+			slot = (slot + 1) & mask;
+		}
+		if (table[slot] == k_Unused) {
+			table[slot] = static_cast<uint32_t>(unique.size());
+			unique.push_back(vertex);
+		}
+		remap[i] = table[slot];
+	}
+
+	for (uint32_t& index : *indices) {
+		index = remap[index];
+	}
+	vertices->swap(unique);
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<uint32_t>* indices, const uint32_t numVertices) {
+	std::vector<uint32_t>& ib = *indices;
+	const uint32_t numTriangles = static_cast<uint32_t>(ib.size() / 3);
+	if (numTriangles == 0) return;
+
+	// Triangles using each vertex, the first remaining[v] entries are the ones not drawn yet
+	std::vector<uint32_t> remaining(numVertices, 0);
+	for (uint32_t index : ib) remaining[index]++;
+	std::vector<uint32_t> offsets(numVertices + 1, 0);
+	for (uint32_t v = 0; v < numVertices; v++) offsets[v + 1] = offsets[v] + remaining[v];
+	std::vector<uint32_t> adjacency(ib.size());
+	std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+	for (uint32_t t = 0; t < numTriangles; t++) {
+		for (uint32_t k = 0; k < 3; k++) adjacency[fill[ib[t * 3 + k]]++] = t;
+	}
+
+	std::vector<int32_t> cachePosition(numVertices, -1);
+	std::vector<float> vertexScores(numVertices);
+	for (uint32_t v = 0; v < numVertices; v++) vertexScores[v] = vertexScore(-1, remaining[v]);
+
+	std::vector<float> triangleScores(numTriangles);
+	for (uint32_t t = 0; t < numTriangles; t++) {
+		triangleScores[t] = vertexScores[ib[t * 3]] + vertexScores[ib[t * 3 + 1]] + vertexScores[ib[t * 3 + 2]];
+	}
+
+	std::vector<bool> emitted(numTriangles, false);
+	std::vector<uint32_t> output;
+	output.reserve(ib.size());
+
+	uint32_t cache[k_ForsythCacheSize + 3];
+	uint32_t newCache[k_ForsythCacheSize + 3];
+	uint32_t cacheCount = 0;
+	int64_t best = -1;
+	uint32_t cursor = 0;
+
+	for (uint32_t drawn = 0; drawn < numTriangles; drawn++) {
+		// Nothing in the cache has triangles left, restart from the next one in input order
+		if (best < 0) {
+			while (emitted[cursor]) cursor++;
+			best = cursor;
+		}
+
+		const uint32_t triangle = static_cast<uint32_t>(best);
+		const uint32_t* corners = &ib[triangle * 3];
+		emitted[triangle] = true;
+		output.insert(output.end(), corners, corners + 3);
+
+		// Take the triangle out of its vertices' lists
+		for (uint32_t k = 0; k < 3; k++) {
+			const uint32_t v = corners[k];
+			uint32_t* list = &adjacency[offsets[v]];
+			for (uint32_t j = 0; j < remaining[v]; j++) {
+				if (list[j] == triangle) {
+					list[j] = list[remaining[v] - 1];
+					break;
+				}
+			}
+			remaining[v]--;
+		}
+
+		// The triangle's vertices move to the front of the LRU cache
+		uint32_t newCount = 0;
+		for (uint32_t k = 0; k < 3; k++) {
+			if (std::find(newCache, newCache + newCount, corners[k]) == newCache + newCount) {
+				newCache[newCount++] = corners[k];
+			}
+		}
+		const uint32_t numFront = newCount;
+		for (uint32_t i = 0; i < cacheCount; i++) {
+			if (std::find(newCache, newCache + numFront, cache[i]) == newCache + numFront) {
+				newCache[newCount++] = cache[i];
+			}
+		}
+		for (uint32_t i = 0; i < newCount; i++) {
+			cachePosition[newCache[i]] = i < k_ForsythCacheSize ? static_cast<int32_t>(i) : -1;
+		}
+
+		// Rescore everything that moved, including what fell out, and pick the best candidate
+		best = -1;
+		float bestScore = -1.0f;
+		for (uint32_t i = 0; i < newCount; i++) {
+			const uint32_t v = newCache[i];
+			const float score = vertexScore(cachePosition[v], remaining[v]);
+			const float delta = score - vertexScores[v];
+			vertexScores[v] = score;
+
+			const uint32_t* list = &adjacency[offsets[v]];
+			for (uint32_t j = 0; j < remaining[v]; j++) {
+				triangleScores[list[j]] += delta;
+			}
+		}
+		for (uint32_t i = 0; i < newCount && i < k_ForsythCacheSize; i++) {
+			const uint32_t v = newCache[i];
+			const uint32_t* list = &adjacency[offsets[v]];
+			for (uint32_t j = 0; j < remaining[v]; j++) {
+				if (triangleScores[list[j]] > bestScore) {
+					bestScore = triangleScores[list[j]];
+					best = list[j];
+				}
+			}
+		}
+
+		cacheCount = std::min(newCount, k_ForsythCacheSize);
+		std::copy(newCache, newCache + cacheCount, cache);
+	}
+
+	ib.swap(output);
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<uint32_t>* indices, const std::vector<Vertex>& vertices,
+	const float threshold) {
+	std::vector<uint32_t>& ib = *indices;
+	const uint32_t numTriangles = static_cast<uint32_t>(ib.size() / 3);
+	if (numTriangles < 2) return;
+	const uint32_t numVertices = static_cast<uint32_t>(vertices.size());
+
+	// Hard boundaries: triangles where the cache starts cold anyway
+	std::vector<uint32_t> hard;
+	FifoCache cache(numVertices, k_StatsCacheSize);
+	for (uint32_t t = 0; t < numTriangles; t++) {
+		uint32_t misses = 0;
+		for (uint32_t k = 0; k < 3; k++) misses += cache.access(ib[t * 3 + k]) ? 0 : 1;
+		if (t == 0 || misses == 3) hard.push_back(t);
+	}
+	hard.push_back(numTriangles);
+
+	// Soft boundaries: split a hard cluster wherever the part so far, replayed from a cold
+	// cache, is not much worse than the whole cluster
+	std::vector<uint32_t> clusters;
+	for (size_t c = 0; c + 1 < hard.size(); c++) {
+		const uint32_t start = hard[c], end = hard[c + 1];
+
+		cache.flush();
+		uint32_t clusterMisses = 0;
+		for (uint32_t i = start * 3; i < end * 3; i++) clusterMisses += cache.access(ib[i]) ? 0 : 1;
+		const float limit = static_cast<float>(clusterMisses) / (end - start) * threshold;
+
+		cache.flush();
+		uint32_t subStart = start, subMisses = 0;
+		clusters.push_back(start);
+		for (uint32_t t = start; t < end; t++) {
+			for (uint32_t k = 0; k < 3; k++) subMisses += cache.access(ib[t * 3 + k]) ? 0 : 1;
+			if (t + 1 < end && static_cast<float>(subMisses) / (t + 1 - subStart) <= limit) {
+				clusters.push_back(t + 1);
+				subStart = t + 1;
+				subMisses = 0;
+				cache.flush();
+			}
+		}
+	}
+	clusters.push_back(numTriangles);
+
+	// Area weighted centroid and normal of each cluster and of the whole mesh
+	const size_t numClusters = clusters.size() - 1;
+	std::vector<glm::vec3> centroids(numClusters, glm::vec3(0.0f)), normals(numClusters, glm::vec3(0.0f));
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+	for (size_t c = 0; c < numClusters; c++) {
+		float area = 0.0f;
+		for (uint32_t t = clusters[c]; t < clusters[c + 1]; t++) {
+			const glm::vec3& a = vertices[ib[t * 3]].Position;
+			const glm::vec3& b = vertices[ib[t * 3 + 1]].Position;
+			const glm::vec3& d = vertices[ib[t * 3 + 2]].Position;
+			const glm::vec3 normal = glm::cross(b - a, d - a);
+			const float triangleArea = glm::length(normal);
+			centroids[c] += (a + b + d) * (triangleArea / 3.0f);
+			normals[c] += normal;
+			area += triangleArea;
+		}
+		meshCentroid += centroids[c];
+		meshArea += area;
+		if (area > 0.0f) centroids[c] /= area;
+	}
+	if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+	// Clusters far out along their normal tend to occlude the rest, draw them first
+	std::vector<float> keys(numClusters);
+	std::vector<uint32_t> order(numClusters);
+	for (size_t c = 0; c < numClusters; c++) {
+		const float length = glm::length(normals[c]);
+		keys[c] = length > 0.0f ? glm::dot(centroids[c] - meshCentroid, normals[c] / length) : 0.0f;
+		order[c] = static_cast<uint32_t>(c);
+	}
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keys[a] > keys[b]; });
+
+	std::vector<uint32_t> output;
+	output.reserve(ib.size());
+	for (uint32_t c : order) {
+		output.insert(output.end(), ib.begin() + clusters[c] * 3, ib.begin() + clusters[c + 1] * 3);
+	}
+	ib.swap(output);
+}
+
+void MeshOptimizer::optimizeVertexFetch(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices) {
+	std::vector<uint32_t> remap(vertices->size(), k_Unused);
+	std::vector<Vertex> ordered;
+	ordered.reserve(vertices->size());
+	for (uint32_t& index : *indices) {
+		if (remap[index] == k_Unused) {
+			remap[index] = static_cast<uint32_t>(ordered.size());
+			ordered.push_back((*vertices)[index]);
+		}
+		index = remap[index];
+	}
+	vertices->swap(ordered);
+}
+
+VertexCacheStats MeshOptimizer::analyzeVertexCache(const std::vector<uint32_t>& indices, const uint32_t numVertices,
+	const uint32_t cacheSize) {
+	VertexCacheStats stats;
+	stats.numTriangles = static_cast<uint32_t>(indices.size() / 3);
+
+	FifoCache cache(numVertices, cacheSize);
+	std::vector<bool> used(numVertices, false);
+	for (uint32_t index : indices) {
+		if (!cache.access(index)) stats.numTransforms++;
+		if (!used[index]) {
+			used[index] = true;
+			stats.numVertices++;
+		}
+	}
+	return stats;
+}
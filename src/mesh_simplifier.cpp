@@ -0,0 +1,429 @@
+#include "mesh_simplifier.h"
+#include "mesh_optimizer.h"
+#include "hash.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+namespace {
+
+const uint32_t k_Unused = 0xFFFFFFFFu;
+// Open edges weigh more than faces so borders and seams keep their shape
+const float k_EdgeWeight = 10.0f;
+// A pass stops at collapses this much worse than the one that would reach the goal,
+// the cheaper ones left are ranked again in the next pass
+const float k_PassErrorBound = 1.5f;
+
+// How a vertex may move, shared by every vertex at the same position
+enum VertexKind : uint8_t {
+	k_Manifold,	// Inside the surface, collapses anywhere
+	k_Border,	// On an open edge, collapses along it
+	k_Seam,	// Two vertices with different attributes, collapse together along the seam
+	k_Locked,	// Corners, seam ends and anything more complex stay put
+	k_NumKinds
+};
+
+// Whether a vertex of kind row may collapse onto a vertex of kind column
+const uint8_t k_CanCollapse[k_NumKinds][k_NumKinds] = {
+	{1, 1, 1, 1},
+	{0, 1, 0, 0},
+	{0, 0, 1, 0},
+	{0, 0, 0, 0},
+};
+
+// Whether the edge also shows up reversed in a neighbour triangle
+const uint8_t k_HasOpposite[k_NumKinds][k_NumKinds] = {
+	{1, 1, 1, 1},
+	{1, 0, 1, 0},
+	{1, 1, 1, 1},
+	{1, 0, 1, 0},
+};
+
+// Symmetric 4x4 matrix summing squared distances to planes, w is the summed weight
+struct Quadric {
+	float a00 = 0, a11 = 0, a22 = 0, a10 = 0, a20 = 0, a21 = 0;
+	float b0 = 0, b1 = 0, b2 = 0, c = 0;
+	float w = 0;
+
+	Quadric& operator+=(const Quadric& q) {
+		a00 += q.a00; a11 += q.a11; a22 += q.a22;
+		a10 += q.a10; a20 += q.a20; a21 += q.a21;
+		b0 += q.b0; b1 += q.b1; b2 += q.b2;
+		c += q.c;
+		w += q.w;
+		return *this;
+	}
+};
+
+Quadric planeQuadric(const glm::vec3& n, const float d, const float w) {
+	Quadric q;
+	q.a00 = w * n.x * n.x; q.a11 = w * n.y * n.y; q.a22 = w * n.z * n.z;
+	q.a10 = w * n.y * n.x; q.a20 = w * n.z * n.x; q.a21 = w * n.z * n.y;
+	q.b0 = w * n.x * d; q.b1 = w * n.y * d; q.b2 = w * n.z * d;
+	q.c = w * d * d;
+	q.w = w;
+	return q;
+}
+
+// Weighted mean of the squared distances from v to the planes
+float quadricError(const Quadric& q, const glm::vec3& v) {
+	const float rx = q.a00 * v.x + q.a10 * v.y + q.a20 * v.z;
+	const float ry = q.a10 * v.x + q.a11 * v.y + q.a21 * v.z;
+	const float rz = q.a20 * v.x + q.a21 * v.y + q.a22 * v.z;
+	const float r = rx * v.x + ry * v.y + rz * v.z + 2.0f * (q.b0 * v.x + q.b1 * v.y + q.b2 * v.z) + q.c;
+	return q.w > 0.0f ? std::abs(r) / q.w : 0.0f;
+}
+
+// Triangles around each vertex as the two other corners in winding order
+class Adjacency {
+public:
+	struct Edge {
+		uint32_t next, prev;
+	};
+
+	void build(const std::vector<uint32_t>& indices, const size_t numVertices) {
+		counts_.assign(numVertices, 0);
+		for (uint32_t index : indices) counts_[index]++;
+		offsets_.resize(numVertices + 1);
+		offsets_[0] = 0;
+		for (size_t v = 0; v < numVertices; v++) offsets_[v + 1] = offsets_[v] + counts_[v];
+
+		edges_.resize(indices.size());
+		std::fill(counts_.begin(), counts_.end(), 0);
+		for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+			const uint32_t a = indices[i + 0], b = indices[i + 1], c = indices[i + 2];
+			edges_[offsets_[a] + counts_[a]++] = {b, c};
+			edges_[offsets_[b] + counts_[b]++] = {c, a};
+			edges_[offsets_[c] + counts_[c]++] = {a, b};
+		}
+	}
+
+	const Edge* begin(const uint32_t v) const { return edges_.data() + offsets_[v]; }
+	const Edge* end(const uint32_t v) const { return edges_.data() + offsets_[v] + counts_[v]; }
+
+	bool hasEdge(const uint32_t a, const uint32_t b) const {
+		for (const Edge* e = begin(a); e != end(a); e++) {
+			if (e->next == b) return true;
+		}
+		return false;
+	}
+
+private:
+	std::vector<uint32_t> counts_, offsets_;
+	std::vector<Edge> edges_;
+};
+
+struct Collapse {
+	uint32_t v0, v1;	// v0 moves onto v1
+	bool bidirectional;
+	float error;
+};
+
+// Whether moving c to d turns the triangle abc around
+bool hasTriangleFlip(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& d) {
+	const glm::vec3 eb = b - a;
+	return glm::dot(glm::cross(eb, c - a), glm::cross(eb, d - a)) <= 0.0f;
+}
+
+// Follows the open edge loops through the vertices collapsed in the last pass
+void remapEdgeLoops(std::vector<uint32_t>* loop, const std::vector<uint32_t>& collapseRemap) {
+	std::vector<uint32_t>& l = *loop;
+	for (size_t i = 0; i < l.size(); i++) {
+		if (l[i] == k_Unused) continue;
+		const uint32_t target = l[i];
+		const uint32_t moved = collapseRemap[target];
+		// The seam edge collapsed against the loop direction, skip the removed vertex
+		l[i] = (moved == i) ? l[target] : moved;
+	}
+}
+
+}
+
+float MeshSimplifier::simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+	const uint32_t targetIndices, const float maxError, std::vector<uint32_t>* result) {
+	*result = indices;
+	const size_t count = vertices.size();
+	if (!count || indices.size() <= targetIndices) return 0.0f;
+
+	// Work in a unit cube so the errors do not depend on the model scale
+	glm::vec3 min = vertices[0].Position, max = vertices[0].Position;
+	for (const Vertex& vertex : vertices) {
+		min = glm::min(min, vertex.Position);
+		max = glm::max(max, vertex.Position);
+	}
+	const float extent = std::max(std::max(max.x - min.x, max.y - min.y), max.z - min.z);
+	const float scale = extent > 0.0f ? 1.0f / extent : 0.0f;
+	std::vector<glm::vec3> positions(count);
+	for (size_t i = 0; i < count; i++) {
+		positions[i] = (vertices[i].Position - min) * scale;
+	}
+
+	size_t tableSize = 1;
+	while (tableSize < count * 2) tableSize <<= 1;
+	const size_t mask = tableSize - 1;
+	std::vector<uint32_t> table;
+
+	// Splits of the tangent frame alone are no seam worth keeping, the triangles
+	// move to the first vertex with the same position, normal and UV
+	{
+		const size_t keySize = offsetof(Vertex, Tangent);
+		table.assign(tableSize, k_Unused);
+		std::vector<uint32_t> canonical(count);
+		for (uint32_t i = 0; i < count; i++) {
+			size_t slot = hashBytes(&vertices[i], keySize) & mask;
+			while (table[slot] != k_Unused && memcmp(&vertices[table[slot]], &vertices[i], keySize) != 0) {
+				slot = (slot + 1) & mask;
+			}
+			if (table[slot] == k_Unused) table[slot] = i;
+			canonical[i] = table[slot];
+		}
+		for (uint32_t& index : *result) index = canonical[index];
+	}
+
+	// Vertices at the same position, remap points at the first one and wedge links them in a ring.
+	// Vertices no triangle uses here would look like seams, they stay out of the rings
+	std::vector<uint32_t> remap(count), wedge(count);
+	{
+		std::vector<uint8_t> used(count, 0);
+		for (uint32_t index : *result) used[index] = 1;
+
+		table.assign(tableSize, k_Unused);
+		for (uint32_t i = 0; i < count; i++) {
+			if (!used[i]) {
+				remap[i] = wedge[i] = i;
+				continue;
+			}
+			const glm::vec3& position = vertices[i].Position;
+			size_t slot = hashBytes(&position, sizeof(glm::vec3)) & mask;
+			while (table[slot] != k_Unused && memcmp(&vertices[table[slot]].Position, &position, sizeof(glm::vec3)) != 0) {
+				slot = (slot + 1) & mask;
+			}
+			if (table[slot] == k_Unused) {
+				table[slot] = i;
+				remap[i] = wedge[i] = i;
+			}
+			else {
+				const uint32_t first = table[slot];
+				remap[i] = first;
+				wedge[i] = wedge[first];
+				wedge[first] = i;
+			}
+		}
+	}
+
+	Adjacency adjacency;
+	adjacency.build(*result, count);
+
+	// Open edges per vertex, the vertex itself when there is more than one
+	std::vector<uint32_t> openIn(count, k_Unused), openOut(count, k_Unused);
+	for (uint32_t v = 0; v < count; v++) {
+		for (const Adjacency::Edge* e = adjacency.begin(v); e != adjacency.end(v); e++) {
+			const uint32_t target = e->next;
+			if (adjacency.hasEdge(target, v)) continue;
+			openIn[target] = (openIn[target] == k_Unused) ? v : target;
+			openOut[v] = (openOut[v] == k_Unused) ? target : v;
+		}
+	}
+
+	std::vector<uint8_t> kinds(count, k_Locked);
+	for (uint32_t i = 0; i < count; i++) {
+		if (remap[i] != i) continue;
+		uint8_t kind = k_Locked;
+		if (wedge[i] == i) {
+			if (openIn[i] == k_Unused && openOut[i] == k_Unused) kind = k_Manifold;
+			else if (openIn[i] != k_Unused && openIn[i] != i && openOut[i] != k_Unused && openOut[i] != i) kind = k_Border;
+		}
+		else if (wedge[wedge[i]] == i) {
+			// A seam has one loop going in on each side, meeting the other side's loop going out
+			const uint32_t w = wedge[i];
+			const uint32_t inV = openIn[i], outV = openOut[i], inW = openIn[w], outW = openOut[w];
+			if (inV != k_Unused && inV != i && outV != k_Unused && outV != i &&
+				inW != k_Unused && inW != w && outW != k_Unused && outW != w &&
+				remap[inV] == remap[outW] && remap[outV] == remap[inW]) {
+				kind = k_Seam;
+			}
+		}
+		for (uint32_t v = i;;) {
+			kinds[v] = kind;
+			v = wedge[v];
+			if (v == i) break;
+		}
+	}
+
+	// Face planes weighted by area, open edges add a plane across the edge
+	std::vector<Quadric> quadrics(count);
+	for (size_t t = 0; t + 2 < result->size(); t += 3) {
+		const uint32_t corners[3] = { (*result)[t], (*result)[t + 1], (*result)[t + 2] };
+		const glm::vec3& p0 = positions[corners[0]];
+		glm::vec3 normal = glm::cross(positions[corners[1]] - p0, positions[corners[2]] - p0);
+		const float area = glm::length(normal);
+		if (area > 0.0f) {
+			normal /= area;
+			quadrics[remap[corners[0]]] += planeQuadric(normal, -glm::dot(normal, p0), area);
+			quadrics[remap[corners[1]]] += planeQuadric(normal, -glm::dot(normal, p0), area);
+			quadrics[remap[corners[2]]] += planeQuadric(normal, -glm::dot(normal, p0), area);
+		}
+
+		for (int e = 0; e < 3; e++) {
+			const uint32_t i0 = corners[e], i1 = corners[(e + 1) % 3], i2 = corners[(e + 2) % 3];
+			if ((kinds[i0] != k_Border && kinds[i0] != k_Seam) || openOut[i0] != i1) continue;
+
+			glm::vec3 edge = positions[i1] - positions[i0];
+			const float length = glm::length(edge);
+			if (length == 0.0f) continue;
+			edge /= length;
+			const glm::vec3 toOpposite = positions[i2] - positions[i0];
+			glm::vec3 across = toOpposite - edge * glm::dot(toOpposite, edge);
+			const float height = glm::length(across);
+			if (height == 0.0f) continue;
+			across /= height;
+			const Quadric q = planeQuadric(across, -glm::dot(across, positions[i0]), length * k_EdgeWeight);
+			quadrics[remap[i0]] += q;
+			quadrics[remap[i1]] += q;
+		}
+	}
+
+	const float errorLimit = maxError * scale * maxError * scale;
+	float resultError = 0.0f;
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> order;
+	std::vector<uint32_t> collapseRemap(count);
+	std::vector<uint8_t> locked(count);
+
+	while (result->size() > targetIndices) {
+		adjacency.build(*result, count);
+
+		// Candidate edges, each once, in the direction the kinds allow
+		collapses.clear();
+		for (size_t t = 0; t + 2 < result->size(); t += 3) {
+			for (int e = 0; e < 3; e++) {
+				const uint32_t i0 = (*result)[t + e], i1 = (*result)[t + (e + 1) % 3];
+				if (remap[i0] == remap[i1]) continue;
+				const uint8_t k0 = kinds[i0], k1 = kinds[i1];
+				if (!(k_CanCollapse[k0][k1] | k_CanCollapse[k1][k0])) continue;
+				if (k_HasOpposite[k0][k1] && remap[i1] > remap[i0]) continue;
+				// Two border or seam vertices not linked by their loop belong to different loops
+				if (k0 == k1 && (k0 == k_Border || k0 == k_Seam) && openOut[i0] != i1) continue;
+
+				if (k_CanCollapse[k0][k1] & k_CanCollapse[k1][k0]) collapses.push_back({i0, i1, true, 0.0f});
+				else if (k_CanCollapse[k0][k1]) collapses.push_back({i0, i1, false, 0.0f});
+				else collapses.push_back({i1, i0, false, 0.0f});
+			}
+		}
+		if (collapses.empty()) break;
+
+		// Cost of the merged quadric at the target, both ways when allowed
+		for (Collapse& c : collapses) {
+			Quadric merged = quadrics[remap[c.v0]];
+			merged += quadrics[remap[c.v1]];
+			c.error = quadricError(merged, positions[c.v1]);
+			if (c.bidirectional) {
+				const float reverse = quadricError(merged, positions[c.v0]);
+				if (reverse < c.error) {
+					std::swap(c.v0, c.v1);
+					c.error = reverse;
+				}
+			}
+		}
+		order.resize(collapses.size());
+		for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+		std::sort(order.begin(), order.end(), [&collapses](const uint32_t a, const uint32_t b) {
+			return collapses[a].error < collapses[b].error;
+		});
+
+		// Most collapses remove two triangles
+		const size_t triangleGoal = (result->size() - targetIndices) / 3;
+		const size_t edgeGoal = std::max<size_t>(triangleGoal / 2, 1);
+		const float passBound = edgeGoal < order.size() ?
+			collapses[order[edgeGoal]].error * k_PassErrorBound : collapses[order.back()].error;
+
+		for (uint32_t i = 0; i < count; i++) collapseRemap[i] = i;
+		std::fill(locked.begin(), locked.end(), 0);
+		size_t removed = 0, performed = 0;
+		for (uint32_t index : order) {
+			const Collapse& c = collapses[index];
+			if (c.error > errorLimit || c.error > passBound) break;
+
+			// Each position moves at most once per pass, so the ranking stays exact
+			const uint32_t r0 = remap[c.v0], r1 = remap[c.v1];
+			if (locked[r0] || locked[r1]) continue;
+
+			bool flips = false;
+			for (uint32_t v = c.v0; !flips;) {
+				for (const Adjacency::Edge* e = adjacency.begin(v); e != adjacency.end(v); e++) {
+					const uint32_t a = collapseRemap[e->next], b = collapseRemap[e->prev];
+					if (remap[a] == r1 || remap[b] == r1) continue;	// Removed by the collapse
+					if (hasTriangleFlip(positions[a], positions[b], positions[c.v0], positions[c.v1])) {
+						flips = true;
+						break;
+					}
+				}
+				v = wedge[v];
+				if (v == c.v0) break;
+			}
+			if (flips) continue;
+
+			const uint8_t kind = kinds[c.v0];
+			if (kind == k_Seam) {
+				// The other side of the seam follows onto the matching vertex of the target
+				const uint32_t s0 = wedge[c.v0];
+				const uint32_t s1 = openOut[c.v0] == c.v1 ? openIn[s0] : openOut[s0];
+				if (s1 == k_Unused || remap[s1] != r1) continue;
+				collapseRemap[c.v0] = c.v1;
+				collapseRemap[s0] = s1;
+			}
+			else {
+				collapseRemap[c.v0] = c.v1;
+			}
+
+			locked[r0] = locked[r1] = 1;
+			quadrics[r1] += quadrics[r0];
+			resultError = std::max(resultError, c.error);
+			performed++;
+			removed += kind == k_Border ? 1 : 2;
+			if (removed >= triangleGoal) break;
+		}
+		if (!performed) break;
+
+		// Move the indices and drop the triangles that lost their area
+		size_t write = 0;
+		for (size_t t = 0; t + 2 < result->size(); t += 3) {
+			const uint32_t a = collapseRemap[(*result)[t]], b = collapseRemap[(*result)[t + 1]],
+				c = collapseRemap[(*result)[t + 2]];
+			if (remap[a] == remap[b] || remap[b] == remap[c] || remap[c] == remap[a]) continue;
+			(*result)[write++] = a;
+			(*result)[write++] = b;
+			(*result)[write++] = c;
+		}
+		result->resize(write);
+		remapEdgeLoops(&openOut, collapseRemap);
+		remapEdgeLoops(&openIn, collapseRemap);
+	}
+
+	return extent * std::sqrt(resultError);
+}
+
+std::vector<MeshLod> MeshSimplifier::buildLodChain(const std::vector<Vertex>& vertices, std::vector<uint32_t>* indices,
+	const uint32_t maxLods, const float maxRelativeError) {
+	std::vector<MeshLod> lods;
+	lods.push_back({ 0, static_cast<uint32_t>(indices->size()), 0.0f });
+
+	const glm::vec4 sphere = Mesh::computeBoundingSphere(vertices.data(), static_cast<uint32_t>(vertices.size()));
+	const float maxError = maxRelativeError * 2.0f * sphere.w;
+
+	// Each LOD starts from the previous one, so their errors add up
+	std::vector<uint32_t> previous(*indices), lod;
+	float error = 0.0f;
+	for (uint32_t level = 1; level <= maxLods; level++) {
+		const uint32_t target = static_cast<uint32_t>(previous.size() / 6 * 3);
+		error += simplify(vertices, previous, target, maxError - error, &lod);
+		if (lod.empty() || lod.size() > previous.size() * (1.0f - k_MinReduction)) break;
+
+		MeshOptimizer::optimizeVertexCache(&lod, static_cast<uint32_t>(vertices.size()));
+		lods.push_back({ static_cast<uint32_t>(indices->size()), static_cast<uint32_t>(lod.size()), error });
+		indices->insert(indices->end(), lod.begin(), lod.end());
+		previous.swap(lod);
+	}
+	return lods;
+}
@@ -1,53 +1,390 @@
 #define STB_IMAGE_IMPLEMENTATION 
 
 #include "model.h"
+#include "camera.h"
+#include "frustum.h"
+#include "gl_state.h"
+#include "mesh_cache.h"
+#include "mesh_simplifier.h"
+#include "obj_loader.h"
+#include "texture_registry.h"
+#include "thread_pool.h"
+#include "upload_service.h"
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
 #include <iostream>
 #include <glad/glad.h>
+#include <glm/gtc/type_ptr.hpp>
 #include <stb_image.h>
 
-Model::Model(std::string const &path, bool gamma) : gammaCorrection_(gamma) {
+// Import flags, also part of the mesh cache key
+static const uint32_t k_ImportFlags = aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+
+// Engine side processing that changes the cached meshes
+static const uint32_t k_ProcessOptimize = 1 << 0;
+static const uint32_t k_ProcessNativeObj = 1 << 1;
+static const uint32_t k_ProcessLods = 1 << 2;
+
+static bool isObj(const std::string& path) {
+	const size_t dot = path.find_last_of('.');
+	if (dot == std::string::npos) return false;
+	std::string extension = path.substr(dot + 1);
+	for (char& c : extension) c = static_cast<char>(tolower(c));
+	return extension == "obj";
+}
+
+static constexpr UniformName k_ModelUniform("model");
+static constexpr UniformName k_NormalMatUniform("normalMat");
+
+// AABB around the box min, max once transformed by matrix
+static void transformBox(const glm::mat4& matrix, const glm::vec3& min, const glm::vec3& max,
+	glm::vec3* outMin, glm::vec3* outMax) {
+	const glm::vec3 center = glm::vec3(matrix * glm::vec4((min + max) * 0.5f, 1.0f));
+	const glm::mat3 axes(matrix);
+	const glm::mat3 absAxes(glm::abs(axes[0]), glm::abs(axes[1]), glm::abs(axes[2]));
+	const glm::vec3 extent = absAxes * ((max - min) * 0.5f);
+	*outMin = center - extent;
+	*outMax = center + extent;
+}
+
+// Coarsest LOD of mesh whose error stays within the view's pixel budget once placed by world
+static uint32_t pickLod(const Mesh& mesh, const glm::mat4& world, const LodView& view) {
+	if (mesh.lods_.empty()) return 0;
+
+	// Distance to the nearest point of the bounding sphere, inside it the full mesh is used
+	const float scale = std::max(std::max(glm::length(glm::vec3(world[0])), glm::length(glm::vec3(world[1]))),
+		glm::length(glm::vec3(world[2])));
+	const glm::vec3 center = glm::vec3(world * glm::vec4(glm::vec3(mesh.boundingSphere_), 1.0f));
+	const float distance = glm::length(center - view.position) - mesh.boundingSphere_.w * scale;
+	uint32_t lod = 0;
+	if (distance > 0.0f) {
+		// Errors shrink linearly with the distance
+		while (lod + 1 < mesh.lods_.size() &&
+			mesh.lods_[lod + 1].error * scale * view.pixelsPerUnit <= view.maxPixelError * distance) {
+			lod++;
+		}
+	}
+	return lod;
+}
+
+LodView::LodView(const glm::vec3& position, const float fov, const float viewportHeight, const float maxPixelError) :
+	position(position), pixelsPerUnit(viewportHeight * 0.5f / std::tan(glm::radians(fov) * 0.5f)),
+	maxPixelError(maxPixelError) {
+}
+
+Model::Model(std::string const &path, const ModelOptions& options) :
+	gammaCorrection_(options.gamma), options_(options) {
 	loadModel(path);
+
+	// Formats without a hierarchy place every mesh at the origin
+	if (!scene_.size()) scene_.addNode(k_NoParent, glm::mat4(1.0f), 0, static_cast<uint32_t>(meshes_.size()));
+	for (const Mesh& mesh : meshes_) bounds_.add(mesh.boundsMin_, mesh.boundsMax_);
+	for (uint32_t node = 0; node < scene_.size(); node++) placeBounds(node);
+	meshNodes_.assign(meshes_.size(), 0);
+	for (uint32_t node = 0; node < scene_.size(); node++) {
+		const uint32_t end = scene_.firstMesh(node) + scene_.numMeshes(node);
+		for (uint32_t i = scene_.firstMesh(node); i < end; i++) meshNodes_[i] = node;
+	}
+	findInstanceNodes();
+	visible_.assign(meshes_.size(), 1);
 }
 
 void Model::loadModel(std::string const path) {
-	// Read file via ASSIMP
-	Assimp::Importer importer;
-	const aiScene* scene = importer.ReadFile(path.c_str(), aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+	// Retreieve the directory path of the filepath
+	directory_ = path.substr(0, path.find_last_of('/'));
 
-	// Check for errors
-	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-		std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
+	// A valid cache holds the final meshes, so ASSIMP does not need to run
+	const std::string cachePath = path + ".meshcache";
+	const bool native = options_.nativeObj && isObj(path);
+	const uint32_t processFlags = (options_.optimize ? k_ProcessOptimize : 0) | (native ? k_ProcessNativeObj : 0) |
+		(options_.lods ? k_ProcessLods : 0);
+	const uint64_t key = options_.useCache ? MeshCache::computeKey(path, k_ImportFlags, processFlags) : 0;
+	MeshCache cache;
+	if (key && cache.open(cachePath, key)) {
+		loadStats_.fromCache = true;
+		loadCache(cache);
 		return;
 	}
-	// Retreieve the directory path of the filepath
-	directory_ = path.substr(0, path.find_last_of('/'));
 
-	// Process ASSIMP's root node recursively
-	processNode(scene->mRootNode, scene);
+	std::vector<MeshData> data;
+	if (native) {
+		if (!loadObj(path, &data)) return;
+	} else {
+		// Read file via ASSIMP
+		Assimp::Importer importer;
+		const aiScene* scene = importer.ReadFile(path.c_str(), k_ImportFlags);
+
+		// Check for errors
+		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+			std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
+			return;
+		}
+
+		// Process ASSIMP's root node recursively
+		std::vector<aiMesh*> meshes;
+		processNode(scene->mRootNode, scene, k_NoParent, &meshes);
+		processMeshes(meshes, scene, &data);
+		// Not needed anymore, free it before the GPU copies are made
+		importer.FreeScene();
+	}
+	buildMeshes(&data);
+
+	if (key) MeshCache::write(cachePath, key, meshes_, scene_);
+
+	std::vector<MeshSource> sources;
+	for (const Mesh& mesh : meshes_) {
+		sources.push_back(MeshSource{ mesh.vertices_.data(), static_cast<uint32_t>(mesh.vertices_.size()),
+			mesh.indices_.data(), static_cast<uint32_t>(mesh.indices_.size()) });
+	}
+	uploadMeshes(sources);
 }
 
-void Model::processNode(aiNode *node, const aiScene *scene) {
+void Model::loadCache(const MeshCache& cache) {
+	// Vertices and indices are uploaded straight from the mapped file
+	std::vector<MeshSource> sources;
+	meshes_.reserve(cache.meshes().size());
+	for (const MeshCache::MeshView& view : cache.meshes()) {
+		std::vector<Texture> textures;
+		for (const Texture& reference : view.textures) {
+			textures.push_back(loadTexture(reference.path.c_str(), reference.type));
+		}
+		meshes_.push_back(Mesh(view.vertices, view.numVertices, view.indices, view.numIndices, std::move(textures), false));
+		meshes_.back().lods_ = view.lods;
+		meshes_.back().boundingSphere_ = view.boundingSphere;
+		meshes_.back().boundsMin_ = view.boundsMin;
+		meshes_.back().boundsMax_ = view.boundsMax;
+		sources.push_back(MeshSource{ view.vertices, view.numVertices, view.indices, view.numIndices });
+	}
+	scene_ = cache.scene();
+	uploadMeshes(sources);
+}
+
+bool Model::loadObj(const std::string& path, std::vector<MeshData>* data) {
+	ObjLoader loader;
+	if (!loader.load(path)) return false;
+
+	data->resize(loader.meshes().size());
+	for (size_t i = 0; i < data->size(); i++) {
+		ObjLoader::ObjMesh& mesh = loader.meshes()[i];
+		(*data)[i].vertices = std::move(mesh.vertices);
+		(*data)[i].indices = std::move(mesh.indices);
+		(*data)[i].textures = std::move(mesh.textures);
+	}
+	return true;
+}
+
+void Model::processNode(aiNode *node, const aiScene *scene, const uint32_t parent, std::vector<aiMesh*>* meshes) {
 	// Process each mesh located at the current node
+	const uint32_t firstMesh = static_cast<uint32_t>(meshes->size());
 	for (uint32_t i = 0; i < node->mNumMeshes; i++) {
 		// The node object only contains indices to index the actual object in the scene
 		// The scene contains all the data, node is just to keep stuff organized (like relations between nodes)
-		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-		meshes_.push_back(processMesh(mesh, scene));
+		meshes->push_back(scene->mMeshes[node->mMeshes[i]]);
 	}
+	// ASSIMP matrices are row major
+	const glm::mat4 local = glm::transpose(glm::make_mat4(&node->mTransformation.a1));
+	const uint32_t index = scene_.addNode(parent, local, firstMesh, node->mNumMeshes);
 	// Process recursively each of the children nodes after all meshes have been processed
 	for (uint32_t i = 0; i < node->mNumChildren; i++) {
-		processNode(node->mChildren[i], scene);
+		processNode(node->mChildren[i], scene, index, meshes);
 	}
 }
 
-Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene) {
+void Model::processMeshes(const std::vector<aiMesh*>& meshes, const aiScene *scene, std::vector<MeshData>* data) {
+	// Each worker fills its own slot, so the order does not depend on scheduling
+	data->resize(meshes.size());
+	ThreadPool::instance().parallelFor(static_cast<uint32_t>(meshes.size()), [&](uint32_t i) {
+		(*data)[i] = processMesh(meshes[i], scene);
+	});
+}
+
+void Model::buildMeshes(std::vector<MeshData>* meshes) {
+	std::vector<MeshData>& data = *meshes;
+	ThreadPool::instance().parallelFor(static_cast<uint32_t>(data.size()), [&](uint32_t i) {
+		MeshData& mesh = data[i];
+		if (options_.optimize) {
+			MeshOptimizer::optimize(&mesh.vertices, &mesh.indices, &mesh.before, &mesh.after);
+		}
+		if (options_.lods) {
+			// Collapses need shared vertices between triangles, optimize already welded them
+			if (!options_.optimize) MeshOptimizer::weldVertices(&mesh.vertices, &mesh.indices);
+			mesh.lods = MeshSimplifier::buildLodChain(mesh.vertices, &mesh.indices);
+		}
+		const uint32_t numVertices = static_cast<uint32_t>(mesh.vertices.size());
+		Mesh::computeBounds(mesh.vertices.data(), numVertices, &mesh.boundsMin, &mesh.boundsMax);
+		mesh.boundingSphere = Mesh::computeBoundingSphere(mesh.vertices.data(), numVertices);
+	});
+
+	if (options_.optimize) {
+		for (const MeshData& mesh : data) {
+			loadStats_.before += mesh.before;
+			loadStats_.after += mesh.after;
+		}
+	}
+	if (options_.lods) {
+		// Meshes too small to simplify keep fewer levels and count with their last one
+		size_t numLevels = 0;
+		for (const MeshData& mesh : data) numLevels = std::max(numLevels, mesh.lods.size());
+		std::vector<uint32_t>& triangles = loadStats_.lodTriangles;
+		triangles.assign(numLevels, 0);
+		for (const MeshData& mesh : data) {
+			for (size_t level = 0; level < triangles.size() && !mesh.lods.empty(); level++) {
+				triangles[level] += mesh.lods[std::min(level, mesh.lods.size() - 1)].numIndices / 3;
+			}
+		}
+	}
+
+	// Textures and buffers need the GL context of this thread
+	meshes_.reserve(meshes_.size() + data.size());
+	for (MeshData& mesh : data) {
+		std::vector<Texture> textures;
+		for (const Texture& reference : mesh.textures) {
+			textures.push_back(loadTexture(reference.path.c_str(), reference.type));
+		}
+		meshes_.push_back(Mesh(std::move(mesh.vertices), std::move(mesh.indices), std::move(textures), false));
+		meshes_.back().lods_ = std::move(mesh.lods);
+		meshes_.back().boundingSphere_ = mesh.boundingSphere;
+		meshes_.back().boundsMin_ = mesh.boundsMin;
+		meshes_.back().boundsMax_ = mesh.boundsMax;
+	}
+}
+
+void Model::uploadMeshes(const std::vector<MeshSource>& sources) {
+	// The packed copies only have to live until the uploads below take theirs
+	std::vector<MeshBytes> bytes(sources.size());
+	std::vector<std::vector<PackedVertex>> packedVertices;
+	std::vector<std::vector<uint16_t>> packedIndices;
+	if (options_.pack) {
+		packMeshes(sources, &bytes, &packedVertices, &packedIndices);
+	} else {
+		for (size_t i = 0; i < sources.size(); i++) {
+			const MeshSource& source = sources[i];
+			bytes[i] = MeshBytes{ source.vertices, source.numVertices * sizeof(Vertex),
+				source.indices, source.numIndices * sizeof(uint32_t) };
+		}
+	}
+
+	if (options_.merge) {
+		mergeMeshes(bytes);
+		return;
+	}
+
+	for (size_t i = 0; i < bytes.size(); i++) {
+		const MeshBytes& mesh = bytes[i];
+		if (!options_.uploads) {
+			uint32_t VBO, EBO;
+			Mesh::createBuffers(mesh.vertices, mesh.vertexBytes, mesh.indices, mesh.indexBytes, &VBO, &EBO);
+			meshes_[i].setupBuffers(VBO, EBO);
+		} else {
+			// Meshes are addressed by index, the vector may move before the callback runs
+			options_.uploads->uploadMesh(mesh.vertices, mesh.vertexBytes, mesh.indices, mesh.indexBytes,
+				[this, i](uint32_t VBO, uint32_t EBO) {
+					meshes_[i].setupBuffers(VBO, EBO);
+				});
+		}
+		// Both paths have their own copy now
+		if (options_.releaseCpuData) meshes_[i].releaseCpuData();
+	}
+}
+
+void Model::packMeshes(const std::vector<MeshSource>& sources, std::vector<MeshBytes>* bytes,
+	std::vector<std::vector<PackedVertex>>* vertices, std::vector<std::vector<uint16_t>>* indices) {
+	// Merged meshes share one index type, their indices are local to the base vertex
+	bool allShort = true;
+	for (const MeshSource& source : sources) {
+		allShort = allShort && source.numVertices < VertexPacking::k_ShortIndexLimit;
+	}
+
+	vertices->resize(sources.size());
+	indices->resize(sources.size());
+	ThreadPool::instance().parallelFor(static_cast<uint32_t>(sources.size()), [&](uint32_t i) {
+		const MeshSource& source = sources[i];
+		const bool shortIndices = options_.merge ? allShort : source.numVertices < VertexPacking::k_ShortIndexLimit;
+
+		std::vector<PackedVertex>& packed = (*vertices)[i];
+		packed.resize(source.numVertices);
+		const PositionDecode decode = VertexPacking::packVertices(source.vertices, source.numVertices, packed.data());
+		meshes_[i].setPacked(decode.scale, decode.offset, shortIndices);
+
+		MeshBytes& mesh = (*bytes)[i];
+		mesh.vertices = packed.data();
+		mesh.vertexBytes = packed.size() * sizeof(PackedVertex);
+		if (shortIndices) {
+			std::vector<uint16_t>& packedIndices = (*indices)[i];
+			packedIndices.resize(source.numIndices);
+			VertexPacking::packIndices(source.indices, source.numIndices, packedIndices.data());
+			mesh.indices = packedIndices.data();
+			mesh.indexBytes = packedIndices.size() * sizeof(uint16_t);
+		} else {
+			mesh.indices = source.indices;
+			mesh.indexBytes = source.numIndices * sizeof(uint32_t);
+		}
+	});
+}
+
+void Model::mergeMeshes(const std::vector<MeshBytes>& bytes) {
+	size_t vertexBytes = 0, indexBytes = 0;
+	for (const MeshBytes& mesh : bytes) {
+		vertexBytes += mesh.vertexBytes;
+		indexBytes += mesh.indexBytes;
+	}
+
+	// Indices stay local to their mesh, the draw adds the base vertex.
+	// Every mesh has the same vertex format and index size here
+	std::vector<uint8_t> vertices;
+	std::vector<uint8_t> indices;
+	vertices.reserve(vertexBytes);
+	indices.reserve(indexBytes);
+	for (size_t i = 0; i < bytes.size(); i++) {
+		const MeshBytes& mesh = bytes[i];
+		meshes_[i].setRange(static_cast<int32_t>(vertices.size() / meshes_[i].vertexSize()),
+			static_cast<uint32_t>(indices.size() / meshes_[i].indexSize()));
+		const uint8_t* meshVertices = static_cast<const uint8_t*>(mesh.vertices);
+		const uint8_t* meshIndices = static_cast<const uint8_t*>(mesh.indices);
+		vertices.insert(vertices.end(), meshVertices, meshVertices + mesh.vertexBytes);
+		indices.insert(indices.end(), meshIndices, meshIndices + mesh.indexBytes);
+		if (options_.releaseCpuData) meshes_[i].releaseCpuData();
+	}
+
+	if (options_.uploads) {
+		options_.uploads->uploadMesh(vertices.data(), vertices.size(), indices.data(), indices.size(),
+			[this](uint32_t VBO, uint32_t EBO) {
+				setupMergedBuffers(VBO, EBO);
+			});
+		return;
+	}
+
+	uint32_t VBO, EBO;
+	Mesh::createBuffers(vertices.data(), vertices.size(), indices.data(), indices.size(), &VBO, &EBO);
+	setupMergedBuffers(VBO, EBO);
+}
+
+void Model::setupMergedBuffers(const uint32_t VBO, const uint32_t EBO) {
+	VBO_.reset(VBO);
+	EBO_.reset(EBO);
+
+	uint32_t VAO;
+	glGenVertexArrays(1, &VAO);
+	VAO_.reset(VAO);
+	GLState::bindVertexArray(VAO);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, VBO);
+	GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	Mesh::setupVertexLayout(options_.pack ? VertexFormat::Packed : VertexFormat::Full);
+	GLState::bindVertexArray(0);
+}
+
+Model::MeshData Model::processMesh(aiMesh *mesh, const aiScene *scene) {
 	// Data to fill
-	std::vector<Vertex> vertices;
-	std::vector<uint32_t> indices;
-	std::vector<Texture> textures;
+	MeshData data;
+	std::vector<Vertex>& vertices = data.vertices;
+	std::vector<uint32_t>& indices = data.indices;
+	std::vector<Texture>& textures = data.textures;
+	vertices.reserve(mesh->mNumVertices);
+	indices.reserve(mesh->mNumFaces * 3);
 
 	// Each of the mesh's vertices
 	for (uint32_t i = 0; i < mesh->mNumVertices; i++) { 
@@ -120,75 +457,254 @@ Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene) {
 	std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT,	"texture_height");
 	textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
-	return Mesh(vertices, indices, textures);
+	return data;
 }
 
-static unsigned int TextureFromFile(const char *path, const std::string &directory, bool gamme) {
-	std::string fileName = std::string(path);
-	fileName = directory + '/' + fileName;
-	
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
+std::vector<Texture> Model::loadMaterialTextures(aiMaterial *mat, aiTextureType type, std::string typeName) {
+	std::vector<Texture> textures;
+	for (uint32_t i = 0; i < mat->GetTextureCount(type); i++) {
+		aiString str;
+		mat->GetTexture(type, i, &str);
+		Texture texture;	// Loaded later on the GL thread
+		texture.type = typeName;
+		texture.path = str.C_Str();
+		textures.push_back(texture);
+	}
+	return textures;
+}
+
+Texture Model::loadTexture(const char* path, const std::string& typeName) {
+	// The registry shares the GL texture with every model that uses the same file
+	Texture texture;
+	texture.type = typeName;
+	texture.path = path;
+	texture.handle = TextureRegistry::instance().acquire(directory_ + '/' + texture.path, options_.uploads);
+	return texture;
+}
+
+void Model::selectLods(const Camera& camera, const glm::mat4& model, const float viewportHeight,
+	const float maxPixelError) {
+	selectLods(LodView(camera.getPosition(), camera.getFOV(), viewportHeight, maxPixelError), model);
+}
 
-	int widht, height, nrComponents;
-	unsigned char * data = stbi_load(fileName.c_str(), &widht, &height, &nrComponents, 0);
-	if (data) {
-		GLenum format;
-		if (nrComponents == 1) {
-			format = GL_RED;
+void Model::selectLods(const LodView& view, const glm::mat4& model) {
+	for (uint32_t i = 0; i < meshes_.size(); i++) {
+		Mesh& mesh = meshes_[i];
+		if (!mesh.lods_.empty()) mesh.setLod(pickLod(mesh, model * scene_.world(meshNodes_[i]), view));
+	}
+}
+
+bool Model::hasLods() const {
+	for (const Mesh& mesh : meshes_)
+		if (!mesh.lods_.empty()) return true;
+	return false;
+}
+
+void Model::setNodeTransform(const uint32_t node, const glm::mat4& local) {
+	scene_.setLocal(node, local);
+}
+
+uint32_t Model::updateScene() {
+	updatedNodes_.clear();
+	const uint32_t count = scene_.update(&updatedNodes_);
+	for (const uint32_t node : updatedNodes_) placeBounds(node);
+	if (count) findInstanceNodes();
+	return count;
+}
+
+void Model::placeBounds(const uint32_t node) {
+	const glm::mat4& world = scene_.world(node);
+	const uint32_t end = scene_.firstMesh(node) + scene_.numMeshes(node);
+	for (uint32_t i = scene_.firstMesh(node); i < end; i++) {
+		glm::vec3 min, max;
+		transformBox(world, meshes_[i].boundsMin_, meshes_[i].boundsMax_, &min, &max);
+		bounds_.set(i, min, max);
+	}
+}
+
+uint32_t Model::cull(const glm::mat4& viewProj, const glm::mat4& model) {
+	// Model space planes, so the boxes are tested as they are stored
+	return bounds_.cull(Frustum(viewProj * model), visible_.data());
+}
+
+void Model::findInstanceNodes() {
+	instanceNodes_.clear();
+	meshBlocks_.clear();
+	bool atOrigin = true;
+	for (uint32_t node = 0; node < scene_.size(); node++) {
+		if (!scene_.numMeshes(node)) continue;
+		instanceNodes_.push_back(node);
+		atOrigin = atOrigin && scene_.world(node) == glm::mat4(1.0f);
+	}
+	if (atOrigin) {
+		instanceNodes_.clear();
+		return;
+	}
+
+	meshBlocks_.assign(meshes_.size(), 0);
+	for (uint32_t block = 0; block < instanceNodes_.size(); block++) {
+		const uint32_t node = instanceNodes_[block];
+		const uint32_t end = scene_.firstMesh(node) + scene_.numMeshes(node);
+		for (uint32_t i = scene_.firstMesh(node); i < end; i++) meshBlocks_[i] = block;
+	}
+}
+
+void Model::appendInstances(const glm::mat4* transforms, const uint32_t count, std::vector<glm::mat4>* matrices) const {
+	if (instanceNodes_.empty()) {
+		matrices->insert(matrices->end(), transforms, transforms + count);
+		return;
+	}
+	for (const uint32_t node : instanceNodes_) {
+		const glm::mat4& world = scene_.world(node);
+		for (uint32_t i = 0; i < count; i++) matrices->push_back(transforms[i] * world);
+	}
+}
+
+void Model::appendInstanceLods(const glm::mat4* transforms, const uint32_t count, const LodView& view,
+	std::vector<glm::mat4>* matrices, std::vector<InstanceRange>* ranges) const {
+	std::vector<uint32_t> levels(count);
+	for (uint32_t i = 0; i < meshes_.size(); i++) {
+		const Mesh& mesh = meshes_[i];
+		const glm::mat4& world = scene_.world(meshNodes_[i]);
+		const uint32_t numLods = mesh.numLods();
+		const size_t firstRange = ranges->size();
+		ranges->resize(firstRange + numLods, InstanceRange{ 0, 0 });
+		InstanceRange* meshRanges = ranges->data() + firstRange;
+		for (uint32_t j = 0; j < count; j++) {
+			levels[j] = pickLod(mesh, transforms[j] * world, view);
+			meshRanges[levels[j]].count++;
 		}
-		else if (nrComponents == 3) {
-			format = GL_RGB;
+
+		// Counting sort, the placements of each LOD follow those of the finer one
+		uint32_t first = static_cast<uint32_t>(matrices->size());
+		for (uint32_t lod = 0; lod < numLods; lod++) {
+			meshRanges[lod].first = first;
+			first += meshRanges[lod].count;
+			meshRanges[lod].count = 0;
 		}
-		else if (nrComponents == 4) {
-			format = GL_RGBA;
+		matrices->resize(first);
+		for (uint32_t j = 0; j < count; j++) {
+			InstanceRange& range = meshRanges[levels[j]];
+			(*matrices)[range.first + range.count++] = transforms[j] * world;
 		}
+	}
+}
 
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, widht, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
+uint32_t Model::drawInstanceLods(const Shader& shader, const uint32_t instanceBuffer,
+	const InstanceRange* ranges) const {
+	if (options_.merge) {
+		if (!VAO_) return 0; // Still streaming
+		GLState::bindVertexArray(VAO_.id());
+	}
 
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	uint32_t draws = 0;
+	for (const Mesh& mesh : meshes_) {
+		const InstanceRange* meshRanges = ranges;
+		ranges += mesh.numLods();
+		if (!options_.merge) {
+			if (!mesh.isReady()) continue;
+			GLState::bindVertexArray(mesh.vertexArray());
+		}
+
+		mesh.bindTextures(shader);
+		for (uint32_t lod = 0; lod < mesh.numLods(); lod++) {
+			const InstanceRange& range = meshRanges[lod];
+			if (!range.count) continue;
+			Mesh::setupInstanceLayout(instanceBuffer, range.first);
+			mesh.drawElements(shader, range.count, lod);
+			draws++;
+		}
 	}
-	else {
-		std::cout << "Failed to load the texture at path: " << path << std::endl;
-		stbi_image_free(data);
+	return draws;
+}
+
+void Model::Draw(const Shader& shader) const {
+	if (!instanceNodes_.empty() && !warnedNodes_) {
+		std::cout << "Error Model Nodes Are Transformed, Draw Without A Model Matrix Ignores Them" << std::endl;
+		warnedNodes_ = true;
 	}
-	return textureID;
+
+	if (options_.merge) {
+		if (!VAO_) return; // Still streaming
+
+		// One bind for the whole model, each mesh is a range of the shared buffers
+		GLState::bindVertexArray(VAO_.id());
+		for (uint32_t i = 0; i < meshes_.size(); i++)
+			if (visible_[i]) meshes_[i].drawRange(shader);
+		return;
+	}
+
+	for (uint32_t i = 0; i < meshes_.size(); i++)
+		if (visible_[i]) meshes_[i].Draw(shader);
 }
 
-std::vector<Texture> Model::loadMaterialTextures(aiMaterial *mat, aiTextureType type, std::string typeName) {
-	std::vector<Texture> textures;
-	for (uint32_t i = 0; i < mat->GetTextureCount(type); i++) {
-		aiString str;
-		mat->GetTexture(type, i, &str);
+void Model::Draw(const Shader& shader, const glm::mat4& model) const {
+	if (options_.merge) {
+		if (!VAO_) return; // Still streaming
+		GLState::bindVertexArray(VAO_.id());
+	}
+
+	const bool normalMat = shader.hasUniform(k_NormalMatUniform);
+	for (uint32_t node = 0; node < scene_.size(); node++) {
+		if (!scene_.numMeshes(node)) continue;
 
-		// Dheck if texture was loaded before
-		bool skip = false; 
-		for (uint32_t j = 0; j < textures_loaded_.size(); j++) {
-			if (std::strcmp(textures_loaded_[j].path.data(), str.C_Str()) == 0) {
-				textures.push_back(textures_loaded_[j]);
-				skip = true; // A texture with the same filepath has already been loaded, continue to the next
-				break;
+		const glm::mat4 world = model * scene_.world(node);
+		shader.set(k_ModelUniform, world);
+		if (normalMat) shader.set(k_NormalMatUniform, glm::inverse(glm::transpose(glm::mat3(world))));
+		const uint32_t end = scene_.firstMesh(node) + scene_.numMeshes(node);
+		for (uint32_t i = scene_.firstMesh(node); i < end; i++) {
+			if (!visible_[i]) continue;
+			if (options_.merge) {
+				meshes_[i].drawRange(shader);
+			} else {
+				meshes_[i].Draw(shader);
 			}
 		}
-		// if texture hasn't been loaded already, load it
-		if (!skip) { 
-			Texture texture;
-			texture.id = TextureFromFile(str.C_Str(), directory_, false);
-			texture.type = typeName;
-			texture.path = str.C_Str();
-			textures.push_back(texture);
-			textures_loaded_.push_back(texture); // Store it as a texture loaded for entire model
+	}
+}
+
+uint32_t Model::drawInstanced(const Shader& shader, const uint32_t instanceBuffer, const uint32_t firstInstance,
+	const uint32_t numInstances) const {
+	if (options_.merge) {
+		if (!VAO_) return 0; // Still streaming
+		GLState::bindVertexArray(VAO_.id());
+	}
+
+	// Each mesh reads the block of its node, one block for all when the nodes are at the origin
+	uint32_t draws = 0;
+	uint32_t laidOut = ~0u;	// Instance the shared VAO points at
+	for (uint32_t i = 0; i < meshes_.size(); i++) {
+		const Mesh& mesh = meshes_[i];
+		const uint32_t first = firstInstance + instanceBlock(i) * numInstances;
+		if (options_.merge) {
+			if (first != laidOut) Mesh::setupInstanceLayout(instanceBuffer, first);
+			laidOut = first;
+		} else {
+			if (!mesh.isReady()) continue;
+			GLState::bindVertexArray(mesh.vertexArray());
+			Mesh::setupInstanceLayout(instanceBuffer, first);
 		}
+		mesh.bindTextures(shader);
+		mesh.drawElements(shader, numInstances, 0);
+		draws++;
 	}
-	return textures;
+	return draws;
 }
 
-void Model::Draw(const Shader& shader) const {
-	for (uint32_t i = 0; i < meshes_.size(); i++)
-		meshes_[i].Draw(shader);
+void Model::submit(RenderQueue* queue, const Shader& shader, const glm::mat4& model, const RenderPass pass) const {
+	if (options_.merge && !VAO_) return; // Still streaming
+
+	for (uint32_t node = 0; node < scene_.size(); node++) {
+		const glm::mat4 world = model * scene_.world(node);
+		const uint32_t end = scene_.firstMesh(node) + scene_.numMeshes(node);
+		for (uint32_t i = scene_.firstMesh(node); i < end; i++) {
+			const Mesh& mesh = meshes_[i];
+			if (!visible_[i]) continue;
+			if (options_.merge) {
+				queue->submit(mesh, VAO_.id(), shader, world, pass);
+			} else if (mesh.isReady()) {
+				queue->submit(mesh, mesh.vertexArray(), shader, world, pass);
+			}
+		}
+	}
 }
\ No newline at end of file
@@ -0,0 +1,715 @@
+#include "obj_loader.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+// Target size of the line aligned chunks parsed in parallel
+static const size_t k_ChunkSize = 256 * 1024;
+static const uint32_t k_None = 0xFFFFFFFF;
+
+struct ObjCorner {
+	uint32_t position, texCoord, normal;	// Absolute, k_None when missing
+};
+
+enum class ObjEventType : uint8_t {
+	Object,
+	Group,
+	Material
+};
+
+// Statement that changes which mesh the following faces go to
+struct ObjEvent {
+	uint32_t face;	// Number of faces of the chunk before it
+	ObjEventType type;
+	std::string name;
+};
+
+struct ObjChunk {
+	const char* begin;
+	const char* end;
+
+	uint32_t numPositions = 0, numTexCoords = 0, numNormals = 0;
+	uint32_t firstPosition = 0, firstTexCoord = 0, firstNormal = 0;
+
+	std::vector<ObjCorner> corners;
+	std::vector<uint32_t> faceSizes;
+	std::vector<ObjEvent> events;
+	std::vector<std::string> mtllibs;
+	bool valid = true;
+};
+
+// Run of faces of a chunk that go to the same mesh
+struct ObjSegment {
+	uint32_t chunk;
+	uint32_t faceBegin, faceEnd, cornerBegin;
+	uint32_t mesh;
+	uint32_t firstVertex, firstIndex;
+};
+
+struct ObjMaterial {
+	std::string diffuse, specular, bump, ambient;
+};
+
+static bool isSpace(const char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static bool isDigit(const char c) {
+	return c >= '0' && c <= '9';
+}
+
+static const char* skipSpaces(const char* c, const char* end) {
+	while (c < end && isSpace(*c)) c++;
+	return c;
+}
+
+static const char* nextLine(const char* c, const char* end) {
+	const char* newLine = static_cast<const char*>(memchr(c, '\n', end - c));
+	return newLine ? newLine + 1 : end;
+}
+
+// True if the line starts with the keyword followed by a space
+static bool isKeyword(const char* c, const char* end, const char* keyword) {
+	const size_t length = strlen(keyword);
+	return static_cast<size_t>(end - c) > length && !memcmp(c, keyword, length) && isSpace(c[length]);
+}
+
+// Rest of the line without the surrounding spaces
+static std::string readName(const char* c, const char* end) {
+	c = skipSpaces(c, end);
+	const char* last = c;
+	while (last < end && *last != '\n') last++;
+	while (last > c && isSpace(last[-1])) last--;
+	return std::string(c, last);
+}
+
+// Words of the rest of the line, mtllib lists several files
+static void readNames(const char* c, const char* end, std::vector<std::string>* names) {
+	c = skipSpaces(c, end);
+	while (c < end && *c != '\n') {
+		const char* word = c;
+		while (c < end && *c != '\n' && !isSpace(*c)) c++;
+		names->push_back(std::string(word, c));
+		c = skipSpaces(c, end);
+	}
+}
+
+static const char* parseUnsigned(const char* c, const char* end, uint64_t* value, uint32_t maxDigits,
+	uint32_t* numDigits) {
+	uint64_t result = 0;
+	uint32_t digits = 0;
+	while (c < end && isDigit(*c)) {
+		if (digits < maxDigits) {
+			result = result * 10 + (*c - '0');
+			digits++;
+		}
+		c++;
+	}
+	*value = result;
+	if (numDigits) *numDigits = digits;
+	return c;
+}
+
+// Same arithmetic as ASSIMP's fast_atof, so both paths produce the same bits
+static const char* parseFloat(const char* c, const char* end, float* out) {
+	static const double k_Fractions[] = { 0.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001,
+		0.00000001, 0.000000001, 0.0000000001, 0.00000000001, 0.000000000001, 0.0000000000001,
+		0.00000000000001, 0.000000000000001 };
+
+	c = skipSpaces(c, end);
+	const bool negative = c < end && *c == '-';
+	if (c < end && (*c == '-' || *c == '+')) c++;
+
+	float value = 0.0f;
+	uint64_t integer;
+	if (c < end && *c != '.') {
+		c = parseUnsigned(c, end, &integer, 20, nullptr);
+		value = static_cast<float>(integer);
+	}
+	if (c + 1 < end && *c == '.' && isDigit(c[1])) {
+		uint32_t digits;
+		c = parseUnsigned(c + 1, end, &integer, 15, &digits);
+		value += static_cast<float>(static_cast<double>(integer) * k_Fractions[digits]);
+	} else if (c < end && *c == '.') {
+		c++;
+	}
+	if (c < end && (*c == 'e' || *c == 'E')) {
+		c++;
+		const bool negativeExponent = c < end && *c == '-';
+		if (c < end && (*c == '-' || *c == '+')) c++;
+		c = parseUnsigned(c, end, &integer, 20, nullptr);
+		const float exponent = static_cast<float>(integer);
+		value *= std::pow(10.0f, negativeExponent ? -exponent : exponent);
+	}
+
+	*out = negative ? -value : value;
+	return c;
+}
+
+// OBJ indices are 1 based or negative from the last element, count is the number read so far
+static const char* parseIndex(const char* c, const char* end, const uint32_t count, uint32_t* index) {
+	const bool negative = c < end && *c == '-';
+	if (negative) c++;
+	uint64_t value;
+	uint32_t digits;
+	c = parseUnsigned(c, end, &value, 10, &digits);
+	if (!digits) {
+		*index = k_None;
+		return c;
+	}
+	const int64_t absolute = negative ? static_cast<int64_t>(count) - static_cast<int64_t>(value) :
+		static_cast<int64_t>(value) - 1;
+	*index = absolute >= 0 ? static_cast<uint32_t>(absolute) : k_None;
+	return c;
+}
+
+// Counts the vertex data lines so the second pass knows where to write
+static void countChunk(ObjChunk* chunk) {
+	for (const char* line = chunk->begin; line < chunk->end; line = nextLine(line, chunk->end)) {
+		const char* c = skipSpaces(line, chunk->end);
+		if (c == chunk->end || *c != 'v') continue;
+		if (isKeyword(c, chunk->end, "v")) chunk->numPositions++;
+		else if (isKeyword(c, chunk->end, "vt")) chunk->numTexCoords++;
+		else if (isKeyword(c, chunk->end, "vn")) chunk->numNormals++;
+	}
+}
+
+static void parseChunk(ObjChunk* chunk, std::vector<glm::vec3>* positions, std::vector<glm::vec2>* texCoords,
+	std::vector<glm::vec3>* normals) {
+	uint32_t numPositions = chunk->firstPosition;
+	uint32_t numTexCoords = chunk->firstTexCoord;
+	uint32_t numNormals = chunk->firstNormal;
+	const char* end = chunk->end;
+
+	for (const char* line = chunk->begin; line < end; line = nextLine(line, end)) {
+		const char* c = skipSpaces(line, end);
+		if (isKeyword(c, end, "v")) {
+			glm::vec3& position = (*positions)[numPositions++];
+			c = parseFloat(c + 1, end, &position.x);
+			c = parseFloat(c, end, &position.y);
+			parseFloat(c, end, &position.z);
+		} else if (isKeyword(c, end, "vt")) {
+			glm::vec2& texCoord = (*texCoords)[numTexCoords++];
+			c = parseFloat(c + 2, end, &texCoord.x);
+			parseFloat(c, end, &texCoord.y);
+		} else if (isKeyword(c, end, "vn")) {
+			glm::vec3& normal = (*normals)[numNormals++];
+			c = parseFloat(c + 2, end, &normal.x);
+			c = parseFloat(c, end, &normal.y);
+			parseFloat(c, end, &normal.z);
+		} else if (isKeyword(c, end, "f")) {
+			// Corners are v, v/vt, v//vn or v/vt/vn
+			uint32_t size = 0;
+			c = skipSpaces(c + 1, end);
+			while (c < end && *c != '\n') {
+				ObjCorner corner{ k_None, k_None, k_None };
+				c = parseIndex(c, end, numPositions, &corner.position);
+				if (c < end && *c == '/') {
+					c = parseIndex(c + 1, end, numTexCoords, &corner.texCoord);
+					if (c < end && *c == '/') c = parseIndex(c + 1, end, numNormals, &corner.normal);
+				}
+				if (corner.position >= numPositions ||
+					(corner.texCoord != k_None && corner.texCoord >= numTexCoords) ||
+					(corner.normal != k_None && corner.normal >= numNormals)) {
+					chunk->valid = false;
+					return;
+				}
+				chunk->corners.push_back(corner);
+				size++;
+				c = skipSpaces(c, end);
+			}
+			chunk->faceSizes.push_back(size);
+		} else if (isKeyword(c, end, "usemtl")) {
+			chunk->events.push_back(ObjEvent{ static_cast<uint32_t>(chunk->faceSizes.size()),
+				ObjEventType::Material, readName(c + 6, end) });
+		} else if (isKeyword(c, end, "o")) {
+			chunk->events.push_back(ObjEvent{ static_cast<uint32_t>(chunk->faceSizes.size()),
+				ObjEventType::Object, readName(c + 1, end) });
+		} else if (isKeyword(c, end, "g")) {
+			chunk->events.push_back(ObjEvent{ static_cast<uint32_t>(chunk->faceSizes.size()),
+				ObjEventType::Group, readName(c + 1, end) });
+		} else if (isKeyword(c, end, "mtllib")) {
+			readNames(c + 6, end, &chunk->mtllibs);
+		}
+	}
+}
+
+// Texture statement, skipping the -option arguments in front of the file name
+static std::string readTexture(const char* c, const char* end) {
+	static const struct { const char* name; int numArgs; } k_Options[] = {
+		{ "-blendu", 1 }, { "-blendv", 1 }, { "-boost", 1 }, { "-cc", 1 }, { "-clamp", 1 },
+		{ "-imfchan", 1 }, { "-texres", 1 }, { "-type", 1 }, { "-bm", 1 }, { "-mm", 2 },
+		{ "-o", 3 }, { "-s", 3 }, { "-t", 3 }
+	};
+
+	c = skipSpaces(c, end);
+	while (c < end && *c == '-') {
+		const char* word = c;
+		while (c < end && !isSpace(*c) && *c != '\n') c++;
+		int numArgs = 0;
+		for (const auto& option : k_Options) {
+			if (strlen(option.name) == static_cast<size_t>(c - word) && !memcmp(word, option.name, c - word)) {
+				numArgs = option.numArgs;
+			}
+		}
+		for (int i = 0; i < numArgs; i++) {
+			c = skipSpaces(c, end);
+			// Trailing -o, -s and -t arguments are optional numbers
+			if (numArgs == 3 && i > 0 && c < end && !isDigit(*c) && *c != '-' && *c != '.') break;
+			while (c < end && !isSpace(*c) && *c != '\n') c++;
+		}
+		c = skipSpaces(c, end);
+	}
+	return readName(c, end);
+}
+
+static void loadMaterials(const std::string& path, std::unordered_map<std::string, ObjMaterial>* materials) {
+	MappedFile file;
+	if (!file.open(path)) {
+		std::cout << "Error Opening Material Library " << path << std::endl;
+		return;
+	}
+
+	const char* end = reinterpret_cast<const char*>(file.data()) + file.size();
+	ObjMaterial* material = nullptr;
+	for (const char* line = reinterpret_cast<const char*>(file.data()); line < end; line = nextLine(line, end)) {
+		const char* c = skipSpaces(line, end);
+		if (isKeyword(c, end, "newmtl")) {
+			material = &(*materials)[readName(c + 6, end)];
+			*material = ObjMaterial();
+		} else if (!material) {
+			continue;
+		} else if (isKeyword(c, end, "map_Kd")) {
+			material->diffuse = readTexture(c + 6, end);
+		} else if (isKeyword(c, end, "map_Ks")) {
+			material->specular = readTexture(c + 6, end);
+		} else if (isKeyword(c, end, "map_Ka")) {
+			material->ambient = readTexture(c + 6, end);
+		} else if (isKeyword(c, end, "map_Bump") || isKeyword(c, end, "map_bump")) {
+			material->bump = readTexture(c + 8, end);
+		} else if (isKeyword(c, end, "bump")) {
+			material->bump = readTexture(c + 4, end);
+		}
+	}
+}
+
+// Twice the signed area of the 2D triangle a, b, c, positive when clockwise as in ASSIMP's GetArea2D
+static double area2D(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c) {
+	return static_cast<double>(a.x) * (static_cast<double>(c.y) - b.y) +
+		static_cast<double>(b.x) * (static_cast<double>(a.y) - c.y) +
+		static_cast<double>(c.x) * (static_cast<double>(b.y) - a.y);
+}
+
+// Strictly inside, barycentric like ASSIMP's PointInTriangle2D
+static bool inTriangle2D(const glm::vec2& p0, const glm::vec2& p1, const glm::vec2& p2, const glm::vec2& p) {
+	const glm::dvec2 v0(p1 - p0), v1(p2 - p0), v2(p - p0);
+	const double dot00 = glm::dot(v0, v0), dot01 = glm::dot(v0, v1), dot02 = glm::dot(v0, v2);
+	const double dot11 = glm::dot(v1, v1), dot12 = glm::dot(v1, v2);
+	const double invDenom = 1.0 / (dot00 * dot11 - dot01 * dot01);
+	const double u = (dot11 * dot02 - dot01 * dot12) * invDenom;
+	const double v = (dot00 * dot12 - dot01 * dot02) * invDenom;
+	return u > 0.0 && v > 0.0 && u + v < 1.0;
+}
+
+// Ear clipping of larger polygons, following aiProcess_Triangulate: the polygon is
+// projected along the largest axis of its normal, ears are searched from the last one
+// cut, and a polygon without ears falls back to a fan
+static uint32_t clipEars(const glm::vec3* positions, const uint32_t size, uint32_t* triangles) {
+	glm::vec3 normal(0.0f);
+	for (uint32_t i = 0; i < size; i++) normal += glm::cross(positions[i], positions[(i + 1) % size]);
+	const glm::vec3 axis = glm::abs(normal);
+	uint32_t ac = 0, bc = 1;
+	float inv = normal.z;
+	if (axis.x > axis.y) {
+		if (axis.x > axis.z) {
+			ac = 1; bc = 2; inv = normal.x;
+		}
+	} else if (axis.y > axis.z) {
+		ac = 2; bc = 0; inv = normal.y;
+	}
+	// Keeps the projection counter clockwise when the normal points down the axis
+	if (inv < 0.0f) std::swap(ac, bc);
+
+	std::vector<glm::vec2> points(size);
+	std::vector<bool> done(size, false);
+	for (uint32_t i = 0; i < size; i++) points[i] = glm::vec2(positions[i][ac], positions[i][bc]);
+
+	uint32_t numIndices = 0;
+	uint32_t remaining = size, ear = 0, previous = size - 1, next = 0;
+	while (remaining > 3) {
+		// Two laps without an ear mean the polygon is not simple
+		uint32_t laps = 0;
+		for (ear = next;; previous = ear, ear = next) {
+			for (next = ear + 1; done[next >= size ? (next = 0) : next]; next++);
+			if (next < ear && ++laps == 2) break;
+
+			const glm::vec2& p0 = points[previous];
+			const glm::vec2& p1 = points[ear];
+			const glm::vec2& p2 = points[next];
+			if (area2D(p0, p1, p2) > 0.0) continue;	// Reflex corner
+
+			// Corners repeating one of the triangle's positions do not block it
+			uint32_t i = 0;
+			for (; i < size; i++) {
+				const glm::vec2& p = points[i];
+				if (p != p0 && p != p1 && p != p2 && inTriangle2D(p0, p1, p2, p)) break;
+			}
+			if (i == size) break;
+		}
+
+		if (laps == 2) {
+			numIndices = 0;
+			for (uint32_t i = 1; i + 1 < size; i++) {
+				triangles[numIndices++] = 0;
+				triangles[numIndices++] = i;
+				triangles[numIndices++] = i + 1;
+			}
+			return numIndices;
+		}
+
+		triangles[numIndices++] = previous;
+		triangles[numIndices++] = ear;
+		triangles[numIndices++] = next;
+		done[ear] = true;
+		remaining--;
+	}
+
+	for (uint32_t i = 0; i < size; i++) {
+		if (!done[i]) triangles[numIndices++] = i;
+	}
+	return numIndices;
+}
+
+// Splits a face into triangles the way aiProcess_Triangulate does
+static uint32_t triangulate(const glm::vec3* positions, const uint32_t size, uint32_t* triangles) {
+	if (size > 4) return clipEars(positions, size, triangles);
+
+	uint32_t start = 0;
+	if (size == 4) {
+		// A concave quad is split from its reflex corner
+		for (uint32_t i = 0; i < 4; i++) {
+			const glm::vec3& v = positions[i];
+			const glm::vec3 left = glm::normalize(positions[(i + 3) % 4] - v);
+			const glm::vec3 diagonal = glm::normalize(positions[(i + 2) % 4] - v);
+			const glm::vec3 right = glm::normalize(positions[(i + 1) % 4] - v);
+			if (std::acos(glm::dot(left, diagonal)) + std::acos(glm::dot(right, diagonal)) > 3.14159265358979f) {
+				start = i;
+				break;
+			}
+		}
+	}
+
+	uint32_t numIndices = 0;
+	for (uint32_t i = 1; i + 1 < size; i++) {
+		triangles[numIndices++] = start;
+		triangles[numIndices++] = (start + i) % size;
+		triangles[numIndices++] = (start + i + 1) % size;
+	}
+	return numIndices;
+}
+
+static bool isSpecial(const glm::vec3& v) {
+	return !std::isfinite(v.x) || !std::isfinite(v.y) || !std::isfinite(v.z);
+}
+
+static glm::vec3 normalizeSafe(const glm::vec3& v) {
+	const float length = glm::length(v);
+	return length > 0.0f ? v * (1.0f / length) : v;
+}
+
+// aiProcess_CalcTangentSpace: per face tangents projected on the vertex normal, then
+// averaged between vertices at the same place with the same normal and a similar tangent
+static void calcTangents(ObjLoader::ObjMesh* mesh) {
+	std::vector<Vertex>& vertices = mesh->vertices;
+	const std::vector<uint32_t>& indices = mesh->indices;
+	const uint32_t numVertices = static_cast<uint32_t>(vertices.size());
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		const Vertex& p0 = vertices[indices[i]];
+		const Vertex& p1 = vertices[indices[i + 1]];
+		const Vertex& p2 = vertices[indices[i + 2]];
+		const glm::vec3 v = p1.Position - p0.Position, w = p2.Position - p0.Position;
+		float sx = p1.TexCoords.x - p0.TexCoords.x, sy = p1.TexCoords.y - p0.TexCoords.y;
+		float tx = p2.TexCoords.x - p0.TexCoords.x, ty = p2.TexCoords.y - p0.TexCoords.y;
+		const float dirCorrection = (tx * sy - ty * sx) < 0.0f ? -1.0f : 1.0f;
+		// Degenerate UVs take the default direction
+		if (sx * ty == sy * tx) {
+			sx = 0.0f; sy = 1.0f;
+			tx = 1.0f; ty = 0.0f;
+		}
+		const glm::vec3 tangent = (w * sy - v * ty) * dirCorrection;
+		const glm::vec3 bitangent = (w * sx - v * tx) * dirCorrection;
+
+		for (size_t j = i; j < i + 3; j++) {
+			Vertex& vertex = vertices[indices[j]];
+			glm::vec3 localTangent = normalizeSafe(tangent - vertex.Normal * glm::dot(tangent, vertex.Normal));
+			glm::vec3 localBitangent = normalizeSafe(bitangent - vertex.Normal * glm::dot(bitangent, vertex.Normal));
+			// Rebuild an invalid one from the other
+			const bool invalidTangent = isSpecial(localTangent), invalidBitangent = isSpecial(localBitangent);
+			if (invalidTangent != invalidBitangent) {
+				if (invalidTangent) localTangent = normalizeSafe(glm::cross(vertex.Normal, localBitangent));
+				else localBitangent = normalizeSafe(glm::cross(localTangent, vertex.Normal));
+			}
+			vertex.Tangent = localTangent;
+			vertex.Bitangent = localBitangent;
+		}
+	}
+
+	if (!numVertices) return;
+
+	// Same sort plane and position epsilon as ASSIMP's SpatialSort
+	const glm::vec3 plane(0.8523f, 0.0002f, 0.5230f);
+	glm::vec3 min = vertices[0].Position, max = vertices[0].Position;
+	for (const Vertex& vertex : vertices) {
+		min = glm::min(min, vertex.Position);
+		max = glm::max(max, vertex.Position);
+	}
+	const float epsilon = glm::length(max - min) * 1e-4f;
+
+	std::vector<std::pair<float, uint32_t>> sorted(numVertices);
+	for (uint32_t i = 0; i < numVertices; i++) {
+		sorted[i] = std::make_pair(glm::dot(vertices[i].Position, plane), i);
+	}
+	std::sort(sorted.begin(), sorted.end());
+
+	const float limit = std::cos(glm::radians(45.0f));
+	std::vector<bool> done(numVertices, false);
+	std::vector<uint32_t> group;
+	for (uint32_t a = 0; a < numVertices; a++) {
+		if (done[a]) continue;
+		const Vertex& origin = vertices[a];
+
+		// The vertex is found again among its neighbours, so it counts twice as in ASSIMP
+		group.clear();
+		group.push_back(a);
+		const float distance = glm::dot(origin.Position, plane);
+		auto it = std::lower_bound(sorted.begin(), sorted.end(), std::make_pair(distance - epsilon, 0u));
+		for (; it != sorted.end() && it->first <= distance + epsilon; ++it) {
+			const uint32_t b = it->second;
+			const Vertex& other = vertices[b];
+			if (done[b]) continue;
+			const glm::vec3 offset = other.Position - origin.Position;
+			if (glm::dot(offset, offset) >= epsilon * epsilon) continue;
+			if (glm::dot(other.Normal, origin.Normal) < 0.9999f) continue;
+			if (glm::dot(other.Tangent, origin.Tangent) < limit) continue;
+			if (glm::dot(other.Bitangent, origin.Bitangent) < limit) continue;
+			group.push_back(b);
+			done[b] = true;
+		}
+
+		glm::vec3 tangent(0.0f), bitangent(0.0f);
+		for (uint32_t index : group) {
+			tangent += vertices[index].Tangent;
+			bitangent += vertices[index].Bitangent;
+		}
+		tangent = tangent * (1.0f / glm::length(tangent));
+		bitangent = bitangent * (1.0f / glm::length(bitangent));
+		for (uint32_t index : group) {
+			vertices[index].Tangent = tangent;
+			vertices[index].Bitangent = bitangent;
+		}
+	}
+}
+
+std::vector<std::string> ObjLoader::materialLibraries(const char* data, const size_t size) {
+	std::vector<std::string> names;
+	const char* end = data + size;
+	for (const char* line = data; line < end; line = nextLine(line, end)) {
+		const char* c = skipSpaces(line, end);
+		if (isKeyword(c, end, "mtllib")) readNames(c + 6, end, &names);
+	}
+	return names;
+}
+
+bool ObjLoader::load(const std::string& path) {
+	meshes_.clear();
+
+	MappedFile file;
+	if (!file.open(path)) {
+		std::cout << "Error Opening Obj " << path << std::endl;
+		return false;
+	}
+	const char* data = reinterpret_cast<const char*>(file.data());
+	const char* end = data + file.size();
+
+	// Line aligned chunks
+	std::vector<ObjChunk> chunks;
+	for (const char* begin = data; begin < end;) {
+		const char* chunkEnd = static_cast<size_t>(end - begin) > k_ChunkSize ?
+			nextLine(begin + k_ChunkSize, end) : end;
+		ObjChunk chunk;
+		chunk.begin = begin;
+		chunk.end = chunkEnd;
+		chunks.push_back(std::move(chunk));
+		begin = chunkEnd;
+	}
+	const uint32_t numChunks = static_cast<uint32_t>(chunks.size());
+
+	// Count first so every chunk writes its vertex data straight into place
+	ThreadPool& pool = ThreadPool::instance();
+	pool.parallelFor(numChunks, [&](uint32_t i) {
+		countChunk(&chunks[i]);
+	});
+	uint32_t numPositions = 0, numTexCoords = 0, numNormals = 0;
+	for (ObjChunk& chunk : chunks) {
+		chunk.firstPosition = numPositions;
+		chunk.firstTexCoord = numTexCoords;
+		chunk.firstNormal = numNormals;
+		numPositions += chunk.numPositions;
+		numTexCoords += chunk.numTexCoords;
+		numNormals += chunk.numNormals;
+	}
+
+	std::vector<glm::vec3> positions(numPositions), normals(numNormals);
+	std::vector<glm::vec2> texCoords(numTexCoords);
+	pool.parallelFor(numChunks, [&](uint32_t i) {
+		parseChunk(&chunks[i], &positions, &texCoords, &normals);
+	});
+	for (const ObjChunk& chunk : chunks) {
+		if (!chunk.valid) {
+			std::cout << "Error Obj Face Index Out Of Range In " << path << std::endl;
+			return false;
+		}
+	}
+
+	// Every library in file order, later ones redefine the materials they share
+	const std::string directory = path.substr(0, path.find_last_of('/') + 1);
+	std::unordered_map<std::string, ObjMaterial> materials;
+	std::vector<std::string> libraries;
+	for (const ObjChunk& chunk : chunks) {
+		for (const std::string& library : chunk.mtllibs) {
+			if (std::find(libraries.begin(), libraries.end(), library) != libraries.end()) continue;
+			libraries.push_back(library);
+			loadMaterials(directory + library, &materials);
+		}
+	}
+
+	// Assign the faces to meshes in file order, splitting like ASSIMP: a new mesh per
+	// object or group, and per material once the current mesh has faces.
+	// An empty name is the default material
+	std::vector<std::string> meshMaterials;
+	std::vector<uint32_t> meshVertices, meshIndices;
+	std::vector<ObjSegment> segments;
+	std::string material, group;
+	int32_t mesh = -1;
+	auto newMesh = [&]() {
+		mesh = static_cast<int32_t>(meshMaterials.size());
+		meshMaterials.push_back(material);
+		meshVertices.push_back(0);
+		meshIndices.push_back(0);
+	};
+
+	for (uint32_t i = 0; i < numChunks; i++) {
+		const ObjChunk& chunk = chunks[i];
+		uint32_t face = 0, corner = 0;
+		size_t event = 0;
+		const uint32_t numFaces = static_cast<uint32_t>(chunk.faceSizes.size());
+		while (face < numFaces || event < chunk.events.size()) {
+			for (; event < chunk.events.size() && chunk.events[event].face == face; event++) {
+				const ObjEvent& statement = chunk.events[event];
+				if (statement.type == ObjEventType::Material) {
+					material = statement.name;
+					if (mesh >= 0 && (meshVertices[mesh] == 0 || meshMaterials[mesh] == material)) {
+						meshMaterials[mesh] = material;
+					} else {
+						newMesh();
+					}
+				} else if (statement.type == ObjEventType::Object || statement.name != group) {
+					if (statement.type == ObjEventType::Group) group = statement.name;
+					newMesh();
+				}
+			}
+
+			const uint32_t last = event < chunk.events.size() ? chunk.events[event].face : numFaces;
+			if (face == last) continue;
+			if (mesh < 0) newMesh();
+
+			ObjSegment segment{ i, face, last, corner, static_cast<uint32_t>(mesh),
+				meshVertices[mesh], meshIndices[mesh] };
+			for (; face < last; face++) {
+				const uint32_t size = chunk.faceSizes[face];
+				corner += size;
+				// Lines and points are not part of a triangle mesh
+				if (size < 3) continue;
+				meshVertices[mesh] += size;
+				meshIndices[mesh] += (size - 2) * 3;
+			}
+			segments.push_back(segment);
+		}
+	}
+
+	meshes_.resize(meshMaterials.size());
+	for (size_t i = 0; i < meshes_.size(); i++) {
+		meshes_[i].vertices.resize(meshVertices[i]);
+		meshes_[i].indices.resize(meshIndices[i]);
+	}
+
+	// Every corner becomes its own vertex like in ASSIMP, welding is left to MeshOptimizer
+	pool.parallelFor(static_cast<uint32_t>(segments.size()), [&](uint32_t s) {
+		const ObjSegment& segment = segments[s];
+		const ObjChunk& chunk = chunks[segment.chunk];
+		ObjMesh& out = meshes_[segment.mesh];
+		uint32_t vertex = segment.firstVertex, index = segment.firstIndex;
+		const ObjCorner* corner = chunk.corners.data() + segment.cornerBegin;
+		std::vector<glm::vec3> polygon;
+		std::vector<uint32_t> triangles;
+
+		for (uint32_t face = segment.faceBegin; face < segment.faceEnd; face++) {
+			const uint32_t size = chunk.faceSizes[face];
+			if (size < 3) {
+				corner += size;
+				continue;
+			}
+			polygon.resize(size);
+			triangles.resize((size - 2) * 3);
+			for (uint32_t j = 0; j < size; j++, corner++) {
+				Vertex& v = out.vertices[vertex + j];
+				v.Position = positions[corner->position];
+				v.Normal = corner->normal != k_None ? normals[corner->normal] : glm::vec3(0.0f);
+				v.TexCoords = corner->texCoord != k_None ? texCoords[corner->texCoord] : glm::vec2(0.0f);
+				polygon[j] = v.Position;
+			}
+			const uint32_t numIndices = triangulate(polygon.data(), size, triangles.data());
+			for (uint32_t j = 0; j < numIndices; j++) {
+				out.indices[index++] = vertex + triangles[j];
+			}
+			vertex += size;
+		}
+	});
+
+	// Tangents use the UVs before they are flipped, as in ASSIMP
+	pool.parallelFor(static_cast<uint32_t>(meshes_.size()), [&](uint32_t i) {
+		calcTangents(&meshes_[i]);
+		for (Vertex& vertex : meshes_[i].vertices) {
+			vertex.TexCoords.y = 1.0f - vertex.TexCoords.y;
+		}
+	});
+
+	// Same texture order as Model::processMesh, empty meshes are dropped
+	std::vector<ObjMesh> meshes;
+	for (size_t i = 0; i < meshes_.size(); i++) {
+		if (meshes_[i].indices.empty()) continue;
+		auto found = materials.find(meshMaterials[i]);
+		if (found != materials.end()) {
+			const ObjMaterial* used = &found->second;
+			const std::pair<const std::string*, const char*> maps[] = {
+				{ &used->diffuse, "texture_diffuse" }, { &used->specular, "texture_specular" },
+				{ &used->bump, "texture_normal" }, { &used->ambient, "texture_height" }
+			};
+			for (const auto& map : maps) {
+				if (map.first->empty()) continue;
+				Texture texture;
+				texture.type = map.second;
+				texture.path = *map.first;
+				meshes_[i].textures.push_back(texture);
+			}
+		}
+		meshes.push_back(std::move(meshes_[i]));
+	}
+	meshes_ = std::move(meshes);
+	return true;
+}
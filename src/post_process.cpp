@@ -0,0 +1,254 @@
+#include "post_process.h"
+#include "gl_state.h"
+#include "render_graph.h"
+#include <glad/glad.h>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+constexpr UniformName k_SourceUniform("source");
+constexpr UniformName k_SourceScaleUniform("sourceScale");
+constexpr UniformName k_TexelSizeUniform("texelSize");
+constexpr UniformName k_OutputSizeUniform("outputSize");
+
+const char* k_VertexCode =
+	"#version 330 core\n"
+	"void main() {\n"
+	"	// Full screen triangle made from the vertex index, no buffers needed\n"
+	"	vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+	"	gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);\n"
+	"}\n";
+
+// Everything a pass shares, the source may only fill part of its texture
+const char* k_FragmentHeader =
+	"#version 330 core\n"
+	"out vec4 fragColor;\n"
+	"uniform sampler2D source;\n"
+	"uniform vec2 sourceScale;\n"
+	"uniform vec2 texelSize;\n"
+	"uniform vec2 outputSize;\n"
+	"vec4 sampleSource(vec2 uv) {\n"
+	"	return texture(source, clamp(uv, 0.5 * texelSize, sourceScale - 0.5 * texelSize));\n"
+	"}\n";
+
+const char* k_CopySampling = "	color = sampleSource(uv);\n";
+
+std::string glslFloat(const float value) {
+	std::ostringstream stream;
+	stream.precision(9);
+	stream << std::showpoint << value;
+	return stream.str();
+}
+
+std::string glslFloats(const float* values, const size_t count) {
+	std::string list;
+	for (size_t i = 0; i < count; i++) list += (i ? ", " : "") + glslFloat(values[i]);
+	return list;
+}
+
+std::string kernelSampling(const std::vector<float>& weights) {
+	return
+		"	const float weights[9] = float[](" + glslFloats(weights.data(), 9) + ");\n"
+		"	for (int i = 0; i < 9; ++i)\n"
+		"		color += sampleSource(uv + vec2(i % 3 - 1, 1 - i / 3) * texelSize) * weights[i];\n";
+}
+
+// Taps on both sides share a weight, the loop reads them in pairs
+std::string separableSampling(const std::vector<float>& weights, const char* direction) {
+	const std::string count = std::to_string(weights.size());
+	return
+		"	const float weights[" + count + "] = float[](" + glslFloats(weights.data(), weights.size()) + ");\n"
+		"	color = sampleSource(uv) * weights[0];\n"
+		"	for (int i = 1; i < " + count + "; ++i) {\n"
+		"		vec2 offset = " + direction + " * texelSize * float(i);\n"
+		"		color += (sampleSource(uv + offset) + sampleSource(uv - offset)) * weights[i];\n"
+		"	}\n";
+}
+
+uint32_t createTexture(const uint32_t width, const uint32_t height) {
+	uint32_t texture;
+	glGenTextures(1, &texture);
+	GLState::bindTexture(0, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	// Linear, passes at other scales read each other filtered
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	return texture;
+}
+
+}
+
+PostProcessChain::PostProcessChain(const uint32_t width, const uint32_t height) :
+	width_(width), height_(height) {
+	uint32_t VAO;
+	glGenVertexArrays(1, &VAO);
+	emptyVAO_.reset(VAO);
+}
+
+void PostProcessChain::resize(const uint32_t width, const uint32_t height) {
+	if (width == width_ && height == height_) return;
+	width_ = width;
+	height_ = height;
+	if (textures_[0]) createTargets();
+}
+
+void PostProcessChain::createTargets() {
+	for (uint32_t i = 0; i < 2; i++) {
+		textures_[i].reset(createTexture(width_, height_));
+		uint32_t framebuffer;
+		glGenFramebuffers(1, &framebuffer);
+		framebuffers_[i].reset(framebuffer);
+		GLState::bindFramebuffer(framebuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures_[i].id(), 0);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "Error Post Process FrameBuffer Not Complete" << std::endl;
+		}
+	}
+}
+
+uint32_t PostProcessChain::addPixel(const std::string& code, const std::string& uniforms) {
+	effects_.push_back(Effect{ Kind::Pixel, code, uniforms, {}, 1.0f });
+	dirty_ = true;
+	return static_cast<uint32_t>(effects_.size() - 1);
+}
+
+uint32_t PostProcessChain::addKernel(const float weights[9], const float scale) {
+	effects_.push_back(Effect{ Kind::Kernel, std::string(), std::string(), std::vector<float>(weights, weights + 9), scale });
+	dirty_ = true;
+	return static_cast<uint32_t>(effects_.size() - 1);
+}
+
+uint32_t PostProcessChain::addSeparable(const std::vector<float>& weights, const float scale) {
+	effects_.push_back(Effect{ Kind::Separable, std::string(), std::string(), weights, scale });
+	dirty_ = true;
+	return static_cast<uint32_t>(effects_.size() - 1);
+}
+
+uint32_t PostProcessChain::addGaussian(const uint32_t radius, const float sigma, const float scale) {
+	return addSeparable(gaussianWeights(radius, sigma), scale);
+}
+
+void PostProcessChain::clear() {
+	effects_.clear();
+	dirty_ = true;
+}
+
+std::vector<float> PostProcessChain::gaussianWeights(const uint32_t radius, const float sigma) {
+	std::vector<float> weights(radius + 1);
+	float sum = 0.0f;
+	for (uint32_t i = 0; i <= radius; i++) {
+		weights[i] = std::exp(-0.5f * i * i / (sigma * sigma));
+		sum += i ? 2.0f * weights[i] : weights[i];
+	}
+	for (float& weight : weights) weight /= sum;
+	return weights;
+}
+
+void PostProcessChain::addPass(const std::string& sampling, const float scale) {
+	passes_.push_back(Pass{ sampling, std::string(), std::string(), scale, nullptr });
+}
+
+void PostProcessChain::build() {
+	passes_.clear();
+	effectPasses_.clear();
+	for (const Effect& effect : effects_) {
+		switch (effect.kind) {
+		case Kind::Pixel:
+			// Runs on the output of the pass before, no need for one of its own
+			if (passes_.empty()) addPass(k_CopySampling, 1.0f);
+			passes_.back().code += "	{\n" + effect.code + "\n	}\n";
+			passes_.back().uniforms += effect.uniforms + "\n";
+			break;
+		case Kind::Kernel:
+			addPass(kernelSampling(effect.weights), effect.scale);
+			break;
+		case Kind::Separable:
+			addPass(separableSampling(effect.weights, "vec2(1.0, 0.0)"), effect.scale);
+			addPass(separableSampling(effect.weights, "vec2(0.0, 1.0)"), effect.scale);
+			break;
+		}
+		effectPasses_.push_back(static_cast<uint32_t>(passes_.size() - 1));
+	}
+	// The target gets the chain's size, scaled down results are stretched back
+	if (passes_.empty() || passes_.back().scale != 1.0f) addPass(k_CopySampling, 1.0f);
+
+	for (Pass& pass : passes_) {
+		const std::string fragment = k_FragmentHeader + pass.uniforms +
+			"void main() {\n"
+			"	vec2 uv = gl_FragCoord.xy / outputSize * sourceScale;\n"
+			"	vec4 color = vec4(0.0);\n" +
+			pass.sampling + pass.code +
+			"	fragColor = color;\n"
+			"}\n";
+		pass.shader.reset(new Shader(FromSource(), k_VertexCode, fragment.c_str()));
+	}
+	dirty_ = false;
+}
+
+void PostProcessChain::apply(const uint32_t source, const uint32_t target) {
+	if (dirty_) build();
+	// Chains only run from a graph never need them
+	if (!textures_[0]) createTargets();
+
+	const glm::vec2 texelSize(1.0f / width_, 1.0f / height_);
+	uint32_t input = source;
+	glm::vec2 inputScale(1.0f);
+	for (size_t i = 0; i < passes_.size(); i++) {
+		const Pass& pass = passes_[i];
+		const bool last = i + 1 == passes_.size();
+		// The targets alternate, pass i never reads what it writes
+		const uint32_t output = static_cast<uint32_t>(i & 1);
+		const glm::vec2 size = glm::max(glm::floor(glm::vec2(width_, height_) * pass.scale), glm::vec2(1.0f));
+		GLState::bindFramebuffer(last ? target : framebuffers_[output].id());
+		GLState::viewport(0, 0, static_cast<int32_t>(size.x), static_cast<int32_t>(size.y));
+		drawPass(pass, input, inputScale, texelSize, size);
+
+		input = textures_[output].id();
+		inputScale = size * texelSize;
+	}
+	GLState::viewport(0, 0, width_, height_);
+}
+
+void PostProcessChain::addToGraph(RenderGraph* graph, const uint32_t source) {
+	if (dirty_) build();
+
+	uint32_t input = source;
+	float inputScale = 1.0f;
+	for (uint32_t i = 0; i < passes_.size(); i++) {
+		const bool last = i + 1 == passes_.size();
+		const float scale = passes_[i].scale;
+		// Each target is covered whole, its texels are the steps apply takes in the shared ones
+		const uint32_t pass = graph->addPass("post" + std::to_string(i), [this, i, input, inputScale, scale](const RenderGraph& frame) {
+			const glm::vec2 frameSize(frame.width(), frame.height());
+			const glm::vec2 inputSize = glm::max(glm::floor(frameSize * inputScale), glm::vec2(1.0f));
+			const glm::vec2 size = glm::max(glm::floor(frameSize * scale), glm::vec2(1.0f));
+			drawPass(passes_[i], frame.texture(input), glm::vec2(1.0f), 1.0f / inputSize, size);
+		});
+		graph->read(pass, input);
+		if (last) {
+			graph->writeOutput(pass);
+		} else {
+			input = graph->addTarget("post" + std::to_string(i), GL_RGBA8, scale);
+			graph->write(pass, input);
+			inputScale = scale;
+		}
+	}
+}
+
+void PostProcessChain::drawPass(const Pass& pass, const uint32_t input, const glm::vec2& inputScale,
+	const glm::vec2& texelSize, const glm::vec2& size) const {
+	GLState::disable(GL_DEPTH_TEST);
+	GLState::disable(GL_BLEND);
+	GLState::bindVertexArray(emptyVAO_.id());
+	pass.shader->use();
+	pass.shader->set(k_SourceUniform, 0);
+	pass.shader->set(k_SourceScaleUniform, inputScale);
+	pass.shader->set(k_TexelSizeUniform, texelSize);
+	pass.shader->set(k_OutputSizeUniform, size);
+	GLState::bindTexture(0, input);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+}
@@ -0,0 +1,228 @@
+#include "render_graph.h"
+#include "gl_state.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace {
+
+const uint32_t k_NoPass = 0xFFFFFFFF;
+
+bool isDepth(const uint32_t format) {
+	return format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 ||
+		format == GL_DEPTH_COMPONENT32F || format == GL_DEPTH24_STENCIL8;
+}
+
+uint32_t bytesPerPixel(const uint32_t format) {
+	switch (format) {
+	case GL_R8: return 1;
+	case GL_RG8: case GL_R16F: case GL_DEPTH_COMPONENT16: return 2;
+	case GL_RGB8: return 3;
+	case GL_RG16: case GL_RG16F: case GL_R32F: case GL_R11F_G11F_B10F: case GL_RGB10_A2: return 4;
+	case GL_DEPTH_COMPONENT24: case GL_DEPTH_COMPONENT32F: case GL_DEPTH24_STENCIL8: return 4;
+	case GL_RGBA16F: case GL_RG32F: return 8;
+	case GL_RGBA32F: return 16;
+	default: return 4;	// RGBA8 and the rest
+	}
+}
+
+uint32_t scaled(const uint32_t size, const float scale) {
+	return std::max(static_cast<uint32_t>(std::floor(size * scale)), 1u);
+}
+
+size_t textureBytes(const uint32_t format, const float scale, const uint32_t width, const uint32_t height) {
+	return static_cast<size_t>(scaled(width, scale)) * scaled(height, scale) * bytesPerPixel(format);
+}
+
+uint32_t createTexture(const uint32_t format, const uint32_t width, const uint32_t height) {
+	uint32_t texture;
+	glGenTextures(1, &texture);
+	GLState::bindTexture(0, texture);
+	// No data, the pixel format only has to match the kind of internal format
+	if (format == GL_DEPTH24_STENCIL8) {
+		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr);
+	} else if (isDepth(format)) {
+		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+	} else {
+		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
+	}
+	const GLenum filter = isDepth(format) ? GL_NEAREST : GL_LINEAR;
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	return texture;
+}
+
+}
+
+RenderGraph::RenderGraph(const uint32_t width, const uint32_t height) :
+	width_(width), height_(height) {
+}
+
+uint32_t RenderGraph::addTarget(const std::string& name, const uint32_t format, const float scale) {
+	targets_.push_back(Target{ name, format, scale, k_NoPass, 0, 0 });
+	compiled_ = false;
+	return static_cast<uint32_t>(targets_.size() - 1);
+}
+
+uint32_t RenderGraph::addPass(const std::string& name, Execute execute) {
+	passes_.push_back(Pass{ name, std::move(execute), {}, {}, false, false, GLFramebuffer() });
+	compiled_ = false;
+	return static_cast<uint32_t>(passes_.size() - 1);
+}
+
+void RenderGraph::read(const uint32_t pass, const uint32_t target) {
+	passes_[pass].reads.push_back(target);
+	compiled_ = false;
+}
+
+void RenderGraph::write(const uint32_t pass, const uint32_t target) {
+	passes_[pass].writes.push_back(target);
+	compiled_ = false;
+}
+
+void RenderGraph::writeOutput(const uint32_t pass) {
+	passes_[pass].output = true;
+	compiled_ = false;
+}
+
+void RenderGraph::compile() {
+	stats_ = RenderGraphStats();
+
+	// Back from the output, a pass is needed when a needed pass after it reads its writes
+	std::vector<bool> needed(targets_.size(), false);
+	for (size_t i = passes_.size(); i-- > 0;) {
+		Pass& pass = passes_[i];
+		pass.alive = pass.output;
+		for (const uint32_t target : pass.writes) pass.alive = pass.alive || needed[target];
+		if (!pass.alive) {
+			stats_.culled++;
+			continue;
+		}
+		for (const uint32_t target : pass.reads) needed[target] = true;
+		stats_.passes++;
+	}
+
+	for (Target& target : targets_) {
+		target.first = k_NoPass;
+		target.last = 0;
+	}
+	for (uint32_t i = 0; i < passes_.size(); i++) {
+		if (!passes_[i].alive) continue;
+		auto use = [&](const uint32_t index) {
+			Target& target = targets_[index];
+			target.first = std::min(target.first, i);
+			target.last = std::max(target.last, i);
+		};
+		for (const uint32_t target : passes_[i].reads) use(target);
+		for (const uint32_t target : passes_[i].writes) use(target);
+	}
+
+	// Greedy by first use, a texture is free once the last pass of its targets ran
+	std::vector<uint32_t> order;
+	for (uint32_t i = 0; i < targets_.size(); i++) {
+		if (targets_[i].first != k_NoPass) order.push_back(i);
+	}
+	std::stable_sort(order.begin(), order.end(), [this](const uint32_t a, const uint32_t b) {
+		return targets_[a].first < targets_[b].first;
+	});
+	textures_.clear();
+	for (const uint32_t index : order) {
+		Target& target = targets_[index];
+		const size_t bytes = textureBytes(target.format, target.scale, width_, height_);
+		auto shared = std::find_if(textures_.begin(), textures_.end(), [&target](const Texture& texture) {
+			return texture.format == target.format && texture.scale == target.scale && texture.last < target.first;
+		});
+		if (shared == textures_.end()) {
+			textures_.push_back(Texture{ target.format, target.scale, 0, GLTexture() });
+			shared = textures_.end() - 1;
+			stats_.bytes += bytes;
+		}
+		shared->last = target.last;
+		target.texture = static_cast<uint32_t>(shared - textures_.begin());
+		stats_.targets++;
+		stats_.unaliasedBytes += bytes;
+	}
+	stats_.textures = static_cast<uint32_t>(textures_.size());
+
+	allocate();
+	compiled_ = true;
+}
+
+void RenderGraph::allocate() {
+	for (Texture& texture : textures_) {
+		texture.texture.reset(createTexture(texture.format, scaled(width_, texture.scale), scaled(height_, texture.scale)));
+	}
+
+	for (Pass& pass : passes_) {
+		pass.framebuffer.reset();
+		if (!pass.alive || pass.output) continue;
+
+		uint32_t framebuffer;
+		glGenFramebuffers(1, &framebuffer);
+		pass.framebuffer.reset(framebuffer);
+		GLState::bindFramebuffer(framebuffer);
+		GLenum buffers[8];
+		GLsizei numBuffers = 0;
+		for (const uint32_t index : pass.writes) {
+			const Target& target = targets_[index];
+			const uint32_t texture = textures_[target.texture].texture.id();
+			if (isDepth(target.format)) {
+				const GLenum attachment = target.format == GL_DEPTH24_STENCIL8 ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+				glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+			} else if (numBuffers < 8) {
+				buffers[numBuffers] = GL_COLOR_ATTACHMENT0 + numBuffers;
+				glFramebufferTexture2D(GL_FRAMEBUFFER, buffers[numBuffers], GL_TEXTURE_2D, texture, 0);
+				numBuffers++;
+			}
+		}
+		if (numBuffers) {
+			glDrawBuffers(numBuffers, buffers);
+		} else {
+			glDrawBuffer(GL_NONE);
+		}
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "Error Render Graph FrameBuffer Not Complete " << pass.name << std::endl;
+		}
+	}
+}
+
+void RenderGraph::resize(const uint32_t width, const uint32_t height) {
+	if (width == width_ && height == height_) return;
+	width_ = width;
+	height_ = height;
+	if (!compiled_) return;	// Allocated at the right size by the next compile
+	allocate();
+
+	stats_.bytes = 0;
+	stats_.unaliasedBytes = 0;
+	for (const Texture& texture : textures_) {
+		stats_.bytes += textureBytes(texture.format, texture.scale, width_, height_);
+	}
+	for (const Target& target : targets_) {
+		if (target.first == k_NoPass) continue;
+		stats_.unaliasedBytes += textureBytes(target.format, target.scale, width_, height_);
+	}
+}
+
+void RenderGraph::execute(const uint32_t output) {
+	if (!compiled_) compile();
+
+	for (const Pass& pass : passes_) {
+		if (!pass.alive) continue;
+		// Passes draw at the size of what they write
+		const float scale = pass.output || pass.writes.empty() ? 1.0f : targets_[pass.writes.front()].scale;
+		GLState::bindFramebuffer(pass.output ? output : pass.framebuffer.id());
+		GLState::viewport(0, 0, scaled(width_, scale), scaled(height_, scale));
+		pass.execute(*this);
+	}
+}
+
+uint32_t RenderGraph::texture(const uint32_t target) const {
+	const Target& info = targets_[target];
+	if (info.first == k_NoPass) return 0;
+	return textures_[info.texture].texture.id();
+}
@@ -0,0 +1,196 @@
+#include "render_queue.h"
+#include "gl_state.h"
+#include "hash.h"
+#include "mesh.h"
+#include "shader.h"
+#include <glad/glad.h>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+const uint64_t k_Unbound = ~0ull;
+constexpr UniformName k_ModelUniform("model");
+constexpr UniformName k_NormalMatUniform("normalMat");
+
+uint64_t field(const uint64_t value, const uint32_t bits) {
+	return value & ((1ull << bits) - 1);
+}
+
+// Positive floats compare like their bits, the top ones are enough to order draws
+uint64_t quantizeDepth(const float depth, const uint32_t bits) {
+	const float clamped = depth > 0.0f ? depth : 0.0f;
+	uint32_t value;
+	memcpy(&value, &clamped, sizeof(value));
+	return value >> (31 - bits);
+}
+
+}
+
+void RenderQueue::begin(const glm::mat4& view) {
+	view_ = view;
+	items_.clear();
+	entries_.clear();
+	// Ids only have to be consistent within a frame, the maps would grow forever otherwise
+	programIds_.clear();
+	textureSetIds_.clear();
+	vertexArrayIds_.clear();
+}
+
+void RenderQueue::submit(const Mesh& mesh, const uint32_t VAO, const Shader& shader, const glm::mat4& model,
+	const RenderPass pass) {
+	// Meshes with the same textures as other samplers set other uniforms, so the roles count
+	uint64_t textures = k_FNVOffset;
+	for (const TextureBinding& binding : mesh.bindings()) {
+		const uint32_t id = binding.texture ? binding.texture->id : 0;
+		textures = hashBytes(&id, sizeof(id), textures);
+		textures = hashBytes(&binding.sampler.hash, sizeof(binding.sampler.hash), textures);
+		textures = hashBytes(&binding.unit, sizeof(binding.unit), textures);
+	}
+
+	DrawItem item;
+	item.shader = &shader;
+	item.mesh = &mesh;
+	item.textures = nullptr;
+	item.numTextures = 0;
+	item.numIndices = 0;
+	item.VAO = VAO;
+	item.program = shader.id();
+	item.textureSet = textures;
+	item.model = model;
+	push(std::move(item), glm::vec3(mesh.boundingSphere_), pass);
+}
+
+void RenderQueue::submit(const uint32_t VAO, const uint32_t numIndices, const uint32_t* textures,
+	const uint32_t numTextures, const Shader& shader, const glm::mat4& model, const RenderPass pass) {
+	DrawItem item;
+	item.shader = &shader;
+	item.mesh = nullptr;
+	item.textures = textures;
+	item.numTextures = numTextures;
+	item.numIndices = numIndices;
+	item.VAO = VAO;
+	item.program = shader.id();
+	item.textureSet = hashBytes(textures, numTextures * sizeof(uint32_t));
+	item.model = model;
+	push(std::move(item), glm::vec3(0.0f), pass);
+}
+
+void RenderQueue::push(DrawItem&& item, const glm::vec3& center, const RenderPass pass) {
+	const float depth = -(view_ * item.model * glm::vec4(center, 1.0f)).z;
+	const uint64_t program = compactId(&programIds_, item.program, k_ProgramBits);
+	const uint64_t textureSet = compactId(&textureSetIds_, item.textureSet, k_TextureBits);
+	const uint64_t vertexArray = compactId(&vertexArrayIds_, item.VAO, k_VertexArrayBits);
+
+	// State first for opaque draws, the depth only orders draws sharing it.
+	// Blended draws must go back to front, so there the depth comes first
+	uint64_t key = field(static_cast<uint64_t>(pass), k_PassBits);
+	if (pass == RenderPass::Transparent) {
+		key = (key << k_DepthBits) | field(~quantizeDepth(depth, k_DepthBits), k_DepthBits);
+		key = (key << k_ProgramBits) | program;
+		key = (key << k_TextureBits) | textureSet;
+		key = (key << k_VertexArrayBits) | vertexArray;
+	} else {
+		key = (key << k_ProgramBits) | program;
+		key = (key << k_TextureBits) | textureSet;
+		key = (key << k_VertexArrayBits) | vertexArray;
+		key = (key << k_DepthBits) | quantizeDepth(depth, k_DepthBits);
+	}
+
+	entries_.push_back(SortEntry{ key, static_cast<uint32_t>(items_.size()) });
+	items_.push_back(std::move(item));
+}
+
+uint32_t RenderQueue::compactId(std::unordered_map<uint64_t, uint32_t>* ids, const uint64_t value,
+	const uint32_t bits) {
+	// Past the field size ids wrap within the frame, draws still come out right but group worse
+	const auto inserted = ids->emplace(value, static_cast<uint32_t>(ids->size()));
+	return static_cast<uint32_t>(field(inserted.first->second, bits));
+}
+
+void RenderQueue::sortEntries() {
+	scratch_.resize(entries_.size());
+	for (uint32_t shift = 0; shift < 64; shift += 8) {
+		uint32_t counts[256] = {};
+		for (const SortEntry& entry : entries_) counts[(entry.key >> shift) & 0xFF]++;
+		// Every key has the same byte here, nothing to move
+		if (counts[(entries_[0].key >> shift) & 0xFF] == entries_.size()) continue;
+
+		uint32_t offset = 0;
+		for (uint32_t& count : counts) {
+			const uint32_t size = count;
+			count = offset;
+			offset += size;
+		}
+		for (const SortEntry& entry : entries_) scratch_[counts[(entry.key >> shift) & 0xFF]++] = entry;
+		entries_.swap(scratch_);
+	}
+}
+
+RenderQueueStats RenderQueue::countChanges(const std::vector<SortEntry>& entries) const {
+	RenderQueueStats stats;
+	uint64_t program = k_Unbound, textureSet = k_Unbound, VAO = k_Unbound;
+	for (const SortEntry& entry : entries) {
+		const DrawItem& item = items_[entry.item];
+		// Sampler uniforms belong to the program, so a new program binds the textures again
+		if (item.program != program) {
+			stats.programChanges++;
+			textureSet = k_Unbound;
+		}
+		if (item.textureSet != textureSet) stats.textureChanges++;
+		if (item.VAO != VAO) stats.vertexArrayChanges++;
+		program = item.program;
+		textureSet = item.textureSet;
+		VAO = item.VAO;
+		stats.draws++;
+	}
+	return stats;
+}
+
+void RenderQueue::flush() {
+	submittedStats_ = countChanges(entries_);
+	if (entries_.empty()) {
+		sortedStats_ = submittedStats_;
+		return;
+	}
+	sortEntries();
+	sortedStats_ = countChanges(entries_);
+
+	uint64_t program = k_Unbound, textureSet = k_Unbound, VAO = k_Unbound;
+	for (const SortEntry& entry : entries_) {
+		const DrawItem& item = items_[entry.item];
+		if (item.program != program) {
+			item.shader->use();
+			textureSet = k_Unbound;
+		}
+		if (item.VAO != VAO) GLState::bindVertexArray(item.VAO);
+		if (item.textureSet != textureSet) {
+			if (item.mesh) {
+				item.mesh->bindTextures(*item.shader);
+			} else {
+				for (uint32_t i = 0; i < item.numTextures; i++) GLState::bindTexture(i, item.textures[i]);
+			}
+		}
+		program = item.program;
+		textureSet = item.textureSet;
+		VAO = item.VAO;
+
+		item.shader->set(k_ModelUniform, item.model);
+		if (item.shader->hasUniform(k_NormalMatUniform)) {
+			item.shader->set(k_NormalMatUniform, glm::inverse(glm::transpose(glm::mat3(item.model))));
+		}
+
+		if (item.mesh) {
+			item.mesh->drawElements(*item.shader);
+		} else {
+			glDrawElements(GL_TRIANGLES, item.numIndices, GL_UNSIGNED_INT, 0);
+		}
+	}
+}
+
+void RenderQueue::printStats() const {
+	std::cout << "Render Queue Draws " << sortedStats_.draws <<
+		", Programs " << submittedStats_.programChanges << " -> " << sortedStats_.programChanges <<
+		", Textures " << submittedStats_.textureChanges << " -> " << sortedStats_.textureChanges <<
+		", VAOs " << submittedStats_.vertexArrayChanges << " -> " << sortedStats_.vertexArrayChanges << std::endl;
+}
@@ -0,0 +1,65 @@
+#include "scene_graph.h"
+#include <algorithm>
+#include <iostream>
+
+uint32_t SceneGraph::addNode(const uint32_t parent, const glm::mat4& local, const uint32_t firstMesh,
+	const uint32_t numMeshes) {
+	const uint32_t node = size();
+	// Only an open subtree ends at the new node, anything else would split a closed one
+	if (parent != k_NoParent && (parent >= node || subtreeEnds_[parent] != node)) {
+		std::cout << "Error Adding Scene Node, Parent " << parent << " Is Not Open" << std::endl;
+		return k_NoParent;
+	}
+
+	parents_.push_back(parent);
+	subtreeEnds_.push_back(node + 1);
+	firstMeshes_.push_back(firstMesh);
+	numMeshes_.push_back(numMeshes);
+	locals_.push_back(local);
+	worlds_.push_back(parent == k_NoParent ? local : worlds_[parent] * local);
+	dirty_.push_back(0);
+	for (uint32_t ancestor = parent; ancestor != k_NoParent; ancestor = parents_[ancestor]) {
+		subtreeEnds_[ancestor] = node + 1;
+	}
+	return node;
+}
+
+void SceneGraph::clear() {
+	parents_.clear();
+	subtreeEnds_.clear();
+	firstMeshes_.clear();
+	numMeshes_.clear();
+	locals_.clear();
+	worlds_.clear();
+	dirty_.clear();
+	dirtyNodes_.clear();
+}
+
+void SceneGraph::setLocal(const uint32_t node, const glm::mat4& local) {
+	locals_[node] = local;
+	if (!dirty_[node]) {
+		dirty_[node] = 1;
+		dirtyNodes_.push_back(node);
+	}
+}
+
+uint32_t SceneGraph::update(std::vector<uint32_t>* updated) {
+	// Ancestors sort first, a dirty node inside an updated subtree was already covered
+	std::sort(dirtyNodes_.begin(), dirtyNodes_.end());
+	uint32_t count = 0, end = 0;
+	for (const uint32_t root : dirtyNodes_) {
+		dirty_[root] = 0;
+		if (root < end) continue;
+
+		// Parents come first, so their world transform is final when a child reads it
+		end = subtreeEnds_[root];
+		for (uint32_t node = root; node < end; node++) {
+			const uint32_t parent = parents_[node];
+			worlds_[node] = parent == k_NoParent ? locals_[node] : worlds_[parent] * locals_[node];
+			if (updated) updated->push_back(node);
+		}
+		count += end - root;
+	}
+	dirtyNodes_.clear();
+	return count;
+}
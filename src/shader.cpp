@@ -1,10 +1,117 @@
 #include "shader.h"
+#include "frame_uniforms.h"
+#include "gl_state.h"
+#include "mapped_file.h"
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
 #include "glad/glad.h"
+#include <GLFW/glfw3.h>
 #include "glm/gtc/type_ptr.hpp"
 
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+UniformStats Shader::stats_;
+std::string Shader::cacheDirectory_ = "shader_cache";
+ProgramCacheStats Shader::cacheStats_;
+
+namespace {
+
+// Not in the GL 3.3 headers
+const GLenum k_ComputeShader = 0x91B9;
+const GLenum k_ProgramBinaryRetrievableHint = 0x8257;
+const GLenum k_ProgramBinaryLength = 0x8741;
+
+typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei* length,
+	GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+
+GetProgramBinaryProc getProgramBinary = nullptr;
+ProgramBinaryProc programBinary = nullptr;
+ProgramParameteriProc programParameteri = nullptr;
+
+const char k_Magic[4] = { 'P', 'R', 'G', 'B' };
+
+struct FileHeader {
+	char magic[4];
+	uint32_t version;
+	uint64_t key;
+	uint32_t format;	// Driver specific binary format
+	uint32_t size;
+};
+
+bool hasExtension(const char* name) {
+	int32_t count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (int32_t i = 0; i < count; i++) {
+		const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+		if (extension && strcmp(extension, name) == 0) return true;
+	}
+	return false;
+}
+
+bool loadFunctions() {
+	static bool loaded = false;
+	if (loaded) return programBinary != nullptr;
+	loaded = true;
+
+	int32_t major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	if ((major < 4 || (major == 4 && minor < 1)) && !hasExtension("GL_ARB_get_program_binary")) return false;
+
+	getProgramBinary = (GetProgramBinaryProc)glfwGetProcAddress("glGetProgramBinary");
+	programBinary = (ProgramBinaryProc)glfwGetProcAddress("glProgramBinary");
+	programParameteri = (ProgramParameteriProc)glfwGetProcAddress("glProgramParameteri");
+	if (!getProgramBinary || !programBinary || !programParameteri) {
+		programBinary = nullptr;
+		return false;
+	}
+	return true;
+}
+
+// File of the slot key falls in, the header holds the whole key
+std::string cachePath(const std::string& directory, const uint64_t key) {
+	char name[32];
+	snprintf(name, sizeof(name), "slot%02u.progbin", static_cast<uint32_t>(key % k_ProgramCacheSlots));
+	return directory + '/' + name;
+}
+
+// Creates the directory when missing, its parent must exist
+void makeDirectory(const std::string& directory) {
+#ifdef _WIN32
+	_mkdir(directory.c_str());
+#else
+	mkdir(directory.c_str(), 0755);
+#endif
+}
+
+// Size of a uniform of a GL type in 32 bit words
+uint32_t uniformWords(const GLenum type) {
+	switch (type) {
+	case GL_FLOAT_VEC2: case GL_INT_VEC2: case GL_UNSIGNED_INT_VEC2: case GL_BOOL_VEC2: return 2;
+	case GL_FLOAT_VEC3: case GL_INT_VEC3: case GL_UNSIGNED_INT_VEC3: case GL_BOOL_VEC3: return 3;
+	case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_UNSIGNED_INT_VEC4: case GL_BOOL_VEC4: return 4;
+	case GL_FLOAT_MAT2: return 4;
+	case GL_FLOAT_MAT3: return 9;
+	case GL_FLOAT_MAT4: return 16;
+	case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT3x2: return 6;
+	case GL_FLOAT_MAT2x4: case GL_FLOAT_MAT4x2: return 8;
+	case GL_FLOAT_MAT3x4: case GL_FLOAT_MAT4x3: return 12;
+	default: return 1;	// Scalars and samplers
+	}
+}
+
+}
+
 Shader::Shader(const char* vertexPath, const char* fragmentPath,
 	const char* geometryPath) {	//Load Shaders font code
 	
@@ -15,8 +122,18 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath,
 		loadShader(geometryPath, &sGeometryCode);
 	}
 
-	const char* vertexCode = sVertexCode.c_str();
-	const char* fragmentCode = sFragementCode.c_str();
+	build(sVertexCode.c_str(), sFragementCode.c_str(), geometryPath ? sGeometryCode.c_str() : nullptr);
+}
+
+Shader::Shader(FromSource, const char* vertexCode, const char* fragmentCode,
+	const char* geometryCode) {
+	build(vertexCode, fragmentCode, geometryCode);
+}
+
+void Shader::build(const char* vertexCode, const char* fragmentCode, const char* geometryCode) {
+	const char* codes[3] = { vertexCode, fragmentCode, geometryCode };
+	const uint64_t key = programKey(codes, 3);
+	if (loadProgram(key)) return;
 
 	uint32_t vertex = glCreateShader(GL_VERTEX_SHADER);
 	glShaderSource(vertex, 1, &vertexCode, NULL);
@@ -29,8 +146,7 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath,
 	checkErrors(fragment, Type::Fragment);
 
 	uint32_t geometry;
-	if (geometryPath) {
-		const char* geometryCode = sGeometryCode.c_str();
+	if (geometryCode) {
 		geometry = glCreateShader(GL_GEOMETRY_SHADER);
 		glShaderSource(geometry, 1, &geometryCode, NULL);
 		glCompileShader(geometry);
@@ -40,25 +156,145 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath,
 	id_ = glCreateProgram();
 	glAttachShader(id_, vertex);
 	glAttachShader(id_, fragment);
-	if (geometryPath) {
+	if (geometryCode) {
 		glAttachShader(id_, geometry);
 	}
-	glLinkProgram(id_);
-	checkErrors(id_, Type::Program);
+	linkProgram(key);
 
 	glDeleteShader(vertex);
 	glDeleteShader(fragment);
-	if (geometryPath) {
+	if (geometryCode) {
 		glDeleteShader(geometry);
 	}
 }
 
+Shader::Shader(const char* computePath) {
+	std::string sComputeCode;
+	loadShader(computePath, &sComputeCode);
+	const char* computeCode = sComputeCode.c_str();
+	const uint64_t key = programKey(&computeCode, 1);
+	if (loadProgram(key)) return;
+
+	uint32_t compute = glCreateShader(k_ComputeShader);
+	glShaderSource(compute, 1, &computeCode, NULL);
+	glCompileShader(compute);
+	checkErrors(compute, Type::Compute);
+
+	id_ = glCreateProgram();
+	glAttachShader(id_, compute);
+	linkProgram(key);
+
+	glDeleteShader(compute);
+}
+
+uint64_t Shader::programKey(const char* const* codes, const uint32_t numCodes) {
+	if (cacheDirectory_.empty() || !loadFunctions()) return 0;
+
+	// Binaries only load on the driver that made them
+	uint64_t hash = k_FNVOffset;
+	const GLenum strings[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	for (const GLenum name : strings) {
+		const char* value = reinterpret_cast<const char*>(glGetString(name));
+		if (value) hash = hashString(value, hash);
+	}
+	for (uint32_t i = 0; i < numCodes; i++) {
+		// Lengths separate the stages, a missing one hashes differently from an empty one
+		const uint64_t length = codes[i] ? strlen(codes[i]) : ~0ull;
+		hash = hashBytes(&length, sizeof(length), hash);
+		if (codes[i]) hash = hashBytes(codes[i], length, hash);
+	}
+	hash = hashBytes(&k_ProgramCacheVersion, sizeof(k_ProgramCacheVersion), hash);
+	return hash ? hash : 1;	// 0 is reserved for "no key"
+}
+
+bool Shader::loadProgram(const uint64_t key) {
+	if (!key) return false;
+	MappedFile file;
+	if (!file.open(cachePath(cacheDirectory_, key))) return false;
+
+	FileHeader header;
+	if (file.size() < sizeof(header)) return false;
+	memcpy(&header, file.data(), sizeof(header));
+	// A slot holding another program is a miss, storing this one replaces it
+	if (memcmp(header.magic, k_Magic, sizeof(k_Magic)) != 0 || header.version != k_ProgramCacheVersion ||
+		header.key != key || file.size() != sizeof(header) + header.size) {
+		return false;
+	}
+
+	// Drivers refuse binaries of other versions or hardware, the program is then compiled
+	// and the file replaced
+	id_ = glCreateProgram();
+	programBinary(id_, header.format, file.data() + sizeof(header), header.size);
+	int success = 0;
+	glGetProgramiv(id_, GL_LINK_STATUS, &success);
+	if (!success) {
+		glDeleteProgram(id_);
+		id_ = 0;
+		cacheStats_.rejected++;
+		return false;
+	}
+	setupProgram();
+	cacheStats_.loaded++;
+	return true;
+}
+
+void Shader::linkProgram(const uint64_t key) {
+	if (key) programParameteri(id_, k_ProgramBinaryRetrievableHint, GL_TRUE);
+	glLinkProgram(id_);
+	checkErrors(id_, Type::Program);
+	setupProgram();
+	cacheStats_.compiled++;
+
+	int success = 0;
+	glGetProgramiv(id_, GL_LINK_STATUS, &success);
+	if (key && success) storeProgram(key);
+}
+
+void Shader::storeProgram(const uint64_t key) const {
+	int32_t length = 0;
+	glGetProgramiv(id_, k_ProgramBinaryLength, &length);
+	if (length <= 0) return;
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	getProgramBinary(id_, length, &length, &format, binary.data());
+
+	// Overwrites whatever program held the slot
+	makeDirectory(cacheDirectory_);
+	const std::string path = cachePath(cacheDirectory_, key);
+	std::ofstream file(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+	if (!file) {
+		std::cout << "Error Writing Program Cache " << path << std::endl;
+		return;
+	}
+
+	// The key is patched in last, so an interrupted write never looks valid
+	FileHeader header;
+	memcpy(header.magic, k_Magic, sizeof(k_Magic));
+	header.version = k_ProgramCacheVersion;
+	header.key = 0;
+	header.format = format;
+	header.size = static_cast<uint32_t>(length);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(binary.data(), length);
+	file.seekp(offsetof(FileHeader, key));
+	file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+}
+
+void Shader::setupProgram() {
+	reflectUniforms();
+
+	// GLSL 330 has no binding qualifier, the shared frame block is bound here
+	const uint32_t frameBlock = glGetUniformBlockIndex(id_, "FrameData");
+	if (frameBlock != GL_INVALID_INDEX) glUniformBlockBinding(id_, frameBlock, k_FrameUniformBinding);
+}
+
 Shader::~Shader() {
 	glDeleteProgram(id_);
+	GLState::forgetProgram(id_);
 }
 
 void Shader::use() const {
-	glUseProgram(id_);
+	GLState::useProgram(id_);
 }
 
 void Shader::checkErrors(const uint32_t shader, const Type type) const {
@@ -68,19 +304,104 @@ void Shader::checkErrors(const uint32_t shader, const Type type) const {
 		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
 		if (!success) {
 			glGetShaderInfoLog(shader, 512, NULL, log);
-			std::cout << "Error Compiling Shader" <<
-				(type == Type::Vertex ? "Vertex " : "Fragment ") << log << std::endl;
+			const char* names[] = { "Vertex ", "Fragment ", "Geometry ", "", "Compute " };
+			std::cout << "Error Compiling Shader" << names[static_cast<int>(type)] << log << std::endl;
 		}
-		else {
-			glGetProgramiv(shader, GL_LINK_STATUS, &success);
-			if (!success) {
-				glGetProgramInfoLog(shader, 512, NULL, log);
-				std::cout << "Error Linking Program" << log << std::endl;
-			}
+	}
+	else {
+		glGetProgramiv(shader, GL_LINK_STATUS, &success);
+		if (!success) {
+			glGetProgramInfoLog(shader, 512, NULL, log);
+			std::cout << "Error Linking Program" << log << std::endl;
+		}
+	}
+}
+
+void Shader::reflectUniforms() {
+	int32_t count = 0, maxLength = 0;
+	glGetProgramiv(id_, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(id_, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+	// Arrays of plain types only list their first element, each element gets its own entry
+	struct Active {
+		std::string name;
+		int32_t location;
+		uint32_t words;
+		bool alias;	// Same uniform as the entry before it, both share one shadow value
+	};
+	std::vector<Active> active;
+	std::vector<char> buffer(maxLength + 1);
+	for (int32_t i = 0; i < count; i++) {
+		int32_t size = 0, length = 0;
+		GLenum type;
+		glGetActiveUniform(id_, i, static_cast<GLsizei>(buffer.size()), &length, &size, &type, buffer.data());
+		const std::string name(buffer.data(), length);
+		const uint32_t words = uniformWords(type);
+
+		// Members of uniform blocks have no location
+		const int32_t location = glGetUniformLocation(id_, name.c_str());
+		if (location < 0) continue;
+		active.push_back(Active{ name, location, words, false });
+
+		const size_t bracket = name.rfind("[0]");
+		if (bracket == std::string::npos || bracket + 3 != name.size()) continue;
+		const std::string base = name.substr(0, bracket);
+		active.push_back(Active{ base, location, words, true });
+		for (int32_t element = 1; element < size; element++) {
+			const std::string elementName = base + '[' + std::to_string(element) + ']';
+			active.push_back(Active{ elementName, glGetUniformLocation(id_, elementName.c_str()), words, false });
+		}
+	}
+
+	size_t capacity = 1;
+	while (capacity < active.size() * 2) capacity <<= 1;
+	uniforms_.assign(capacity, Uniform{ 0, -1, 0, 0, false });
+	shadow_.clear();
+	const size_t mask = capacity - 1;
+	uint32_t offset = 0;
+	for (const Active& uniform : active) {
+		if (uniform.location < 0) continue;
+		const uint64_t hash = hashString(uniform.name.c_str());
+		size_t slot = hash & mask;
+		while (uniforms_[slot].location >= 0 && uniforms_[slot].hash != hash) slot = (slot + 1) & mask;
+		if (!uniform.alias) {
+			offset = static_cast<uint32_t>(shadow_.size());
+			shadow_.resize(shadow_.size() + uniform.words);
 		}
+		uniforms_[slot] = Uniform{ hash, uniform.location, offset, uniform.words, false };
 	}
 }
 
+Shader::Uniform* Shader::findUniform(const UniformName name) const {
+	if (uniforms_.empty()) return nullptr;
+	const size_t mask = uniforms_.size() - 1;
+	for (size_t slot = name.hash & mask;; slot = (slot + 1) & mask) {
+		Uniform& uniform = uniforms_[slot];
+		if (uniform.location < 0) return nullptr;
+		if (uniform.hash == name.hash) return &uniform;
+	}
+}
+
+bool Shader::hasUniform(const UniformName name) const {
+	return findUniform(name) != nullptr;
+}
+
+int32_t Shader::changedLocation(const UniformName name, const void* value, const uint32_t words) const {
+	stats_.sets++;
+	Uniform* uniform = findUniform(name);
+	if (!uniform) return -1;	// Not active, GL would ignore it anyway
+
+	// A value of another size than the declaration can not be compared, GL reports the mismatch
+	if (words == uniform->words) {
+		uint32_t* shadow = shadow_.data() + uniform->offset;
+		if (uniform->known && memcmp(shadow, value, words * sizeof(uint32_t)) == 0) return -1;
+		memcpy(shadow, value, words * sizeof(uint32_t));
+		uniform->known = true;
+	}
+	stats_.uploads++;
+	return uniform->location;
+}
+
 void Shader::loadShader(const char* path, std::string* code) {
 	std::ifstream file;
 
@@ -94,52 +415,62 @@ void Shader::loadShader(const char* path, std::string* code) {
 	}
 }
 
-void Shader::set(const char* name, const bool value) const {
-	glUniform1i(glGetUniformLocation(id_, name), static_cast<int>(value));
+void Shader::set(const UniformName name, const bool value) const {
+	const int32_t integer = static_cast<int32_t>(value);
+	const int32_t location = changedLocation(name, &integer, 1);
+	if (location >= 0) glUniform1i(location, integer);
 }
 
-void Shader::set(const char* name, const int value) const {
-	glUniform1i(glGetUniformLocation(id_, name), value);
+void Shader::set(const UniformName name, const int value) const {
+	const int32_t location = changedLocation(name, &value, 1);
+	if (location >= 0) glUniform1i(location, value);
 }
 
-void Shader::set(const char* name, const float value) const {
-	glUniform1f(glGetUniformLocation(id_, name), value);
+void Shader::set(const UniformName name, const float value) const {
+	const int32_t location = changedLocation(name, &value, 1);
+	if (location >= 0) glUniform1f(location, value);
 }
 
-void Shader::set(const char* name, const float value1, const float value2) const {
-	glUniform2f(glGetUniformLocation(id_, name), value1, value2);
+void Shader::set(const UniformName name, const float value1, const float value2) const {
+	set(name, glm::vec2(value1, value2));
 }
 
-void Shader::set(const char* name, const float value1, const float value2,
+void Shader::set(const UniformName name, const float value1, const float value2,
 	const float value3) const {
-	glUniform3f(glGetUniformLocation(id_, name), value1, value2, value3);
+	set(name, glm::vec3(value1, value2, value3));
 }
 
-void Shader::set(const char* name, const float value1, const float value2,
+void Shader::set(const UniformName name, const float value1, const float value2,
 	const float value3, const float value4) const {
-	glUniform4f(glGetUniformLocation(id_, name), value1, value2, value3, value4);
+	set(name, glm::vec4(value1, value2, value3, value4));
 }
 
-void Shader::set(const char* name, const glm::vec2& value) const {
-	glUniform2fv(glGetUniformLocation(id_, name), 1, glm::value_ptr(value));
+void Shader::set(const UniformName name, const glm::vec2& value) const {
+	const int32_t location = changedLocation(name, glm::value_ptr(value), 2);
+	if (location >= 0) glUniform2fv(location, 1, glm::value_ptr(value));
 }
 
-void Shader::set(const char* name, const glm::vec3& value) const {
-	glUniform3fv(glGetUniformLocation(id_, name), 1, glm::value_ptr(value));
+void Shader::set(const UniformName name, const glm::vec3& value) const {
+	const int32_t location = changedLocation(name, glm::value_ptr(value), 3);
+	if (location >= 0) glUniform3fv(location, 1, glm::value_ptr(value));
 }
 
-void Shader::set(const char* name, const glm::vec4& value) const {
-	glUniform4fv(glGetUniformLocation(id_, name), 1, glm::value_ptr(value));
+void Shader::set(const UniformName name, const glm::vec4& value) const {
+	const int32_t location = changedLocation(name, glm::value_ptr(value), 4);
+	if (location >= 0) glUniform4fv(location, 1, glm::value_ptr(value));
 }
 
-void Shader::set(const char* name, const glm::mat2& value) const {
-	glUniformMatrix2fv(glGetUniformLocation(id_, name), 1, GL_FALSE, glm::value_ptr(value));
+void Shader::set(const UniformName name, const glm::mat2& value) const {
+	const int32_t location = changedLocation(name, glm::value_ptr(value), 4);
+	if (location >= 0) glUniformMatrix2fv(location, 1, GL_FALSE, glm::value_ptr(value));
 }
 
-void Shader::set(const char* name, const glm::mat3& value) const {
-	glUniformMatrix3fv(glGetUniformLocation(id_, name), 1, GL_FALSE, glm::value_ptr(value));
+void Shader::set(const UniformName name, const glm::mat3& value) const {
+	const int32_t location = changedLocation(name, glm::value_ptr(value), 9);
+	if (location >= 0) glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
 }
 
-void Shader::set(const char* name, const glm::mat4& value) const {
-	glUniformMatrix4fv(glGetUniformLocation(id_, name), 1, GL_FALSE, glm::value_ptr(value));
-}
\ No newline at end of file
+void Shader::set(const UniformName name, const glm::mat4& value) const {
+	const int32_t location = changedLocation(name, glm::value_ptr(value), 16);
+	if (location >= 0) glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+}
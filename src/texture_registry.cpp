@@ -0,0 +1,124 @@
+#include "texture_registry.h"
+#include "gl_state.h"
+#include "hash.h"
+#include "mapped_file.h"
+#include "upload_service.h"
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+#include <glad/glad.h>
+#include <stb_image.h>
+
+static std::string canonicalPath(const std::string& path) {
+#ifdef _WIN32
+	char full[_MAX_PATH];
+	std::string result = _fullpath(full, path.c_str(), _MAX_PATH) ? full : path;
+	for (char& c : result) {	// Windows paths are case insensitive
+		c = (c == '\\') ? '/' : static_cast<char>(tolower(static_cast<unsigned char>(c)));
+	}
+#else
+	char* full = realpath(path.c_str(), NULL);
+	std::string result = full ? full : path;
+	free(full);
+#endif
+	return result;
+}
+
+static uint32_t textureFromFile(const std::string& path) {
+	uint32_t textureID;
+	glGenTextures(1, &textureID);
+
+	int widht, height, nrComponents;
+	unsigned char * data = stbi_load(path.c_str(), &widht, &height, &nrComponents, 0);
+	if (data) {
+		GLenum format = GL_RGB;
+		if (nrComponents == 1) {
+			format = GL_RED;
+		}
+		else if (nrComponents == 4) {
+			format = GL_RGBA;
+		}
+
+		GLState::bindTexture(0, textureID);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, widht, height, 0, format, GL_UNSIGNED_BYTE, data);
+		glGenerateMipmap(GL_TEXTURE_2D);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+	else {
+		std::cout << "Failed to load the texture at path: " << path << std::endl;
+	}
+	stbi_image_free(data);
+	return textureID;
+}
+
+TextureResource::~TextureResource() {
+	if (id) {
+		glDeleteTextures(1, &id);
+		GLState::forgetTexture(id);
+	}
+	TextureRegistry::instance().release(*this);
+}
+
+TextureRegistry& TextureRegistry::instance() {
+	static TextureRegistry registry;
+	return registry;
+}
+
+TextureHandle TextureRegistry::acquire(const std::string& path, UploadService* uploads) {
+	const std::string key = canonicalPath(path);
+	auto found = byPath_.find(key);
+	if (found != byPath_.end()) {
+		if (TextureHandle handle = found->second.lock()) return handle;
+	}
+
+	// Same image under another name
+	uint64_t contentHash = 0;
+	if (hashContents_) {
+		MappedFile file;
+		if (file.open(key)) contentHash = hashBytes(file.data(), file.size());
+		auto same = byContent_.find(contentHash);
+		if (contentHash && same != byContent_.end()) {
+			if (TextureHandle handle = same->second.lock()) {
+				handle->paths.push_back(key);
+				byPath_[key] = handle;
+				return handle;
+			}
+		}
+	}
+
+	TextureHandle handle = std::make_shared<TextureResource>();
+	handle->paths.push_back(key);
+	handle->contentHash = contentHash;
+	byPath_[key] = handle;
+	if (contentHash) byContent_[contentHash] = handle;
+	count_++;
+
+	if (uploads) {
+		std::weak_ptr<TextureResource> pending = handle;
+		uploads->uploadTexture(key, [pending](uint32_t id) {
+			TextureHandle alive = pending.lock();
+			if (alive) {
+				alive->id = id;
+			}
+			else {
+				glDeleteTextures(1, &id); // Every user went away while it was uploading
+			}
+		});
+	}
+	else {
+		handle->id = textureFromFile(key);
+	}
+	return handle;
+}
+
+void TextureRegistry::release(const TextureResource& resource) {
+	for (const std::string& path : resource.paths) {
+		byPath_.erase(path);
+	}
+	if (resource.contentHash) byContent_.erase(resource.contentHash);
+	count_--;
+}
@@ -0,0 +1,71 @@
+#include "thread_pool.h"
+
+ThreadPool& ThreadPool::instance() {
+	static ThreadPool pool(std::thread::hardware_concurrency());
+	return pool;
+}
+
+ThreadPool::ThreadPool(const uint32_t numThreads) {
+	// The caller of parallelFor is one of the threads
+	for (uint32_t i = 1; i < numThreads; i++) {
+		workers_.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		quit_ = true;
+	}
+	wake_.notify_all();
+	for (std::thread& worker : workers_) {
+		worker.join();
+	}
+}
+
+void ThreadPool::parallelFor(const uint32_t count, const std::function<void(uint32_t)>& job) {
+	std::lock_guard<std::mutex> call(callMutex_);
+	if (workers_.empty() || count < 2) {
+		for (uint32_t i = 0; i < count; i++) job(i);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		job_ = &job;
+		count_ = count;
+		next_ = 0;
+		busy_ = static_cast<uint32_t>(workers_.size());
+		generation_++;
+	}
+	wake_.notify_all();
+
+	runJobs();
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	done_.wait(lock, [this] { return busy_ == 0; });
+	job_ = nullptr;
+}
+
+void ThreadPool::workerLoop() {
+	uint64_t seen = 0;
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (true) {
+		wake_.wait(lock, [&] { return quit_ || generation_ != seen; });
+		if (quit_) return;
+		seen = generation_;
+
+		lock.unlock();
+		runJobs();
+		lock.lock();
+
+		if (--busy_ == 0) done_.notify_one();
+	}
+}
+
+void ThreadPool::runJobs() {
+	// Jobs are handed out one index at a time, so uneven jobs balance themselves
+	for (uint32_t i = next_++; i < count_; i = next_++) {
+		(*job_)(i);
+	}
+}
@@ -0,0 +1,225 @@
+#include "upload_service.h"
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stb_image.h>
+
+// Bytes copied through the staging buffer per step
+static const size_t k_ChunkSize = 1024 * 1024;
+
+UploadService::UploadService(GLFWwindow* mainWindow, const size_t bytesPerFrame) :
+	bytesPerFrame_(bytesPerFrame), credit_(static_cast<int64_t>(bytesPerFrame)) {
+	// Hidden 1x1 window, only used for its context
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	context_ = glfwCreateWindow(1, 1, "Uploads", NULL, mainWindow);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+	if (!context_) {
+		std::cout << "Failed To Create Upload Context" << std::endl;
+		return;
+	}
+	worker_ = std::thread(&UploadService::workerLoop, this);
+}
+
+UploadService::~UploadService() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		quit_ = true;
+	}
+	wake_.notify_all();
+	if (worker_.joinable()) worker_.join();
+
+	// Their owners may be gone, the objects are deleted instead of handed over
+	for (Completion& completion : completions_) {
+		glDeleteSync(completion.fence);
+		glDeleteBuffers(2, completion.buffers);
+		glDeleteTextures(1, &completion.texture);
+	}
+	if (context_) glfwDestroyWindow(context_);
+}
+
+void UploadService::uploadMesh(const void* vertices, const size_t verticesSize, const void* indices,
+	const size_t indicesSize, std::function<void(uint32_t VBO, uint32_t EBO)> onReady) {
+	Job job;
+	job.vertices.assign(static_cast<const uint8_t*>(vertices), static_cast<const uint8_t*>(vertices) + verticesSize);
+	job.indices.assign(static_cast<const uint8_t*>(indices), static_cast<const uint8_t*>(indices) + indicesSize);
+	job.onMeshReady = std::move(onReady);
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		jobs_.push_back(std::move(job));
+	}
+	wake_.notify_all();
+}
+
+void UploadService::uploadTexture(const std::string& path, std::function<void(uint32_t id)> onReady) {
+	Job job;
+	job.path = path;
+	job.onTextureReady = std::move(onReady);
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		jobs_.push_back(std::move(job));
+	}
+	wake_.notify_all();
+}
+
+void UploadService::update(const double budgetMs) {
+	const double start = glfwGetTime();
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		credit_ = static_cast<int64_t>(bytesPerFrame_);
+	}
+	wake_.notify_all();
+
+	// Completions are finished in submission order, the first pending fence stops the frame
+	while ((glfwGetTime() - start) * 1000.0 < budgetMs) {
+		Completion completion;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (completions_.empty()) break;
+			GLenum state = glClientWaitSync(completions_.front().fence, 0, 0);
+			if (state == GL_TIMEOUT_EXPIRED || state == GL_WAIT_FAILED) break;
+			completion = std::move(completions_.front());
+			completions_.pop_front();
+		}
+		glDeleteSync(completion.fence);
+		completion.finish();
+	}
+}
+
+bool UploadService::idle() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return jobs_.empty() && completions_.empty() && inFlight_ == 0;
+}
+
+void UploadService::workerLoop() {
+	glfwMakeContextCurrent(context_);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glGenBuffers(1, &staging_);
+	glGenBuffers(1, &pbo_);
+
+	while (true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			wake_.wait(lock, [this] { return quit_ || !jobs_.empty(); });
+			if (quit_) break;
+			job = std::move(jobs_.front());
+			jobs_.pop_front();
+			inFlight_++;
+		}
+
+		if (job.onMeshReady) {
+			uploadMeshJob(job);
+		} else {
+			uploadTextureJob(job);
+		}
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		inFlight_--;
+	}
+
+	glDeleteBuffers(1, &staging_);
+	glDeleteBuffers(1, &pbo_);
+	glfwMakeContextCurrent(NULL);
+}
+
+void UploadService::uploadMeshJob(Job& job) {
+	uint32_t buffers[2];
+	glGenBuffers(2, buffers);
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[0]);
+	glBufferData(GL_COPY_WRITE_BUFFER, job.vertices.size(), NULL, GL_STATIC_DRAW);
+	streamBuffer(job.vertices.data(), job.vertices.size());
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[1]);
+	glBufferData(GL_COPY_WRITE_BUFFER, job.indices.size(), NULL, GL_STATIC_DRAW);
+	streamBuffer(job.indices.data(), job.indices.size());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	std::function<void(uint32_t, uint32_t)> onReady = std::move(job.onMeshReady);
+	uint32_t VBO = buffers[0], EBO = buffers[1];
+	complete([onReady, VBO, EBO]() { onReady(VBO, EBO); }, VBO, EBO, 0);
+}
+
+void UploadService::uploadTextureJob(Job& job) {
+	// Decoding needs no context, only the upload goes through the PBO
+	int width, height, nrComponents;
+	unsigned char* data = stbi_load(job.path.c_str(), &width, &height, &nrComponents, 0);
+
+	uint32_t textureID;
+	glGenTextures(1, &textureID);
+	if (data) {
+		GLenum format = GL_RGB;
+		if (nrComponents == 1) {
+			format = GL_RED;
+		}
+		else if (nrComponents == 4) {
+			format = GL_RGBA;
+		}
+
+		glBindTexture(GL_TEXTURE_2D, textureID);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, NULL);
+
+		// Rows are streamed in bands so one big image does not blow the frame budget
+		const size_t rowSize = static_cast<size_t>(width) * nrComponents;
+		const int32_t bandRows = std::max<int32_t>(1, static_cast<int32_t>(k_ChunkSize / rowSize));
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_);
+		for (int32_t row = 0; row < height; row += bandRows) {
+			const int32_t rows = std::min(bandRows, height - row);
+			const size_t size = rows * rowSize;
+			acquire(size);
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+			void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+			memcpy(dst, data + row * rowSize, size);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, row, width, rows, format, GL_UNSIGNED_BYTE, 0);
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glGenerateMipmap(GL_TEXTURE_2D);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	else {
+		std::cout << "Failed to load the texture at path: " << job.path << std::endl;
+	}
+	stbi_image_free(data);
+
+	std::function<void(uint32_t)> onReady = std::move(job.onTextureReady);
+	complete([onReady, textureID]() { onReady(textureID); }, 0, 0, textureID);
+}
+
+void UploadService::streamBuffer(const uint8_t* data, const size_t size) {
+	glBindBuffer(GL_COPY_READ_BUFFER, staging_);
+	for (size_t offset = 0; offset < size; offset += k_ChunkSize) {
+		const size_t chunk = std::min(k_ChunkSize, size - offset);
+		acquire(chunk);
+		// Orphaning the staging storage lets the driver keep the previous copy in flight
+		glBufferData(GL_COPY_READ_BUFFER, chunk, NULL, GL_STREAM_DRAW);
+		void* dst = glMapBufferRange(GL_COPY_READ_BUFFER, 0, chunk, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		memcpy(dst, data + offset, chunk);
+		glUnmapBuffer(GL_COPY_READ_BUFFER);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, offset, chunk);
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+void UploadService::acquire(const size_t bytes) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	wake_.wait(lock, [this] { return quit_ || credit_ > 0; });
+	credit_ -= static_cast<int64_t>(bytes);
+}
+
+void UploadService::complete(std::function<void()> finish, const uint32_t VBO, const uint32_t EBO,
+	const uint32_t texture) {
+	// The flush makes the fence visible to the main context
+	GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	completions_.push_back(Completion{ fence, std::move(finish), { VBO, EBO }, texture });
+}
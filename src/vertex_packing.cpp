@@ -0,0 +1,117 @@
+#include "vertex_packing.h"
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cmath>
+
+static const float k_SnormMax = 32767.0f;
+
+static int16_t toSnorm(const float value) {
+	return static_cast<int16_t>(std::round(glm::clamp(value, -1.0f, 1.0f) * k_SnormMax));
+}
+
+// Same rule as GL uses for normalized shorts
+static float fromSnorm(const int16_t value) {
+	return std::max(value / k_SnormMax, -1.0f);
+}
+
+PositionDecode VertexPacking::packVertices(const Vertex* vertices, const uint32_t numVertices, PackedVertex* packed) {
+	PositionDecode decode;
+	if (!numVertices) return decode;
+
+	glm::vec3 min = vertices[0].Position, max = vertices[0].Position;
+	for (uint32_t i = 1; i < numVertices; i++) {
+		min = glm::min(min, vertices[i].Position);
+		max = glm::max(max, vertices[i].Position);
+	}
+	decode.offset = (min + max) * 0.5f;
+	decode.scale = (max - min) * 0.5f;
+
+	// Flat axes keep a zero scale and quantize to the center
+	glm::vec3 invScale(0.0f);
+	for (int axis = 0; axis < 3; axis++) {
+		if (decode.scale[axis] > 0.0f) invScale[axis] = 1.0f / decode.scale[axis];
+	}
+
+	for (uint32_t i = 0; i < numVertices; i++) {
+		const Vertex& vertex = vertices[i];
+		PackedVertex& out = packed[i];
+
+		const glm::vec3 position = (vertex.Position - decode.offset) * invScale;
+		out.Position[0] = toSnorm(position.x);
+		out.Position[1] = toSnorm(position.y);
+		out.Position[2] = toSnorm(position.z);
+		// Handedness of the tangent frame, the bitangent is not stored
+		const bool flipped = glm::dot(glm::cross(vertex.Normal, vertex.Tangent), vertex.Bitangent) < 0.0f;
+		out.Position[3] = flipped ? -32767 : 32767;
+
+		encodeOctahedral(vertex.Normal, out.Normal);
+		encodeOctahedral(vertex.Tangent, out.Tangent);
+
+		out.TexCoords[0] = glm::packHalf1x16(vertex.TexCoords.x);
+		out.TexCoords[1] = glm::packHalf1x16(vertex.TexCoords.y);
+	}
+	return decode;
+}
+
+Vertex VertexPacking::unpackVertex(const PackedVertex& packed, const PositionDecode& decode) {
+	Vertex vertex;
+	const glm::vec3 position(fromSnorm(packed.Position[0]), fromSnorm(packed.Position[1]),
+		fromSnorm(packed.Position[2]));
+	vertex.Position = decode.offset + decode.scale * position;
+	vertex.Normal = decodeOctahedral(packed.Normal);
+	vertex.TexCoords = glm::vec2(glm::unpackHalf1x16(packed.TexCoords[0]), glm::unpackHalf1x16(packed.TexCoords[1]));
+	vertex.Tangent = decodeOctahedral(packed.Tangent);
+	vertex.Bitangent = glm::cross(vertex.Normal, vertex.Tangent) * fromSnorm(packed.Position[3]);
+	return vertex;
+}
+
+void VertexPacking::packIndices(const uint32_t* indices, const uint32_t numIndices, uint16_t* packed) {
+	for (uint32_t i = 0; i < numIndices; i++) {
+		packed[i] = static_cast<uint16_t>(indices[i]);
+	}
+}
+
+void VertexPacking::encodeOctahedral(const glm::vec3& n, int16_t* encoded) {
+	const float length = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+	if (length == 0.0f) {	// Missing normals stay zero instead of turning into NaN
+		encoded[0] = encoded[1] = 0;
+		return;
+	}
+
+	// Project on the octahedron and unfold the lower half over the corners
+	glm::vec2 p = glm::vec2(n.x, n.y) / length;
+	if (n.z < 0.0f) {
+		const glm::vec2 sign(p.x >= 0.0f ? 1.0f : -1.0f, p.y >= 0.0f ? 1.0f : -1.0f);
+		p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * sign;
+	}
+
+	// Plain rounding is not the closest direction, try the four neighbours
+	const glm::vec3 unit = glm::normalize(n);
+	const float x = std::floor(glm::clamp(p.x, -1.0f, 1.0f) * k_SnormMax);
+	const float y = std::floor(glm::clamp(p.y, -1.0f, 1.0f) * k_SnormMax);
+	float best = -2.0f;
+	for (int i = 0; i < 4; i++) {
+		const int16_t candidate[2] = {
+			static_cast<int16_t>(std::min(x + (i & 1), k_SnormMax)),
+			static_cast<int16_t>(std::min(y + (i >> 1), k_SnormMax))
+		};
+		const float similarity = glm::dot(decodeOctahedral(candidate), unit);
+		if (similarity > best) {
+			best = similarity;
+			encoded[0] = candidate[0];
+			encoded[1] = candidate[1];
+		}
+	}
+}
+
+glm::vec3 VertexPacking::decodeOctahedral(const int16_t* encoded) {
+	glm::vec3 n(fromSnorm(encoded[0]), fromSnorm(encoded[1]), 0.0f);
+	n.z = 1.0f - std::abs(n.x) - std::abs(n.y);
+	if (n.z < 0.0f) {
+		const glm::vec2 sign(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+		const glm::vec2 folded = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * sign;
+		n.x = folded.x;
+		n.y = folded.y;
+	}
+	return glm::normalize(n);
+}
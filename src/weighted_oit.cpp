@@ -0,0 +1,102 @@
+#include "weighted_oit.h"
+#include "gl_state.h"
+#include "shader.h"
+#include <glad/glad.h>
+#include <iostream>
+
+namespace {
+
+constexpr UniformName k_AccumulationUniform("accumulation");
+constexpr UniformName k_WeightsUniform("weights");
+
+uint32_t createTexture(const GLenum format, const uint32_t width, const uint32_t height) {
+	uint32_t texture;
+	glGenTextures(1, &texture);
+	GLState::bindTexture(0, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	return texture;
+}
+
+}
+
+WeightedOit::WeightedOit(const uint32_t width, const uint32_t height) :
+	width_(width), height_(height) {
+	uint32_t VAO;
+	glGenVertexArrays(1, &VAO);
+	emptyVAO_.reset(VAO);
+	createTargets();
+}
+
+void WeightedOit::resize(const uint32_t width, const uint32_t height) {
+	if (width == width_ && height == height_) return;
+	width_ = width;
+	height_ = height;
+	createTargets();
+}
+
+void WeightedOit::createTargets() {
+	// Half floats hold the weighted sums, the revealage product only needs the alpha
+	accumulation_.reset(createTexture(GL_RGBA16F, width_, height_));
+	weights_.reset(createTexture(GL_R16F, width_, height_));
+
+	uint32_t depth;
+	glGenRenderbuffers(1, &depth);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width_, height_);
+	depth_.reset(depth);
+
+	uint32_t framebuffer;
+	glGenFramebuffers(1, &framebuffer);
+	framebuffer_.reset(framebuffer);
+	GLState::bindFramebuffer(framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, accumulation_.id(), 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, weights_.id(), 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth);
+	const GLenum buffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, buffers);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cout << "Error OIT FrameBuffer Not Complete" << std::endl;
+	}
+}
+
+void WeightedOit::begin(const uint32_t source) {
+	// Transparent surfaces behind the opaque ones must still fail the depth test.
+	// The read binding goes back to the draw one, as GLState expects
+	GLState::bindFramebuffer(framebuffer_.id());
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, source);
+	glBlitFramebuffer(0, 0, width_, height_, 0, 0, width_, height_, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer_.id());
+
+	const float revealage[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	const float weights[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	glClearBufferfv(GL_COLOR, 0, revealage);
+	glClearBufferfv(GL_COLOR, 1, weights);
+
+	// GL 3.3 has one blend function for all targets: the colors add up and
+	// the alpha of the accumulation multiplies into the revealage
+	GLState::enable(GL_DEPTH_TEST);
+	GLState::depthMask(false);
+	GLState::enable(GL_BLEND);
+	GLState::blendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void WeightedOit::composite(const Shader& shader, const uint32_t target) {
+	GLState::bindFramebuffer(target);
+	GLState::disable(GL_DEPTH_TEST);
+	// The shader outputs the average color with the revealage as alpha
+	GLState::blendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+
+	shader.use();
+	shader.set(k_AccumulationUniform, 0);
+	shader.set(k_WeightsUniform, 1);
+	GLState::bindTexture(0, accumulation_.id());
+	GLState::bindTexture(1, weights_.id());
+	GLState::bindVertexArray(emptyVAO_.id());
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	GLState::enable(GL_DEPTH_TEST);
+	GLState::depthMask(true);
+}
@@ -9,6 +9,7 @@
 #include <cstdint>
 #include "shader.h"
 #include "camera.h"
+#include "instance_renderer.h"
 
 #include <stb_image.h>
 
@@ -180,18 +181,10 @@ uint32_t createTexture(const char* path) {
 	return texture;
 }
 
-void render(uint32_t VAO, const Shader& shader, const uint32_t tex1, const uint32_t tex2) {
+void render(uint32_t VAO, const Shader& shader, InstanceRenderer& instances, const uint32_t tex1, const uint32_t tex2) {
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	shader.use();
-	glBindVertexArray(VAO);
-
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, tex1);
-
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, tex2);
-
 	shader.set("texture1", 0);
 	shader.set("texture2", 1);
 
@@ -202,16 +195,17 @@ void render(uint32_t VAO, const Shader& shader, const uint32_t tex1, const uint3
 	shader.set("view", camera.getViewMatrix());
 	shader.set("proj", proj);
 
+	// One instanced draw binds the textures and the VAO for all ten cubes
+	const uint32_t textures[] = { tex1, tex2 };
+	instances.begin();
 	for (uint8_t i = 0; i < 10; i++) {
 		glm::mat4 model = glm::mat4(1.0f);
 		model = glm::translate(model, cubePositions[i]);
 		float angle = 10.0f + (20.0f * i);
 		model = glm::rotate(model, (float)glfwGetTime() * glm::radians(angle), glm::vec3(0.5f, 1.0f, 0.0f));
-		shader.set("model", model);
-
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);	//6*2*3
+		instances.add(VAO, 36, textures, 2, model);	//6*2*3
 	}
-
+	instances.flush(shader);
 }
 
 int main(int args, char* argv[]) {
@@ -242,44 +236,47 @@ int main(int args, char* argv[]) {
 	glfwSetCursorPosCallback(window, onMouse);
 	glfwSetScrollCallback(window, onScroll);
 
-	Shader shader("../tests/AG05_02/vertex.vs", "../tests/AG05_02/fragment.fs");	//Shaders path
-	uint32_t VBO, EBO;
-	uint32_t VAO = createVertexData(&VBO, &EBO);	//Create Vertex Array Object that compiles everything
-
-	//Avoid to load the image reversed
-	stbi_set_flip_vertically_on_load(true);
-
-	//Create texture from images
-	uint32_t tex1 = createTexture("../tests/AG05_02/image.jpg");
-	uint32_t tex2 = createTexture("../tests/AG05_02/image2.jpg");
-
-	glClearColor(0.4f, 0.7f, 0.7f, 1.0f);	//Clear befor entering main loop
-
-	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-	glEnable(GL_CULL_FACE);
-	glCullFace(GL_BACK);
-
-	glEnable(GL_DEPTH_TEST);
-	glDepthFunc(GL_LESS);	//Near cam
-
-	while (!glfwWindowShouldClose(window)) {	//Loop until user closes window
-		float currentFrame = glfwGetTime();
-		float deltaTime = currentFrame - lastFrame;
-		lastFrame = currentFrame;
-
-		handlerInput(window, deltaTime);	//Handle Input
-		render(VAO, shader, tex1, tex2);	//Paint
-		glfwSwapBuffers(window);	//Swap front and back buffers
-		glfwPollEvents();	//Poll for and process events
+	{
+		Shader shader("../tests/AG05_02/vertex.vs", "../tests/AG05_02/fragment.fs");	//Shaders path
+		InstanceRenderer instances;
+		uint32_t VBO, EBO;
+		uint32_t VAO = createVertexData(&VBO, &EBO);	//Create Vertex Array Object that compiles everything
+
+		//Avoid to load the image reversed
+		stbi_set_flip_vertically_on_load(true);
+
+		//Create texture from images
+		uint32_t tex1 = createTexture("../tests/AG05_02/image.jpg");
+		uint32_t tex2 = createTexture("../tests/AG05_02/image2.jpg");
+
+		glClearColor(0.4f, 0.7f, 0.7f, 1.0f);	//Clear befor entering main loop
+
+		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		glEnable(GL_CULL_FACE);
+		glCullFace(GL_BACK);
+
+		glEnable(GL_DEPTH_TEST);
+		glDepthFunc(GL_LESS);	//Near cam
+
+		while (!glfwWindowShouldClose(window)) {	//Loop until user closes window
+			float currentFrame = glfwGetTime();
+			float deltaTime = currentFrame - lastFrame;
+			lastFrame = currentFrame;
+
+			handlerInput(window, deltaTime);	//Handle Input
+			render(VAO, shader, instances, tex1, tex2);	//Paint
+			glfwSwapBuffers(window);	//Swap front and back buffers
+			glfwPollEvents();	//Poll for and process events
+		}
+
+		//Clean everything
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteBuffers(1, &VBO);
+		glDeleteBuffers(1, &EBO);
+		glDeleteTextures(1, &tex1);
+		glDeleteTextures(1, &tex2);
 	}
 
-	//Clean everything
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
-	glDeleteBuffers(1, &EBO);
-	glDeleteTextures(1, &tex1);
-	glDeleteTextures(1, &tex2);
-
 	glfwTerminate();	//Close
 	return 0;	//Ends OK
 }
@@ -1,15 +1,16 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoord;
+// Model matrix of the instance, streamed by InstanceRenderer
+layout (location = 5) in mat4 instanceModel;
 
 out vec3 myColor;
 out vec2 texCoord;
 
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 proj;
 
 void main() {
-  gl_Position = proj * view * model * vec4(aPos.x, aPos.y, aPos.z, 1.0);
+  gl_Position = proj * view * instanceModel * vec4(aPos.x, aPos.y, aPos.z, 1.0);
   texCoord = aTexCoord;
 }
\ No newline at end of file
@@ -12,6 +12,7 @@ struct Material {
 };
 uniform Material material;
 
+#define MAX_POINT_LIGHTS 8
 struct DirLight {
 	vec3 direction;
 	
@@ -19,54 +20,56 @@ struct DirLight {
 	vec3 diffuse;
 	vec3 specular;
 };
-uniform DirLight dirLight;
 
 struct PointLight {
 	vec3 position;
-	vec3 direction;
-
-	vec3 ambient;
-	vec3 diffuse;
-	vec3 specular;
-
 	float constant;
+	vec3 ambient;
 	float linear;
+	vec3 diffuse;
 	float quadratic;
+	vec3 specular;
 };
-#define NUMBER_POINT_LIGHTS 2
-uniform PointLight pointLights[NUMBER_POINT_LIGHTS];
 
-uniform vec3 viewPos;
+// Shared by every program, written once per frame by FrameUniforms
+layout (std140) uniform FrameData {
+	mat4 view;
+	mat4 proj;
+	vec3 viewPos;
+	int numPointLights;
+	DirLight dirLight;
+	PointLight pointLights[MAX_POINT_LIGHTS];
+};
 
-vec3 calcDirectionalLight(DirLight light, vec3 norm, vec3 viewDir){
-	vec3 ambient = light.ambient * vec3(texture(material.diffuse, texCoords));
+vec3 calcDirectionalLight(DirLight light, vec3 norm, vec3 viewDir, vec3 albedo, vec3 specularMap){
+	vec3 ambient = light.ambient * albedo;
 	
 	vec3 lightDir = normalize(-light.direction);
 	float diff = max(dot(norm, lightDir), 0.0);
-	vec3 diffuse = diff * vec3(texture(material.diffuse, texCoords)) * light.diffuse;
+	vec3 diffuse = diff * albedo * light.diffuse;
 	
 	vec3 reflectDir = reflect(-lightDir, norm);
 	float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-	vec3 specular = spec * vec3(texture(material.specular, texCoords)) * light.specular;
+	vec3 specular = spec * specularMap * light.specular;
 		
 	return ambient + diffuse + specular;
 }
 
-vec3 calcPointLight(PointLight light, vec3 norm, vec3 fragPos, vec3 viewDir){
+vec3 calcPointLight(PointLight light, vec3 norm, vec3 fragPos, vec3 viewDir, vec3 albedo, vec3 specularMap){
 	float distance = length(light.position - fragPos);
 	float attenuation = 1.0 / (light.constant + 
 						light.linear * distance + 
 						light.quadratic * (distance * distance));
 
-	vec3 ambient = light.ambient * vec3(texture(material.diffuse, texCoords));
+	vec3 ambient = light.ambient * albedo;
 	
 	vec3 lightDir = normalize(light.position - fragPos);
 	float diff = max(dot(norm, lightDir), 0.0);
-	vec3 diffuse = diff * vec3(texture(material.diffuse, texCoords)) * light.diffuse;
+	vec3 diffuse = diff * albedo * light.diffuse;
 	
 	vec3 reflectDir = reflect(-lightDir, norm);
 	float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-	vec3 specular = spec * vec3(texture(material.specular, texCoords)) * light.specular;
+	vec3 specular = spec * specularMap * light.specular;
 	
 	return (ambient + diffuse + specular) * attenuation;
 }
@@ -74,11 +77,14 @@ vec3 calcPointLight(PointLight light, vec3 norm, vec3 fragPos, vec3 viewDir){
 void main(){
 	vec3 norm = normalize(normal);
 	vec3 viewDir = normalize(viewPos - fragPos);
+	// Sampled once, not once per light
+	vec3 albedo = vec3(texture(material.diffuse, texCoords));
+	vec3 specularMap = vec3(texture(material.specular, texCoords));
 
-	vec3 color = calcDirectionalLight(dirLight, norm, viewDir);
+	vec3 color = calcDirectionalLight(dirLight, norm, viewDir, albedo, specularMap);
 
-	for (int i = 0; i < NUMBER_POINT_LIGHTS; ++i)
-		color += calcPointLight(pointLights[i], norm, fragPos, viewDir);
+	for (int i = 0; i < numPointLights; ++i)
+		color += calcPointLight(pointLights[i], norm, fragPos, viewDir, albedo, specularMap);
 
 	fragColor = vec4(color, 1.0);
 }
\ No newline at end of file
@@ -9,6 +9,8 @@
 #include <cstdint>
 #include "shader.h"
 #include "camera.h"
+#include "frame_uniforms.h"
+#include "instance_renderer.h"
 
 #include <stb_image.h>
 
@@ -198,7 +200,8 @@ uint32_t createTexture(const char* path) {
 }
 
 
-void render(uint32_t VAO, const Shader& shader_cube, const uint32_t tex_dif, const uint32_t tex_spec) {
+void render(uint32_t VAO, const Shader& shader_cube, FrameUniforms& frameUniforms, InstanceRenderer& instances,
+	const uint32_t tex_dif, const uint32_t tex_spec) {
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	//View matix
@@ -206,63 +209,50 @@ void render(uint32_t VAO, const Shader& shader_cube, const uint32_t tex_dif, con
 	//Proj matrix
 	glm::mat4 proj = glm::perspective(glm::radians(camera.getFOV()), (float)screen_width / screen_height, 0.1f, 60.0f);
 
-	//Cube shader
-	shader_cube.use();
-	shader_cube.set("view", view);
-	shader_cube.set("proj", proj);
-	
-	shader_cube.set("viewPos", camera.getPosition());
+	// Camera and lights go to the shared uniform buffer, no per program uploads
+	FrameData frame;
+	frame.view = view;
+	frame.proj = proj;
+	frame.viewPos = camera.getPosition();
 
 	/*Multiple Lights*/
 
-	shader_cube.set("dirLight.direction", -0.2f, -1.0f, -0.3f);
-	shader_cube.set("dirLight.ambient", 0.1f, 0.1f, 0.1f);
-	shader_cube.set("dirLight.diffuse", 0.15f, 0.15f, 0.15f);
-	shader_cube.set("dirLight.specular", 0.5f, 0.5f, 0.5f);
-	
-	shader_cube.set("pointLights[0].position", pointLightPositions[0]);
-	shader_cube.set("pointLights[0].ambient", 0.1f, 0.1f, 0.1f);
-	shader_cube.set("pointLights[0].diffuse", 0.5f, 0.5f, 0.5f);
-	shader_cube.set("pointLights[0].specular", 1.0f, 1.0f, 1.0f);
-	shader_cube.set("pointLights[0].constant", 1.0f);
-	shader_cube.set("pointLights[0].linear", 0.009f);
-	shader_cube.set("pointLights[0].quadratic", 0.032f);
-
-	shader_cube.set("pointLights[1].position", pointLightPositions[1]);
-	shader_cube.set("pointLights[1].ambient", 0.1f, 0.1f, 0.1f);
-	shader_cube.set("pointLights[1].diffuse", 0.5f, 0.5f, 0.5f);
-	shader_cube.set("pointLights[1].specular", 1.0f, 1.0f, 1.0f);
-	shader_cube.set("pointLights[1].constant", 1.0f);
-	shader_cube.set("pointLights[1].linear", 0.009f);
-	shader_cube.set("pointLights[1].quadratic", 0.032f);
+	frame.dirLight.direction = glm::vec3(-0.2f, -1.0f, -0.3f);
+	frame.dirLight.ambient = glm::vec3(0.1f, 0.1f, 0.1f);
+	frame.dirLight.diffuse = glm::vec3(0.15f, 0.15f, 0.15f);
+	frame.dirLight.specular = glm::vec3(0.5f, 0.5f, 0.5f);
+
+	frame.numPointLights = 2;
+	for (int32_t i = 0; i < frame.numPointLights; i++) {
+		PointLightData& light = frame.pointLights[i];
+		light.position = pointLightPositions[i];
+		light.ambient = glm::vec3(0.1f, 0.1f, 0.1f);
+		light.diffuse = glm::vec3(0.5f, 0.5f, 0.5f);
+		light.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+		light.constant = 1.0f;
+		light.linear = 0.009f;
+		light.quadratic = 0.032f;
+	}
+	frameUniforms.update(frame);
 
+	//Cube shader
+	shader_cube.use();
 	shader_cube.set("material.diffuse", 0);
 	shader_cube.set("material.specular", 0.393548f, 0.271906f, 0.166721f);
 	shader_cube.set("material.shininess", 32.0f);
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, tex_dif);
-
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, tex_spec);
-
-	glBindVertexArray(VAO);
-
+	// All ten cubes in one instanced draw, their matrices go to the instance buffer
+	const uint32_t textures[] = { tex_dif, tex_spec };
+	instances.begin();
 	for (uint8_t i = 0; i < 10; i++) {
 		glm::mat4 model = glm::mat4(1.0f);
 		model = glm::translate(model, cubePositions[i]);
 		float angle = 10.0f + (20.0f * i);
 		
 		model = glm::rotate(model, (float)glfwGetTime() * glm::radians(angle), glm::vec3(0.5f, 1.0f, 0.0f));
-		shader_cube.set("model", model);
-		
-		glm::mat3 normalMat = glm::inverse(glm::transpose(glm::mat3(model)));
-		shader_cube.set("normalMat", normalMat);
-
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);	//6*2*3
+		instances.add(VAO, 36, textures, 2, model);	//6*2*3
 	}
-
-	glBindVertexArray(0);
+	instances.flush(shader_cube);
 }
 
 int main(int args, char* argv[]) {
@@ -293,42 +283,57 @@ int main(int args, char* argv[]) {
 	glfwSetCursorPosCallback(window, onMouse);
 	glfwSetScrollCallback(window, onScroll);
 
-	//Shaders path
-	Shader shader_cube("../tests/AG08_05/cube.vs", "../tests/AG08_05/cube.fs");
-	uint32_t VBO, EBO;
-	uint32_t VAO = createVertexData(&VBO, &EBO);	//Create Vertex Array Object that compiles everything
-
-	uint32_t tex_dif = createTexture("../tests/AG08_05/albedo.png");
-	uint32_t tex_spec = createTexture("../tests/AG08_05/specular.png");
-
-	//Avoid to load the image reversed
-	stbi_set_flip_vertically_on_load(true);
-
-	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);	//Clear befor entering main loop
-
-	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-	glEnable(GL_CULL_FACE);
-	glCullFace(GL_BACK);
-
-	glEnable(GL_DEPTH_TEST);
-	glDepthFunc(GL_LESS);
-
-	while (!glfwWindowShouldClose(window)) {	//Loop until user closes window
-		float currentFrame = glfwGetTime();
-		float deltaTime = currentFrame - lastFrame;
-		lastFrame = currentFrame;
-
-		handlerInput(window, deltaTime);	//Handle Input
-		render(VAO, shader_cube, tex_dif, tex_spec);//Paint
-		glfwSwapBuffers(window);	//Swap front and back buffers
-		glfwPollEvents();	//Poll for and process events
+	{
+		//Shaders path
+		Shader shader_cube("../tests/AG08_05/cube.vs", "../tests/AG08_05/cube.fs");
+		FrameUniforms frameUniforms;
+		InstanceRenderer instances;
+		uint32_t VBO, EBO;
+		uint32_t VAO = createVertexData(&VBO, &EBO);	//Create Vertex Array Object that compiles everything
+
+		uint32_t tex_dif = createTexture("../tests/AG08_05/albedo.png");
+		uint32_t tex_spec = createTexture("../tests/AG08_05/specular.png");
+
+		//Avoid to load the image reversed
+		stbi_set_flip_vertically_on_load(true);
+
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);	//Clear befor entering main loop
+
+		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		glEnable(GL_CULL_FACE);
+		glCullFace(GL_BACK);
+
+		glEnable(GL_DEPTH_TEST);
+		glDepthFunc(GL_LESS);
+
+		float lastStats = 0.0f;
+		while (!glfwWindowShouldClose(window)) {	//Loop until user closes window
+			float currentFrame = glfwGetTime();
+			float deltaTime = currentFrame - lastFrame;
+			lastFrame = currentFrame;
+
+			handlerInput(window, deltaTime);	//Handle Input
+			Shader::resetStats();
+			render(VAO, shader_cube, frameUniforms, instances, tex_dif, tex_spec);//Paint
+			if (currentFrame - lastStats > 2.0f) {
+				const InstanceStats& drawn = instances.stats();
+				std::cout << "Instances " << drawn.instances << ", Draw Calls " << drawn.drawCalls << std::endl;
+				// Not measured: uncached, each set was assumed to be a location lookup and an upload
+				const UniformStats& uniforms = Shader::stats();
+				std::cout << "Uniform Sets " << uniforms.sets << ", Uploads " << uniforms.uploads <<
+					" (Uncached Estimate " << uniforms.sets * 2 << " GL Calls)" << std::endl;
+				lastStats = currentFrame;
+			}
+			glfwSwapBuffers(window);	//Swap front and back buffers
+			glfwPollEvents();	//Poll for and process events
+		}
+
+		//Clean everything
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteBuffers(1, &VBO);
+		glDeleteBuffers(1, &EBO);
 	}
 
-	//Clean everything
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
-	glDeleteBuffers(1, &EBO);
-
 	glfwTerminate();	//Close
 	return 0;	//Ends OK
 }
\ No newline at end of file
@@ -0,0 +1,114 @@
+#version 330 core
+out vec4 fragColor;
+
+in vec3 normal;
+in vec3 fragPos;
+in vec2 texCoords;
+
+struct Material {
+	sampler2D diffuse;
+	sampler2D specular;
+	float shininess;
+};
+uniform Material material;
+
+#define MAX_POINT_LIGHTS 8
+struct DirLight {
+	vec3 direction;
+	
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+};
+
+struct PointLight {
+	vec3 position;
+	float constant;
+	vec3 ambient;
+	float linear;
+	vec3 diffuse;
+	float quadratic;
+	vec3 specular;
+};
+
+// Shared by every program, written once per frame by FrameUniforms
+layout (std140) uniform FrameData {
+	mat4 view;
+	mat4 proj;
+	vec3 viewPos;
+	int numPointLights;
+	DirLight dirLight;
+	PointLight pointLights[MAX_POINT_LIGHTS];
+};
+
+// Written by ClusteredLights, 4 texels per light
+uniform samplerBuffer clusterLights;
+uniform usamplerBuffer clusterRanges;
+uniform usamplerBuffer clusterIndices;
+uniform vec3 clusterGrid;
+uniform vec2 clusterTileScale;
+uniform vec2 clusterDepthScale;
+
+vec3 calcDirectionalLight(DirLight light, vec3 norm, vec3 viewDir, vec3 albedo, vec3 specularMap){
+	vec3 ambient = light.ambient * albedo;
+	
+	vec3 lightDir = normalize(-light.direction);
+	float diff = max(dot(norm, lightDir), 0.0);
+	vec3 diffuse = diff * albedo * light.diffuse;
+	
+	vec3 reflectDir = reflect(-lightDir, norm);
+	float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+	vec3 specular = spec * specularMap * light.specular;
+		
+	return ambient + diffuse + specular;
+}
+
+vec3 calcPointLight(int index, vec3 norm, vec3 fragPos, vec3 viewDir, vec3 albedo, vec3 specularMap){
+	vec4 positionConstant = texelFetch(clusterLights, index * 4);
+	vec4 ambientLinear = texelFetch(clusterLights, index * 4 + 1);
+	vec4 diffuseQuadratic = texelFetch(clusterLights, index * 4 + 2);
+	vec4 specularRadius = texelFetch(clusterLights, index * 4 + 3);
+
+	float distance = length(positionConstant.xyz - fragPos);
+	// The cluster's box is bigger than the light's sphere
+	if (distance > specularRadius.w)
+		return vec3(0.0);
+	float attenuation = 1.0 / (positionConstant.w + 
+						ambientLinear.w * distance + 
+						diffuseQuadratic.w * (distance * distance));
+
+	vec3 ambient = ambientLinear.rgb * albedo;
+	
+	vec3 lightDir = normalize(positionConstant.xyz - fragPos);
+	float diff = max(dot(norm, lightDir), 0.0);
+	vec3 diffuse = diff * albedo * diffuseQuadratic.rgb;
+	
+	vec3 reflectDir = reflect(-lightDir, norm);
+	float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+	vec3 specular = spec * specularMap * specularRadius.rgb;
+	
+	return (ambient + diffuse + specular) * attenuation;
+}
+
+void main(){
+	vec3 norm = normalize(normal);
+	vec3 viewDir = normalize(viewPos - fragPos);
+	// Sampled once, not once per light
+	vec3 albedo = vec3(texture(material.diffuse, texCoords));
+	vec3 specularMap = vec3(texture(material.specular, texCoords));
+
+	vec3 color = calcDirectionalLight(dirLight, norm, viewDir, albedo, specularMap);
+
+	// Tile from the pixel, slice from the logarithm of the view depth
+	float depth = -(view * vec4(fragPos, 1.0)).z;
+	vec3 cluster = vec3(gl_FragCoord.xy * clusterTileScale, log(depth) * clusterDepthScale.x - clusterDepthScale.y);
+	ivec3 grid = ivec3(clusterGrid);
+	ivec3 id = clamp(ivec3(cluster), ivec3(0), grid - 1);
+	uvec2 range = texelFetch(clusterRanges, id.x + grid.x * (id.y + grid.y * id.z)).xy;
+
+	for (uint i = 0u; i < range.y; ++i)
+		color += calcPointLight(int(texelFetch(clusterIndices, int(range.x + i)).r), norm, fragPos, viewDir,
+			albedo, specularMap);
+
+	fragColor = vec4(color, 1.0);
+}
\ No newline at end of file
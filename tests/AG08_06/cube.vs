@@ -0,0 +1,46 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec3 aNormal;
+// Model matrix of the instance, streamed by InstanceRenderer
+layout (location = 5) in mat4 instanceModel;
+
+#define MAX_POINT_LIGHTS 8
+struct DirLight {
+	vec3 direction;
+	
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+};
+
+struct PointLight {
+	vec3 position;
+	float constant;
+	vec3 ambient;
+	float linear;
+	vec3 diffuse;
+	float quadratic;
+	vec3 specular;
+};
+
+// Shared by every program, written once per frame by FrameUniforms
+layout (std140) uniform FrameData {
+	mat4 view;
+	mat4 proj;
+	vec3 viewPos;
+	int numPointLights;
+	DirLight dirLight;
+	PointLight pointLights[MAX_POINT_LIGHTS];
+};
+
+out vec3 normal;
+out vec3 fragPos;
+out vec2 texCoords;
+
+void main() {
+	normal = transpose(inverse(mat3(instanceModel))) * aNormal;
+	fragPos = vec3(instanceModel * vec4(aPos, 1.0));
+	texCoords = aTexCoord;
+	gl_Position = proj * view * instanceModel * vec4(aPos.x, aPos.y, aPos.z, 1.0); 
+}
\ No newline at end of file
@@ -9,7 +9,9 @@
 #include <cstdint>
 #include "shader.h"
 #include "camera.h"
+#include "render_queue.h"
 #include "model.h"
+#include "upload_service.h"
 
 #include <stb_image.h>
 
@@ -23,6 +25,7 @@ float lastX = (float)screen_width / 2.0f;
 float lastY = (float)screen_height / 2.0f;
 
 Camera camera(glm::vec3(-1.0f, 1.5f, 3.0f));
+RenderQueue renderQueue;
 
 void onChangeframeBufferSize(GLFWwindow* window, const int32_t width,
 	const int32_t height) {
@@ -69,7 +72,7 @@ void onMouse(GLFWwindow* window, double xpos, double ypos) {
 }
 
 
-void render(const Shader& shader, const Model& object) {
+void render(const Shader& shader, Model& object) {
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	// View matix
@@ -84,11 +87,14 @@ void render(const Shader& shader, const Model& object) {
 	
 	glm::mat4 model(1.0f); // Identity
 	model = glm::scale(model, glm::vec3(0.1f, 0.1f, 0.1f));
-	shader.set("model", model);
 
-	object.Draw(shader);
-
-	glBindVertexArray(0);
+	// Coarser meshes as the ship moves away
+	object.selectLods(camera, model, static_cast<float>(screen_height));
+	// Meshes outside the view are not submitted
+	object.cull(proj * view, model);
+	renderQueue.begin(view);
+	object.submit(&renderQueue, shader, model);
+	renderQueue.flush();
 }
 
 int main(int args, char* argv[]) {
@@ -119,35 +125,85 @@ int main(int args, char* argv[]) {
 	glfwSetCursorPosCallback(window, onMouse);
 	glfwSetScrollCallback(window, onScroll);
 
-	// Shaders path
-	Shader shader("../tests/AG09/shader.vs", "../tests/AG09/shader.fs");
+	// The upload context and everything streamed through it go before glfwTerminate
+	{
+		// Shaders path
+		Shader shader("../tests/AG09/shader.vs", "../tests/AG09/shader.fs");
 	
-	// Load model
-	Model object("../assets/Freighter/Freigther_BI_Export.obj");
-
-	// Clear befor entering main loop
-	glClearColor(0.0f, 0.0f, 0.0f, 1.0f); 
-
-	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-	glEnable(GL_CULL_FACE);
-	glCullFace(GL_BACK);
-
-	glEnable(GL_DEPTH_TEST);
-	glDepthFunc(GL_LESS);
-
-	// Loop until user closes window
-	while (!glfwWindowShouldClose(window)) {	
-		float currentFrame = glfwGetTime();
-		float deltaTime = currentFrame - lastFrame;
-		lastFrame = currentFrame;
-
-		handlerInput(window, deltaTime); // Handle keyboard
+		// GPU data of the model streams in from a second context while we render
+		UploadService uploads(window);
+
+		// Load model, a warm start reads the processed meshes from the cache
+		ModelOptions options;
+		options.uploads = &uploads;
+		options.merge = true; // Whole ship in one VAO
+		options.pack = true; // Quantized vertices, decoded in shader.vs
+		options.releaseCpuData = true; // Only the GPU needs the vertices
+		options.lods = true; // Simplified meshes for distant views
+		double loadStart = glfwGetTime();
+		Model object("../assets/Freighter/Freigther_BI_Export.obj", options);
+		std::cout << "Model Loaded In " << (glfwGetTime() - loadStart) * 1000.0 << " ms" << std::endl;
+		const ModelLoadStats& load = object.loadStats();
+		if (load.fromCache) {
+			std::cout << "Meshes Read From Cache" << std::endl;
+		} else {
+			std::cout << "Vertex Cache ACMR " << load.before.acmr() << " -> " << load.after.acmr() <<
+				", ATVR " << load.before.atvr() << " -> " << load.after.atvr() << std::endl;
+			std::cout << "Mesh LOD Triangles";
+			for (uint32_t count : load.lodTriangles) std::cout << " " << count;
+			std::cout << std::endl;
+		}
+
+		// Cold imports and processes the file, warm reads the cache the load above left. Both upload
+		// right away and share the textures the streamed model holds, so only the meshes differ
+		ModelOptions direct = options;
+		direct.uploads = nullptr;
+		direct.useCache = false;
+		double coldStart = glfwGetTime();
+		{ Model cold("../assets/Freighter/Freigther_BI_Export.obj", direct); }
+		const double coldMs = (glfwGetTime() - coldStart) * 1000.0;
+		direct.useCache = true;
+		double warmStart = glfwGetTime();
+		bool warmFromCache = false;
+		{
+			Model warm("../assets/Freighter/Freigther_BI_Export.obj", direct);
+			warmFromCache = warm.loadStats().fromCache;
+		}
+		const double warmMs = (glfwGetTime() - warmStart) * 1000.0;
+		std::cout << "Cold Load " << coldMs << " ms, Warm Load " << warmMs << " ms (" << coldMs / warmMs << "x)" <<
+			(warmFromCache ? "" : ", Cache Missing") << std::endl;
+
+		// Clear befor entering main loop
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f); 
+
+		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		glEnable(GL_CULL_FACE);
+		glCullFace(GL_BACK);
+
+		glEnable(GL_DEPTH_TEST);
+		glDepthFunc(GL_LESS);
+
+		// Loop until user closes window
+		float lastStats = 0.0f;
+		while (!glfwWindowShouldClose(window)) {	
+			float currentFrame = glfwGetTime();
+			float deltaTime = currentFrame - lastFrame;
+			lastFrame = currentFrame;
+
+			handlerInput(window, deltaTime); // Handle keyboard
+
+			uploads.update(2.0); // Finish at most 2 ms of uploads per frame
 		
-		render(shader, object); // Paint
+			render(shader, object); // Paint
+			if (currentFrame - lastStats > 2.0f) { // State changes unsorted -> sorted
+				renderQueue.printStats();
+				lastStats = currentFrame;
+			}
 		
-		glfwSwapBuffers(window); // Swap front and back buffers
+			glfwSwapBuffers(window); // Swap front and back buffers
 		
-		glfwPollEvents(); // Poll for and process events
+			glfwPollEvents(); // Poll for and process events
+		}
 	}
 
 	glfwTerminate(); // Close
@@ -1,7 +1,7 @@
 #version 330 core
-// Same order as in mesh.h
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+// Same order as in mesh.h, packed layout of PackedVertex
+layout (location = 0) in vec4 aPos;
+layout (location = 1) in vec2 aNormal;
 layout (location = 2) in vec2 aTexCoord;
 
 out vec2 TexCoords;
@@ -10,7 +10,12 @@ uniform mat4 model;
 uniform mat4 view;
 uniform mat4 proj;
 
+// Quantization box of the mesh being drawn
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+
 void main() {
   TexCoords = aTexCoord;
-  gl_Position = proj * view * model * vec4(aPos.x, aPos.y, aPos.z, 1.0); 
-}
\ No newline at end of file
+  vec3 position = positionOffset + positionScale * aPos.xyz;
+  gl_Position = proj * view * model * vec4(position, 1.0); 
+}
@@ -0,0 +1,105 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <cstdint>
+#include "model.h"
+
+// Imports the Freighter with ASSIMP and with the native ObjLoader, compares
+// the meshes both paths build and how long they take.
+
+const char* k_ModelPath = "../assets/Freighter/Freigther_BI_Export.obj";
+const uint32_t k_Runs = 5;
+
+// Average load time in ms over k_Runs after an untimed load, the last model is kept for the
+// comparison. Each model lives until the next is loaded, so its textures stay in the registry
+// and only the geometry import is timed
+double benchmark(const bool nativeObj, Model** result) {
+	ModelOptions options;
+	options.useCache = false;	// Time the import itself
+	options.optimize = false;	// Keep the meshes as imported
+	options.nativeObj = nativeObj;
+
+	*result = new Model(k_ModelPath, options);	// Decodes the textures
+	double total = 0.0;
+	for (uint32_t i = 0; i < k_Runs; i++) {
+		const double start = glfwGetTime();
+		Model* model = new Model(k_ModelPath, options);
+		total += glfwGetTime() - start;
+		delete *result;
+		*result = model;
+	}
+	return total * 1000.0 / k_Runs;
+}
+
+// Largest difference between the vertices of both models, -1 if the meshes do not match
+float compare(const Model& a, const Model& b) {
+	if (a.meshes_.size() != b.meshes_.size()) return -1.0f;
+
+	float maxDifference = 0.0f;
+	for (size_t i = 0; i < a.meshes_.size(); i++) {
+		const Mesh& meshA = a.meshes_[i];
+		const Mesh& meshB = b.meshes_[i];
+		if (meshA.vertices_.size() != meshB.vertices_.size() || meshA.indices_ != meshB.indices_) return -1.0f;
+
+		for (size_t j = 0; j < meshA.vertices_.size(); j++) {
+			const Vertex& vA = meshA.vertices_[j];
+			const Vertex& vB = meshB.vertices_[j];
+			maxDifference = std::max(maxDifference, glm::length(vA.Position - vB.Position));
+			maxDifference = std::max(maxDifference, glm::length(vA.Normal - vB.Normal));
+			maxDifference = std::max(maxDifference, glm::length(vA.TexCoords - vB.TexCoords));
+			maxDifference = std::max(maxDifference, glm::length(vA.Tangent - vB.Tangent));
+			maxDifference = std::max(maxDifference, glm::length(vA.Bitangent - vB.Bitangent));
+		}
+	}
+	return maxDifference;
+}
+
+int main(int args, char* argv[]) {
+	if (!glfwInit()) {	// Initialize GLFW
+		std::cout << "Failed To Initialize GLFW" << std::endl;
+		return -1;
+	}
+
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);	// Use OpenGL 3.3
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);	// Core Profile
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);	// Only needed for the uploads
+
+	GLFWwindow* window = glfwCreateWindow(64, 64, "AG09_01", NULL, NULL);
+	if (!window) {
+		std::cout << "Failed To Create GLFW Window" << std::endl;
+		glfwTerminate();
+		return -1;
+	}
+
+	glfwMakeContextCurrent(window);	// Make the window's context current
+
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) { 	// Init GLAD
+		std::cout << "Failed To Initialize GLAD" << std::endl;
+		return -1;
+	}
+
+	Model* assimp = nullptr;
+	Model* native = nullptr;
+	const double assimpMs = benchmark(false, &assimp);
+	const double nativeMs = benchmark(true, &native);
+
+	std::cout << "ASSIMP Import " << assimpMs << " ms" << std::endl;
+	std::cout << "ObjLoader Import " << nativeMs << " ms (" << assimpMs / nativeMs << "x)" << std::endl;
+
+	const float difference = compare(*assimp, *native);
+	if (difference < 0.0f) {
+		std::cout << "Meshes Differ In Layout" << std::endl;
+	} else {
+		std::cout << "Largest Vertex Difference " << difference << std::endl;
+	}
+
+	delete assimp;
+	delete native;
+
+	glfwTerminate(); // Close
+	return 0; //Ends OK
+}
@@ -0,0 +1,22 @@
+#version 330 core
+// Same order as in mesh.h, packed layout of PackedVertex
+layout (location = 0) in vec4 aPos;
+layout (location = 1) in vec2 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+// Model matrix of the instance, streamed by InstanceRenderer
+layout (location = 5) in mat4 instanceModel;
+
+out vec2 TexCoords;
+
+uniform mat4 view;
+uniform mat4 proj;
+
+// Quantization box of the mesh being drawn
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+
+void main() {
+  TexCoords = aTexCoord;
+  vec3 position = positionOffset + positionScale * aPos.xyz;
+  gl_Position = proj * view * instanceModel * vec4(position, 1.0); 
+}
@@ -0,0 +1,161 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <iostream>
+#include <cstdint>
+#include <vector>
+#include "instance_renderer.h"
+#include "model.h"
+#include "shader.h"
+
+// Draws growing grids of Freighters from one loaded Model, once with a draw per
+// object and mesh and once instanced, and compares draw calls and frame times.
+// Both paths pick each ship's LODs by its distance, instanced draw calls stay at
+// one per mesh and LOD in use whatever the number of ships.
+
+const char* k_ModelPath = "../assets/Freighter/Freigther_BI_Export.obj";
+const uint32_t k_Counts[] = { 1, 16, 256, 1024 };
+const uint32_t k_WarmupFrames = 5;
+const uint32_t k_Frames = 30;
+const uint32_t k_Width = 800;
+const uint32_t k_Height = 600;
+const float k_Fov = 45.0f;
+
+struct Result {
+	uint32_t drawCalls;
+	double ms;	// Per frame, until the GPU is done
+};
+
+// Ships on a square grid facing random ways, spread so they do not overlap
+std::vector<glm::mat4> gridTransforms(const uint32_t count) {
+	std::vector<glm::mat4> transforms;
+	const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(count))));
+	for (uint32_t i = 0; i < count; i++) {
+		glm::mat4 model(1.0f);
+		model = glm::translate(model, glm::vec3((i % side) * 2.0f - side, 0.0f, -2.0f * (i / side)));
+		model = glm::rotate(model, i * 2.4f, glm::vec3(0.0f, 1.0f, 0.0f));
+		model = glm::scale(model, glm::vec3(0.1f, 0.1f, 0.1f));
+		transforms.push_back(model);
+	}
+	return transforms;
+}
+
+// Above and behind the grid, far enough to see all of it
+glm::vec3 eyePosition(const uint32_t count) {
+	const float side = std::ceil(std::sqrt(static_cast<float>(count)));
+	return glm::vec3(0.0f, side + 2.0f, side + 4.0f);
+}
+
+// Sets the matrices and returns the view the LODs are picked for
+LodView setCamera(const Shader& shader, const uint32_t count) {
+	const float side = std::ceil(std::sqrt(static_cast<float>(count)));
+	const glm::mat4 view = glm::lookAt(eyePosition(count), glm::vec3(0.0f, 0.0f, -side), glm::vec3(0.0f, 1.0f, 0.0f));
+	const glm::mat4 proj = glm::perspective(glm::radians(k_Fov), (float)k_Width / k_Height, 0.1f, 500.0f);
+	shader.use();
+	shader.set("view", view);
+	shader.set("proj", proj);
+	return LodView(eyePosition(count), k_Fov, static_cast<float>(k_Height));
+}
+
+// A model uniform per node and a full Model::Draw per ship, with the LODs picked for it
+Result drawPerObject(const Shader& shader, Model* object, const std::vector<glm::mat4>& transforms) {
+	const LodView lods = setCamera(shader, static_cast<uint32_t>(transforms.size()));
+	double start = 0.0;
+	for (uint32_t frame = 0; frame < k_WarmupFrames + k_Frames; frame++) {
+		if (frame == k_WarmupFrames) {
+			glFinish();
+			start = glfwGetTime();
+		}
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		for (const glm::mat4& model : transforms) {
+			object->selectLods(lods, model);
+			object->Draw(shader, model);
+		}
+	}
+	glFinish();
+	const uint32_t drawCalls = static_cast<uint32_t>(transforms.size() * object->meshes_.size());
+	return Result{ drawCalls, (glfwGetTime() - start) * 1000.0 / k_Frames };
+}
+
+// Every ship as an instance of the same Model
+Result drawInstanced(const Shader& shader, const Model& object, const std::vector<glm::mat4>& transforms,
+	InstanceRenderer* instances) {
+	const LodView lods = setCamera(shader, static_cast<uint32_t>(transforms.size()));
+	double start = 0.0;
+	for (uint32_t frame = 0; frame < k_WarmupFrames + k_Frames; frame++) {
+		if (frame == k_WarmupFrames) {
+			glFinish();
+			start = glfwGetTime();
+		}
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		instances->begin();
+		for (const glm::mat4& model : transforms) instances->add(object, model);
+		instances->flush(shader, &lods);
+	}
+	glFinish();
+	return Result{ instances->stats().drawCalls, (glfwGetTime() - start) * 1000.0 / k_Frames };
+}
+
+int main(int args, char* argv[]) {
+	if (!glfwInit()) {	// Initialize GLFW
+		std::cout << "Failed To Initialize GLFW" << std::endl;
+		return -1;
+	}
+
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);	// Use OpenGL 3.3
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);	// Core Profile
+
+	GLFWwindow* window = glfwCreateWindow(k_Width, k_Height, "AG09_02", NULL, NULL);
+	if (!window) {
+		std::cout << "Failed To Create GLFW Window" << std::endl;
+		glfwTerminate();
+		return -1;
+	}
+
+	glfwMakeContextCurrent(window);	// Make the window's context current
+	glfwSwapInterval(0);	// Time the draws, not the display
+
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) { 	// Init GLAD
+		std::cout << "Failed To Initialize GLAD" << std::endl;
+		return -1;
+	}
+
+	{
+		// Same data for both paths, only the vertex shaders differ in where the model matrix comes from
+		Shader perObject("../tests/AG09/shader.vs", "../tests/AG09/shader.fs");
+		Shader instanced("../tests/AG09_02/instanced.vs", "../tests/AG09/shader.fs");
+
+		ModelOptions options;
+		options.pack = true;	// Decoded in both vertex shaders
+		options.releaseCpuData = true;
+		options.lods = true;	// Distant ships draw simplified meshes
+		Model object(k_ModelPath, options);
+		InstanceRenderer instances;
+		std::cout << "Meshes " << object.meshes_.size() << std::endl;
+
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		glEnable(GL_CULL_FACE);
+		glCullFace(GL_BACK);
+		glEnable(GL_DEPTH_TEST);
+		glDepthFunc(GL_LESS);
+
+		for (const uint32_t count : k_Counts) {
+			const std::vector<glm::mat4> transforms = gridTransforms(count);
+			const Result single = drawPerObject(perObject, &object, transforms);
+			const Result batched = drawInstanced(instanced, object, transforms, &instances);
+			std::cout << "Ships " << count <<
+				", Per Object " << single.drawCalls << " draws " << single.ms << " ms" <<
+				", Instanced " << batched.drawCalls << " draws " << batched.ms << " ms (" <<
+				single.ms / batched.ms << "x)" << std::endl;
+			glfwPollEvents();
+		}
+	}
+
+	glfwTerminate(); // Close
+	return 0; //Ends OK
+}
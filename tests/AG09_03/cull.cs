@@ -0,0 +1,81 @@
+#version 430 core
+// Frustum culling of every mesh of every instance, see IndirectRenderer
+layout (local_size_x = 64) in;
+
+struct CullMesh {
+	vec4 boundingSphere;	// Center and radius before the node and instance transforms
+	uint firstLod;	// Of its ranges in lods
+	uint numLods;
+	int baseVertex;
+	uint firstTransform;	// Instances of the mesh's node, times its world transform
+};
+
+struct CullLod {
+	uint firstIndex;
+	uint count;
+	float error;	// In model units, 0 for the full mesh
+	uint padding;
+};
+
+struct DrawCommand {
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	int baseVertex;
+	uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer Transforms {
+	mat4 transforms[];
+};
+layout (std430, binding = 1) readonly buffer Meshes {
+	CullMesh meshes[];
+};
+layout (std430, binding = 2) writeonly buffer Commands {
+	DrawCommand commands[];
+};
+layout (std430, binding = 3) readonly buffer Lods {
+	CullLod lods[];
+};
+
+// Inward facing, normalized
+uniform vec4 planes[6];
+uniform int numInstances;
+uniform int numMeshes;
+uniform vec3 viewPosition;
+// Pixels one unit covers at distance one over the allowed pixel error, 0 keeps LOD 0
+uniform float lodScale;
+
+void main() {
+	uint pair = gl_GlobalInvocationID.x;
+	if (pair >= uint(numInstances * numMeshes)) return;
+
+	// Commands are grouped by mesh, each group is one multi draw
+	uint instance = pair % uint(numInstances);
+	CullMesh mesh = meshes[pair / uint(numInstances)];
+	uint transform = mesh.firstTransform + instance;
+	mat4 model = transforms[transform];
+
+	vec3 center = vec3(model * vec4(mesh.boundingSphere.xyz, 1.0));
+	float scale = max(max(length(model[0].xyz), length(model[1].xyz)), length(model[2].xyz));
+	float radius = mesh.boundingSphere.w * scale;
+
+	bool visible = true;
+	for (int i = 0; i < 6; ++i)
+		visible = visible && dot(planes[i].xyz, center) + planes[i].w >= -radius;
+
+	// Coarsest LOD whose error stays within the pixel budget, inside the sphere the full mesh
+	uint lod = 0u;
+	float distance = length(center - viewPosition) - radius;
+	if (lodScale > 0.0 && distance > 0.0) {
+		while (lod + 1u < mesh.numLods && lods[mesh.firstLod + lod + 1u].error * scale * lodScale <= distance)
+			lod++;
+	}
+	CullLod range = lods[mesh.firstLod + lod];
+
+	commands[pair].count = range.count;
+	commands[pair].instanceCount = visible ? 1u : 0u;
+	commands[pair].firstIndex = range.firstIndex;
+	commands[pair].baseVertex = mesh.baseVertex;
+	commands[pair].baseInstance = transform;
+}
@@ -0,0 +1,218 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <iostream>
+#include <cstdint>
+#include <vector>
+#include "shader.h"
+#include "camera.h"
+#include "indirect_renderer.h"
+#include "instance_renderer.h"
+#include "model.h"
+
+#include <stb_image.h>
+
+uint32_t screen_width = 800;
+uint32_t screen_height = 600;
+
+float lastFrame = 0.0f;
+
+bool firstMouse = true;
+float lastX = (float)screen_width / 2.0f;
+float lastY = (float)screen_height / 2.0f;
+
+Camera camera(glm::vec3(0.0f, 4.0f, 10.0f));
+
+// Ships per side of the grid
+const uint32_t k_GridSide = 64;
+
+void onChangeframeBufferSize(GLFWwindow* window, const int32_t width,
+	const int32_t height) {
+	screen_width = width;
+	screen_height = height;
+	glViewport(0, 0, width, height);
+}
+
+void handlerInput(GLFWwindow* window, const float dt) {
+	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+		glfwSetWindowShouldClose(window, true);
+	}
+	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
+		camera.handleKeyboard(Camera::Movement::Forward, dt);
+	}
+	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
+		camera.handleKeyboard(Camera::Movement::Backward, dt);
+	}
+	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
+		camera.handleKeyboard(Camera::Movement::Left, dt);
+	}
+	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
+		camera.handleKeyboard(Camera::Movement::Right, dt);
+	}
+}
+
+void onScroll(GLFWwindow* window, double xoffset, double yoffset) {
+	camera.handleMouseScroll(yoffset);
+}
+
+void onMouse(GLFWwindow* window, double xpos, double ypos) {
+	if (firstMouse) {
+		lastX = xpos;
+		lastY = ypos;
+		firstMouse = false;
+	}
+
+	float xoffset = xpos - lastX;
+	float yoffset = lastY - ypos;
+	lastX = xpos;
+	lastY = ypos;
+
+	camera.handleMouseMovement(xoffset, yoffset);
+}
+
+
+// Spread the ships on a grid in front of the camera
+std::vector<glm::mat4> gridTransforms() {
+	std::vector<glm::mat4> transforms;
+	for (uint32_t z = 0; z < k_GridSide; z++) {
+		for (uint32_t x = 0; x < k_GridSide; x++) {
+			glm::mat4 model(1.0f);
+			model = glm::translate(model, glm::vec3((x - k_GridSide * 0.5f) * 3.0f, 0.0f, -3.0f * z));
+			model = glm::rotate(model, (x * k_GridSide + z) * 2.4f, glm::vec3(0.0f, 1.0f, 0.0f));
+			model = glm::scale(model, glm::vec3(0.1f, 0.1f, 0.1f));
+			transforms.push_back(model);
+		}
+	}
+	return transforms;
+}
+
+// Culls and draws on the GPU when it can, otherwise every instance goes through InstanceRenderer
+uint32_t render(const Shader* cull, const Shader& shader, const Model& object, IndirectRenderer* indirect,
+	InstanceRenderer* instances, const std::vector<glm::mat4>& transforms) {
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// View matix
+	glm::mat4 view = camera.getViewMatrix();
+	// Proj matrix
+	glm::mat4 proj = glm::perspective(glm::radians(camera.getFOV()), (float)screen_width / screen_height, 0.1f, 200.0f);
+
+	// Upload matrix to shader
+	shader.use();
+	shader.set("view", view);
+	shader.set("proj", proj);
+
+	// Each ship draws the LOD its distance allows on both paths
+	const LodView lods(camera.getPosition(), camera.getFOV(), static_cast<float>(screen_height));
+	if (indirect) return indirect->draw(*cull, shader, proj * view, &lods);
+
+	instances->begin();
+	for (const glm::mat4& model : transforms) instances->add(object, model);
+	instances->flush(shader, &lods);
+	return instances->stats().drawCalls;
+}
+
+int main(int args, char* argv[]) {
+	if (!glfwInit()) {	// Initialize GLFW
+		std::cout << "Failed To Initialize GLFW" << std::endl;
+		return -1;
+	}
+
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);	// Use OpenGL 4.3, compute and indirect draws
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);	// Core Profile
+
+	GLFWwindow* window = glfwCreateWindow(screen_width, screen_height, "AG09_03", NULL, NULL);
+	if (!window) {
+		// Older drivers still get the classic path
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		window = glfwCreateWindow(screen_width, screen_height, "AG09_03", NULL, NULL);
+	}
+	if (!window) {
+		std::cout << "Failed To Create GLFW Window" << std::endl;
+		glfwTerminate();
+		return -1;
+	}
+
+	glfwMakeContextCurrent(window);	// Make the window's context current
+
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) { 	// Init GLAD
+		std::cout << "Failed To Initialize GLAD" << std::endl;
+		return -1;
+	}
+
+	glfwSetFramebufferSizeCallback(window, onChangeframeBufferSize); // ViewPort Callback
+	glfwSetCursorPosCallback(window, onMouse);
+	glfwSetScrollCallback(window, onScroll);
+
+	{
+		// Shaders path, the matrices come from the instance attribute on both paths
+		Shader shader("../tests/AG09_02/instanced.vs", "../tests/AG09/shader.fs");
+
+		ModelOptions options;
+		options.merge = true; // Indirect draws address the shared buffers
+		options.pack = true; // Quantized vertices, decoded in instanced.vs
+		options.releaseCpuData = true;
+		options.lods = true; // Simplified meshes for the distant ships
+		Model object("../assets/Freighter/Freigther_BI_Export.obj", options);
+		const std::vector<glm::mat4> transforms = gridTransforms();
+		InstanceRenderer instances;
+
+		const bool gpuCulling = IndirectRenderer::isSupported();
+		Shader* cull = nullptr;
+		IndirectRenderer* indirect = nullptr;
+		if (gpuCulling) {
+			cull = new Shader("../tests/AG09_03/cull.cs");
+			indirect = new IndirectRenderer(object);
+			indirect->setInstances(transforms.data(), static_cast<uint32_t>(transforms.size()));
+		}
+		std::cout << (gpuCulling ? "GPU Culling, " : "No GL 4.3, Instanced Fallback, ") <<
+			transforms.size() << " Ships" << std::endl;
+
+		// Clear befor entering main loop
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f); 
+
+		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		glEnable(GL_CULL_FACE);
+		glCullFace(GL_BACK);
+
+		glEnable(GL_DEPTH_TEST);
+		glDepthFunc(GL_LESS);
+
+		// Loop until user closes window
+		float lastStats = 0.0f;
+		uint32_t frames = 0;
+		while (!glfwWindowShouldClose(window)) {	
+			float currentFrame = glfwGetTime();
+			float deltaTime = currentFrame - lastFrame;
+			lastFrame = currentFrame;
+
+			handlerInput(window, deltaTime); // Handle keyboard
+			const uint32_t drawCalls = render(cull, shader, object, indirect, &instances, transforms); // Paint
+			frames++;
+
+			if (currentFrame - lastStats > 2.0f) {
+				std::cout << "Frame " << (currentFrame - lastStats) * 1000.0f / frames << " ms, Draw Calls " << drawCalls;
+				if (indirect) std::cout << ", Visible " << indirect->countVisible() << " / " <<
+					transforms.size() * object.meshes_.size();
+				std::cout << std::endl;
+				lastStats = currentFrame;
+				frames = 0;
+			}
+		
+			glfwSwapBuffers(window); // Swap front and back buffers
+		
+			glfwPollEvents(); // Poll for and process events
+		}
+
+		delete indirect;
+		delete cull;
+	}
+
+	glfwTerminate(); // Close
+	return 0; //Ends OK
+}
@@ -0,0 +1,22 @@
+#version 330 core
+
+in vec2 texCoords;
+
+layout (location = 0) out vec4 accumulation;
+layout (location = 1) out vec4 weights;
+
+uniform sampler2D tex;
+
+void main() {
+	vec4 texColor = texture(tex, texCoords);
+	if (texColor.a <=0.1){ // Do not paint when alpha is low
+		discard;
+	}
+
+	// Nearer and more opaque surfaces weigh more, equation 10 of the paper
+	float weight = clamp(pow(min(1.0, texColor.a * 10.0) + 0.01, 3.0) * 1e8 *
+		pow(1.0 - gl_FragCoord.z * 0.9, 3.0), 1e-2, 3e3);
+
+	accumulation = vec4(texColor.rgb * texColor.a * weight, texColor.a);
+	weights = vec4(texColor.a * weight);
+}
\ No newline at end of file
@@ -9,6 +9,9 @@
 #include <cstdint>
 #include "shader.h"
 #include "camera.h"
+#include "gl_state.h"
+#include "render_queue.h"
+#include "weighted_oit.h"
 
 #include <stb_image.h>
 
@@ -25,6 +28,24 @@ Camera camera(glm::vec3(-1.0f, 2.0f, 6.0f));
 
 glm::vec3 lightPos(1.2f, 1.0f, -2.0f);
 
+// How the tree quads are blended, T switches
+enum class TransparencyMode {
+	Sorted,	// Back to front through the render queue, exact
+	WeightedOit,	// Any order, one composite pass
+};
+TransparencyMode transparencyMode = TransparencyMode::WeightedOit;
+bool switchHeld = false;
+
+const glm::vec3 treePositions[] = {
+	glm::vec3(0.0f, 0.2f, 1.4f),	// IF 1.2f: Z-Fighting (cube and tree same z)
+	glm::vec3(-0.6f, 0.2f, 0.5f),
+	glm::vec3(0.6f, 0.2f, -0.5f),
+	glm::vec3(-0.3f, 0.2f, -1.4f),
+	glm::vec3(0.4f, 0.2f, 2.0f),
+};
+
+RenderQueue renderQueue;
+
 void onChangeframeBufferSize(GLFWwindow* window, const int32_t width,
 	const int32_t height) {
 	screen_width = width;
@@ -48,6 +69,14 @@ void handlerInput(GLFWwindow* window, const float dt) {
 	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
 		camera.handleKeyboard(Camera::Movement::Right, dt);
 	}
+	// Once per press
+	const bool switchPressed = glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS;
+	if (switchPressed && !switchHeld) {
+		transparencyMode = transparencyMode == TransparencyMode::Sorted ?
+			TransparencyMode::WeightedOit : TransparencyMode::Sorted;
+		std::cout << "Transparency " << (transparencyMode == TransparencyMode::Sorted ? "Sorted" : "Weighted OIT") << std::endl;
+	}
+	switchHeld = switchPressed;
 }
 
 void onScroll(GLFWwindow* window, double xoffset, double yoffset) {
@@ -168,8 +197,11 @@ uint32_t createTextureAlpha(const char* path) { // It will be loaded with RGBA (
 }
 
 
-void render(const Shader& lightingShader, Shader& blendShader, const uint32_t cubeVAO, const uint32_t quadVAO, 
-	const uint32_t tex1, const uint32_t tex2, const uint32_t tex3) {
+void render(const Shader& lightingShader, const Shader& blendShader, const Shader& oitShader, const Shader& compositeShader,
+	WeightedOit& oit, const uint32_t cubeVAO, const uint32_t quadVAO, const uint32_t tex1, const uint32_t tex2, const uint32_t tex3) {
+	// The opaque pass draws straight to the window
+	GLState::bindFramebuffer(0);
+	GLState::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -190,11 +222,8 @@ void render(const Shader& lightingShader, Shader& blendShader, const uint32_t cu
 	lightingShader.set("material.specular", 1);
 	lightingShader.set("material.shininess", 32.0f);
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, tex1);
-
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, tex2);
+	GLState::bindTexture(0, tex1);
+	GLState::bindTexture(1, tex2);
 
 	// View matix
 	glm::mat4 view = camera.getViewMatrix();
@@ -216,7 +245,7 @@ void render(const Shader& lightingShader, Shader& blendShader, const uint32_t cu
 	glm::mat3 normalMat = glm::inverse(glm::transpose(glm::mat3(model)));
 	lightingShader.set("normalMat", normalMat);
 
-	glBindVertexArray(quadVAO);
+	GLState::bindVertexArray(quadVAO);
 	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 
 	/* 3 CUBE */
@@ -231,7 +260,7 @@ void render(const Shader& lightingShader, Shader& blendShader, const uint32_t cu
 	normalMat = glm::inverse(glm::transpose(glm::mat3(model)));
 	lightingShader.set("normalMat", normalMat);
 
-	glBindVertexArray(cubeVAO);
+	GLState::bindVertexArray(cubeVAO);
 	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
 
 	// Model matrix 2
@@ -244,7 +273,7 @@ void render(const Shader& lightingShader, Shader& blendShader, const uint32_t cu
 	normalMat = glm::inverse(glm::transpose(glm::mat3(model)));
 	lightingShader.set("normalMat", normalMat);
 
-	glBindVertexArray(cubeVAO);
+	GLState::bindVertexArray(cubeVAO);
 	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
 
 	// Model matrix 3
@@ -257,31 +286,46 @@ void render(const Shader& lightingShader, Shader& blendShader, const uint32_t cu
 	normalMat = glm::inverse(glm::transpose(glm::mat3(model)));
 	lightingShader.set("normalMat", normalMat);
 
-	glBindVertexArray(cubeVAO);
+	GLState::bindVertexArray(cubeVAO);
 	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
 
-	/* TREE QUAD*/
-
-	blendShader.use();
-	blendShader.set("view", view);
-	blendShader.set("proj", proj);
-
-	// Model matrix
-	glm::mat4 model_tree = glm::mat4(1.0f);	// Identity
-	model_tree = glm::translate(model_tree, glm::vec3(0.0f, 0.2f, 1.4f)); // IF 1.2f: Z-Fighting (cube and tree same z)
-	model_tree = glm::scale(model_tree, glm::vec3(0.3f, 0.3f, 0.3f));
-	model_tree = glm::rotate(model_tree, glm::pi<float>()/2.0f, glm::vec3(1.0f, 0.0f, 0.0f));
-	blendShader.set("model", model_tree);
-
-	blendShader.set("tex", 0);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, tex3);
-
-	glBindVertexArray(quadVAO);
-	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-	   	 
-	glBindVertexArray(0); // No need to unbind it every time
-
+	/* TREE QUADS */
+
+	const Shader& treeShader = transparencyMode == TransparencyMode::Sorted ? blendShader : oitShader;
+	treeShader.use();
+	treeShader.set("view", view);
+	treeShader.set("proj", proj);
+	treeShader.set("tex", 0);
+
+	// Read by the queue at flush
+	const uint32_t treeTextures[] = { tex3 };
+	if (transparencyMode == TransparencyMode::Sorted) {
+		renderQueue.begin(view);
+	} else {
+		oit.resize(screen_width, screen_height);
+		oit.begin(0);
+	}
+	for (const glm::vec3& position : treePositions) {
+		// Model matrix
+		glm::mat4 model_tree = glm::mat4(1.0f);	// Identity
+		model_tree = glm::translate(model_tree, position);
+		model_tree = glm::scale(model_tree, glm::vec3(0.3f, 0.3f, 0.3f));
+		model_tree = glm::rotate(model_tree, glm::pi<float>()/2.0f, glm::vec3(1.0f, 0.0f, 0.0f));
+
+		if (transparencyMode == TransparencyMode::Sorted) {
+			renderQueue.submit(quadVAO, 6, treeTextures, 1, treeShader, model_tree, RenderPass::Transparent);
+		} else {
+			treeShader.set("model", model_tree);
+			GLState::bindTexture(0, tex3);
+			GLState::bindVertexArray(quadVAO);
+			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+		}
+	}
+	if (transparencyMode == TransparencyMode::Sorted) {
+		renderQueue.flush();
+	} else {
+		oit.composite(compositeShader, 0);
+	}
 }
 
 int main(int args, char* argv[]) {
@@ -373,34 +417,38 @@ int main(int args, char* argv[]) {
 	uint32_t tex2 = createTexture("../tests/AG10_03/specular.png");
 	uint32_t tex3 = createTextureAlpha("../tests/AG10_03/tree.png");
 
-	Shader lightingShader("../tests/AG10_03/cube.vs", "../tests/AG10_03/cube.fs");
-	Shader blendShader("../tests/AG10_03/blend.vs", "../tests/AG10_03/blend.fs");
+	{
+		Shader lightingShader("../tests/AG10_03/cube.vs", "../tests/AG10_03/cube.fs");
+		Shader blendShader("../tests/AG10_03/blend.vs", "../tests/AG10_03/blend.fs");
+		Shader oitShader("../tests/AG10_03/blend.vs", "../tests/AG10_03/blend_oit.fs");
+		Shader compositeShader("../tests/AG10_03/oit.vs", "../tests/AG10_03/oit.fs");
+		WeightedOit oit(screen_width, screen_height);
 
-	glEnable(GL_CULL_FACE);
-	glCullFace(GL_BACK);
+		GLState::enable(GL_CULL_FACE);
+		GLState::cullFace(GL_BACK);
 
-	glDepthFunc(GL_LESS); // Depth Testing
-	glEnable(GL_DEPTH_TEST); // Depth Testing
+		GLState::depthFunc(GL_LESS); // Depth Testing
+		GLState::enable(GL_DEPTH_TEST); // Depth Testing
 
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		GLState::enable(GL_BLEND);
 
-	while (!glfwWindowShouldClose(window)) { // Loop until user closes window
-		float currentFrame = glfwGetTime();
-		float deltaTime = currentFrame - lastFrame;
-		lastFrame = currentFrame;
+		while (!glfwWindowShouldClose(window)) { // Loop until user closes window
+			float currentFrame = glfwGetTime();
+			float deltaTime = currentFrame - lastFrame;
+			lastFrame = currentFrame;
 
-		handlerInput(window, deltaTime);
+			handlerInput(window, deltaTime);
 		
-		render(lightingShader, blendShader, cubeVAO, quadVAO, tex1, tex2, tex3); // Paint
+			render(lightingShader, blendShader, oitShader, compositeShader, oit, cubeVAO, quadVAO, tex1, tex2, tex3); // Paint
 		
-		glfwSwapBuffers(window); // Swap front and back buffers
+			glfwSwapBuffers(window); // Swap front and back buffers
 		
-		glfwPollEvents(); // Poll for and process events
-	}
+			glfwPollEvents(); // Poll for and process events
+		}
 
-	glDeleteVertexArrays(1, &cubeVAO); // Deallocate resuorces
-	glDeleteVertexArrays(1, &quadVAO); // Deallocate resuorces
+		glDeleteVertexArrays(1, &cubeVAO); // Deallocate resuorces
+		glDeleteVertexArrays(1, &quadVAO); // Deallocate resuorces
+	}
 
 	glfwTerminate(); // Close
 	return 0; // Ends OK
@@ -0,0 +1,18 @@
+#version 330 core
+out vec4 fragColor;
+
+uniform sampler2D accumulation;
+uniform sampler2D weights;
+
+void main() {
+	ivec2 texel = ivec2(gl_FragCoord.xy);
+	vec4 accum = texelFetch(accumulation, texel, 0);
+	float revealage = accum.a;
+	if (revealage >= 1.0) { // Nothing transparent here
+		discard;
+	}
+
+	// Weighted average of the surfaces, blended over by how much they cover
+	float weight = max(texelFetch(weights, texel, 0).r, 1e-5);
+	fragColor = vec4(accum.rgb / weight, revealage);
+}
\ No newline at end of file
@@ -7,8 +7,12 @@
 
 #include <iostream>
 #include <cstdint>
+#include <memory>
 #include "shader.h"
 #include "camera.h"
+#include "gl_state.h"
+#include "post_process.h"
+#include "render_graph.h"
 
 #include <stb_image.h>
 
@@ -25,11 +29,15 @@ Camera camera(glm::vec3(-1.0f, 2.0f, 6.0f));
 
 glm::vec3 lightPos(1.2f, 1.0f, -2.0f);
 
+// Post process preset, chosen with the number keys
+uint32_t preset = 1;
+bool presetChanged = true;
+
 void onChangeframeBufferSize(GLFWwindow* window, const int32_t width,
 	const int32_t height) {
 	screen_width = width;
 	screen_height = height;
-	glViewport(0, 0, width, height);
+	GLState::viewport(0, 0, width, height);
 }
 
 void handlerInput(GLFWwindow* window, const float dt) {
@@ -48,6 +56,12 @@ void handlerInput(GLFWwindow* window, const float dt) {
 	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
 		camera.handleKeyboard(Camera::Movement::Right, dt);
 	}
+	for (uint32_t key = 1; key <= 4; key++) {
+		if (glfwGetKey(window, GLFW_KEY_0 + key) == GLFW_PRESS && preset != key) {
+			preset = key;
+			presetChanged = true;
+		}
+	}
 }
 
 void onScroll(GLFWwindow* window, double xoffset, double yoffset) {
@@ -136,43 +150,55 @@ uint32_t createTexture(const char* path) {
 	return texture;
 }
 
-std::pair<uint32_t, uint32_t> createFBO() {
-	uint32_t fbo;
-	glGenFramebuffers(1, &fbo);
-	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+// 1: edge detection, 2: sharpen, 3: half resolution blur, 4: blur with grayscale fused into
+// the last blur pass, then edge detection with vignette, the three passes let targets alias
+void setupPostProcess(PostProcessChain* chain) {
+	const float edges[9] = {
+		1.0f,  1.0f, 1.0f,
+		1.0f, -8.0f, 1.0f,
+		1.0f,  1.0f, 1.0f
+	};
+	const float sharpen[9] = {
+		-1.0f, -1.0f, -1.0f,
+		-1.0f,  9.0f, -1.0f,
+		-1.0f, -1.0f, -1.0f
+	};
 
-	// Texture attached to Frame Buffer
-	uint32_t textureColor;
-	glGenFramebuffers(1, &textureColor);
-	glBindTexture(GL_TEXTURE_2D, textureColor);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, screen_width, screen_height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureColor, 0);
-
-	// RenderBuffer attached to FBO
-	uint32_t rbo;
-	glGenRenderbuffers(1, &rbo);
-	glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, screen_width, screen_height);
-	glBindRenderbuffer(GL_RENDERBUFFER, 0);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rbo);
-
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-		std::cout << "Error FrameBuffer Not Complete" << std::endl;
+	chain->clear();
+	uint32_t vignette = 0;
+	switch (preset) {
+	case 1:
+		chain->addKernel(edges);
+		break;
+	case 2:
+		chain->addKernel(sharpen);
+		break;
+	case 3:
+		chain->addGaussian(6, 3.0f, 0.5f);
+		break;
+	case 4:
+		chain->addGaussian(4, 2.0f);
+		chain->addPixel("	color.rgb = vec3(dot(color.rgb, vec3(0.2126, 0.7152, 0.0722)));");
+		chain->addKernel(edges);
+		vignette = chain->addPixel(
+			"	vec2 centered = gl_FragCoord.xy / outputSize - 0.5;\n"
+			"	color.rgb *= 1.0 - vignetteStrength * dot(centered, centered);",
+			"uniform float vignetteStrength;");
+		break;
+	}
+	chain->build();
+
+	if (preset == 4) {
+		chain->effectShader(vignette).use();
+		chain->effectShader(vignette).set("vignetteStrength", 1.5f);
 	}
-	
-	return std::make_pair(fbo, textureColor);
 }
 
-void render(const Shader& lightingShader, const Shader& fboShader, const uint32_t cubeVAO, const uint32_t quadVAO, const uint32_t quadScreenVAO,
-	const uint32_t tex1, const uint32_t tex2, const uint32_t fbo, const uint32_t tex_fbo) {
-	
-	// 1ST PASS _______________________________________________________
+void render(const Shader& lightingShader, const uint32_t cubeVAO, const uint32_t quadVAO,
+	const uint32_t tex1, const uint32_t tex2) {
 
-	glEnable(GL_DEPTH_TEST);
-	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	// Only what changed since the last frame reaches GL
+	GLState::enable(GL_DEPTH_TEST);
 
 	glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -197,11 +223,8 @@ void render(const Shader& lightingShader, const Shader& fboShader, const uint32_
 	lightingShader.set("material.diffuse", 0);
 	lightingShader.set("material.specular", 1);
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, tex1);
-
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, tex2);
+	GLState::bindTexture(0, tex1);
+	GLState::bindTexture(1, tex2);
 
 	// View matix
 	glm::mat4 view = camera.getViewMatrix();
@@ -223,7 +246,7 @@ void render(const Shader& lightingShader, const Shader& fboShader, const uint32_
 	glm::mat3 normalMat = glm::inverse(glm::transpose(glm::mat3(model)));
 	lightingShader.set("normalMat", normalMat);
 
-	glBindVertexArray(quadVAO);
+	GLState::bindVertexArray(quadVAO);
 	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 
 	/* 3 CUBE */
@@ -238,7 +261,7 @@ void render(const Shader& lightingShader, const Shader& fboShader, const uint32_
 	normalMat = glm::inverse(glm::transpose(glm::mat3(model)));
 	lightingShader.set("normalMat", normalMat);
 
-	glBindVertexArray(cubeVAO);
+	GLState::bindVertexArray(cubeVAO);
 	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
 
 	// Model matrix 2
@@ -251,7 +274,7 @@ void render(const Shader& lightingShader, const Shader& fboShader, const uint32_
 	normalMat = glm::inverse(glm::transpose(glm::mat3(model)));
 	lightingShader.set("normalMat", normalMat);
 
-	glBindVertexArray(cubeVAO);
+	GLState::bindVertexArray(cubeVAO);
 	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
 
 	// Model matrix 3
@@ -264,32 +287,31 @@ void render(const Shader& lightingShader, const Shader& fboShader, const uint32_
 	normalMat = glm::inverse(glm::transpose(glm::mat3(model)));
 	lightingShader.set("normalMat", normalMat);
 
-	glBindVertexArray(cubeVAO);
+	GLState::bindVertexArray(cubeVAO);
 	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+}
 
-	glBindVertexArray(0); // No need to unbind it every time
-
-	// 2ND PASS _______________________________________________________
-
-	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	glDisable(GL_DEPTH_TEST); // 2D quad
-
-	glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-	glClear(GL_COLOR_BUFFER_BIT);
-
-	fboShader.use();
-
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, tex_fbo);
-	fboShader.set("screenTexture", 0);
-
-	glBindVertexArray(quadScreenVAO);
-	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-
-	//glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-
-	glBindVertexArray(0); // No need to unbind it every time
+// The scene is drawn into targets of the graph, each post process pass writes a target
+// of its own and the last the screen. Rebuilt when the chain changes, its passes do
+std::unique_ptr<RenderGraph> createFrameGraph(const Shader& lightingShader, PostProcessChain* chain,
+	const uint32_t cubeVAO, const uint32_t quadVAO, const uint32_t tex1, const uint32_t tex2) {
+	std::unique_ptr<RenderGraph> graph(new RenderGraph(screen_width, screen_height));
+	const uint32_t sceneColor = graph->addTarget("sceneColor", GL_RGBA8);
+	const uint32_t sceneDepth = graph->addTarget("sceneDepth", GL_DEPTH_COMPONENT24);
+
+	const uint32_t scenePass = graph->addPass("scene", [&lightingShader, cubeVAO, quadVAO, tex1, tex2](const RenderGraph&) {
+		render(lightingShader, cubeVAO, quadVAO, tex1, tex2);
+	});
+	graph->write(scenePass, sceneColor);
+	graph->write(scenePass, sceneDepth);
+	chain->addToGraph(graph.get(), sceneColor);
+
+	graph->compile();
+	const RenderGraphStats& frame = graph->stats();
+	std::cout << "Render Graph Passes " << frame.passes << ", Culled " << frame.culled << ", Targets " << frame.targets
+		<< " In " << frame.textures << " Textures, " << frame.bytes / 1024 << " KB (Unaliased "
+		<< frame.unaliasedBytes / 1024 << " KB)" << std::endl;
+	return graph;
 }
 
 int main(int args, char* argv[]) {
@@ -325,105 +347,107 @@ int main(int args, char* argv[]) {
 	glDepthFunc(GL_LESS);
 	glEnable(GL_DEPTH_TEST);
 
-	Shader lightingShader("../tests/AG12/cube.vs", "../tests/AG12/cube.fs");
-	Shader fboShader("../tests/AG12/fbo.vs", "../tests/AG12/fbo.fs");
-
-	float cube_vertices[] = {
-		// Position				// Normals				// UVs		
-		-0.5f, -0.5f, 0.5f,		0.0f, 0.0f, 1.0f,		0.0f, 0.0f,	// Front
-		0.5f, -0.5f, 0.5f,		0.0f, 0.0f, 1.0f,		1.0f, 0.0f,
-		0.5f, 0.5f, 0.5f,		0.0f, 0.0f, 1.0f,		1.0f, 1.0f,
-		-0.5f, 0.5f, 0.5f,		0.0f, 0.0f, 1.0f,		0.0f, 1.0f,
-
-		0.5f, -0.5f, 0.5f,		1.0f, 0.0f, 0.0f,		0.0f, 0.0f,	// Right
-		0.5f, -0.5f, -0.5f,		1.0f, 0.0f, 0.0f,		1.0f, 0.0f,
-		0.5f, 0.5f, -0.5f,		1.0f, 0.0f, 0.0f,		1.0f, 1.0f,
-		0.5f, 0.5f, 0.5f,		1.0f, 0.0f, 0.0f,		0.0f, 1.0f,
-
-		-0.5f, -0.5f, -0.5f,	0.0f, 0.0f, -1.0f, 		1.0f, 0.0f,	// Back
-		-0.5f, 0.5f, -0.5f,		0.0f, 0.0f, -1.0f,		1.0f, 1.0f,
-		0.5f, 0.5f, -0.5f,		0.0f, 0.0f, -1.0f,		0.0f, 1.0f,
-		0.5f, -0.5f, -0.5f,		0.0f, 0.0f, -1.0f,		0.0f, 0.0f,
-
-		-0.5f, -0.5f, 0.5f,		-1.0f, 0.0f, 0.0f, 		1.0f, 0.0f,	// Left
-		-0.5f, 0.5f, 0.5f,		-1.0f, 0.0f, 0.0f,		1.0f, 1.0f,
-		-0.5f, 0.5f, -0.5f,		-1.0f, 0.0f, 0.0f,		0.0f, 1.0f,
-		-0.5f, -0.5f, -0.5f,	-1.0f, 0.0f, 0.0f,		0.0f, 0.0f,
-
-		-0.5f, -0.5f, 0.5f,		0.0f, -1.0f, 0.0f, 		0.0f, 1.0f,	// Bottom
-		-0.5f, -0.5f, -0.5f,	0.0f, -1.0f, 0.0f,		0.0f, 0.0f,
-		0.5f, -0.5f, -0.5f,		0.0f, -1.0f, 0.0f,		1.0f, 0.0f,
-		0.5f, -0.5f, 0.5f,		0.0f, -1.0f, 0.0f,		1.0f, 1.0f,
-
-		-0.5f, 0.5f, 0.5f,		0.0f, 1.0f, 0.0f,		0.0f, 0.0f,	// Top
-		0.5f, 0.5f, 0.5f,		0.0f, 1.0f, 0.0f,		1.0f, 0.0f,
-		0.5f, 0.5f, -0.5f,		0.0f, 1.0f, 0.0f,		1.0f, 1.0f,
-		-0.5f, 0.5f, -0.5f,		0.0f, 1.0f, 0.0f,		0.0f, 1.0f,
-	};
-
-	uint32_t cube_indices[] = {
-		0, 1, 2,		0, 2, 3,	// Front
-		4, 5, 6,		4, 6, 7,	// Right
-		8, 9, 10,		8, 10, 11,	// Back
-		12, 13, 14,		12, 14, 15, // Left
-		16, 17, 18,		16, 18, 19, // Bottom
-		20, 21, 22,		20, 22, 23	// Top
-	};
-
-	/* Floor */
-	float quad_vertices[] = {
-		// Position				// Colors				// Texture
-		-0.5f, 0.0f,  0.5f,		0.0f, 1.0f, 0.0f,		0.0f, 0.0f,	// top
-		 0.5f, 0.0f,  0.5f,		0.0f, 1.0f, 0.0f,		1.0f, 0.0f,	
-		 0.5f, 0.0f, -0.5f,		0.0f, 1.0f, 0.0f,		1.0f, 1.0f,	
-		-0.5f, 0.0f, -0.5f,		0.0f, 1.0f, 0.0f,		0.0f, 1.0f	
-	};
-
-	uint32_t quad_indices[] = {
-		0,1,2,
-		0,2,3
-	};
-
-	/* Screen */
-	float quad_screen_vertices[] = {
-		// Position				// Colors				// Texture
-		-1.0f,  1.0f, 0.0f,		0.0f, 0.0f, 1.0f,		0.0f, 1.0f, // top
-		-1.0f, -1.0f, 0.0f,		0.0f, 0.0f, 1.0f,		0.0f, 0.0f,
-		 1.0f, -1.0f, 0.0f,		0.0f, 0.0f, 1.0f,		1.0f, 0.0f,
-		 1.0f,  1.0f, 0.0f,		0.0f, 0.0f, 1.0f,		1.0f, 1.0f
-	};
-
-	uint32_t quad_screen_indices[] = {
-		0,1,2,
-		0,2,3
-	};
-
-	uint32_t cubeVAO = createVertexData(cube_vertices, 24, cube_indices, 36);
-	uint32_t quadVAO = createVertexData(quad_vertices, 4, quad_indices, 6);
-	uint32_t quadScreenVAO = createVertexData(quad_screen_vertices, 4, quad_screen_indices, 6);
-
-	uint32_t tex1 = createTexture("../tests/AG12/albedo.png");
-	uint32_t tex2 = createTexture("../tests/AG12/specular.png");
-
-	auto fbo_res = createFBO();
-
-	while (!glfwWindowShouldClose(window)) { // Loop until user closes window
-		float currentFrame = glfwGetTime();
-		float deltaTime = currentFrame - lastFrame;
-		lastFrame = currentFrame;
-
-		handlerInput(window, deltaTime);
+	{
+		Shader lightingShader("../tests/AG12/cube.vs", "../tests/AG12/cube.fs");
+
+		float cube_vertices[] = {
+			// Position				// Normals				// UVs		
+			-0.5f, -0.5f, 0.5f,		0.0f, 0.0f, 1.0f,		0.0f, 0.0f,	// Front
+			0.5f, -0.5f, 0.5f,		0.0f, 0.0f, 1.0f,		1.0f, 0.0f,
+			0.5f, 0.5f, 0.5f,		0.0f, 0.0f, 1.0f,		1.0f, 1.0f,
+			-0.5f, 0.5f, 0.5f,		0.0f, 0.0f, 1.0f,		0.0f, 1.0f,
+
+			0.5f, -0.5f, 0.5f,		1.0f, 0.0f, 0.0f,		0.0f, 0.0f,	// Right
+			0.5f, -0.5f, -0.5f,		1.0f, 0.0f, 0.0f,		1.0f, 0.0f,
+			0.5f, 0.5f, -0.5f,		1.0f, 0.0f, 0.0f,		1.0f, 1.0f,
+			0.5f, 0.5f, 0.5f,		1.0f, 0.0f, 0.0f,		0.0f, 1.0f,
+
+			-0.5f, -0.5f, -0.5f,	0.0f, 0.0f, -1.0f, 		1.0f, 0.0f,	// Back
+			-0.5f, 0.5f, -0.5f,		0.0f, 0.0f, -1.0f,		1.0f, 1.0f,
+			0.5f, 0.5f, -0.5f,		0.0f, 0.0f, -1.0f,		0.0f, 1.0f,
+			0.5f, -0.5f, -0.5f,		0.0f, 0.0f, -1.0f,		0.0f, 0.0f,
+
+			-0.5f, -0.5f, 0.5f,		-1.0f, 0.0f, 0.0f, 		1.0f, 0.0f,	// Left
+			-0.5f, 0.5f, 0.5f,		-1.0f, 0.0f, 0.0f,		1.0f, 1.0f,
+			-0.5f, 0.5f, -0.5f,		-1.0f, 0.0f, 0.0f,		0.0f, 1.0f,
+			-0.5f, -0.5f, -0.5f,	-1.0f, 0.0f, 0.0f,		0.0f, 0.0f,
+
+			-0.5f, -0.5f, 0.5f,		0.0f, -1.0f, 0.0f, 		0.0f, 1.0f,	// Bottom
+			-0.5f, -0.5f, -0.5f,	0.0f, -1.0f, 0.0f,		0.0f, 0.0f,
+			0.5f, -0.5f, -0.5f,		0.0f, -1.0f, 0.0f,		1.0f, 0.0f,
+			0.5f, -0.5f, 0.5f,		0.0f, -1.0f, 0.0f,		1.0f, 1.0f,
+
+			-0.5f, 0.5f, 0.5f,		0.0f, 1.0f, 0.0f,		0.0f, 0.0f,	// Top
+			0.5f, 0.5f, 0.5f,		0.0f, 1.0f, 0.0f,		1.0f, 0.0f,
+			0.5f, 0.5f, -0.5f,		0.0f, 1.0f, 0.0f,		1.0f, 1.0f,
+			-0.5f, 0.5f, -0.5f,		0.0f, 1.0f, 0.0f,		0.0f, 1.0f,
+		};
+
+		uint32_t cube_indices[] = {
+			0, 1, 2,		0, 2, 3,	// Front
+			4, 5, 6,		4, 6, 7,	// Right
+			8, 9, 10,		8, 10, 11,	// Back
+			12, 13, 14,		12, 14, 15, // Left
+			16, 17, 18,		16, 18, 19, // Bottom
+			20, 21, 22,		20, 22, 23	// Top
+		};
+
+		/* Floor */
+		float quad_vertices[] = {
+			// Position				// Colors				// Texture
+			-0.5f, 0.0f,  0.5f,		0.0f, 1.0f, 0.0f,		0.0f, 0.0f,	// top
+			 0.5f, 0.0f,  0.5f,		0.0f, 1.0f, 0.0f,		1.0f, 0.0f,	
+			 0.5f, 0.0f, -0.5f,		0.0f, 1.0f, 0.0f,		1.0f, 1.0f,	
+			-0.5f, 0.0f, -0.5f,		0.0f, 1.0f, 0.0f,		0.0f, 1.0f	
+		};
+
+		uint32_t quad_indices[] = {
+			0,1,2,
+			0,2,3
+		};
+
+		uint32_t cubeVAO = createVertexData(cube_vertices, 24, cube_indices, 36);
+		uint32_t quadVAO = createVertexData(quad_vertices, 4, quad_indices, 6);
+
+		uint32_t tex1 = createTexture("../tests/AG12/albedo.png");
+		uint32_t tex2 = createTexture("../tests/AG12/specular.png");
+
+		PostProcessChain chain(screen_width, screen_height);
+		std::unique_ptr<RenderGraph> graph;
+
+		float lastStats = 0.0f;
+		while (!glfwWindowShouldClose(window)) { // Loop until user closes window
+			float currentFrame = glfwGetTime();
+			float deltaTime = currentFrame - lastFrame;
+			lastFrame = currentFrame;
+
+			handlerInput(window, deltaTime);
+			if (presetChanged) {
+				setupPostProcess(&chain);
+				graph = createFrameGraph(lightingShader, &chain, cubeVAO, quadVAO, tex1, tex2);
+				presetChanged = false;
+			}
+			// Minimized windows report a size of 0
+			if (screen_width && screen_height && (screen_width != graph->width() || screen_height != graph->height())) {
+				graph->resize(screen_width, screen_height);
+			}
 		
-		render(lightingShader, fboShader, cubeVAO, quadVAO, quadScreenVAO, tex1, tex2, fbo_res.first, fbo_res.second); // Paint
+			GLState::resetStats();
+			graph->execute(); // Paint
+			if (currentFrame - lastStats > 2.0f) {
+				const GLStateStats& state = GLState::stats();
+				std::cout << "GL State Calls " << state.calls << ", Filtered " << state.filtered << std::endl;
+				lastStats = currentFrame;
+			}
 		
-		glfwSwapBuffers(window); // Swap front and back buffers
+			glfwSwapBuffers(window); // Swap front and back buffers
 		
-		glfwPollEvents(); // Poll for and process events
-	}
+			glfwPollEvents(); // Poll for and process events
+		}
 
-	glDeleteVertexArrays(1, &cubeVAO); // Deallocate resuorces
-	glDeleteVertexArrays(1, &quadVAO); // Deallocate resuorces
-	glDeleteVertexArrays(1, &quadScreenVAO); // Deallocate resuorces
+		glDeleteVertexArrays(1, &cubeVAO); // Deallocate resuorces
+		glDeleteVertexArrays(1, &quadVAO); // Deallocate resuorces
+	}
 
 	glfwTerminate(); // Close
 	return 0; // Ends OK
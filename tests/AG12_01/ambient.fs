@@ -0,0 +1,17 @@
+#version 330 core
+out vec4 fragColor;
+
+// Set by DeferredRenderer
+uniform sampler2D gAlbedoSpec;
+uniform sampler2D gDepth;
+uniform vec2 screenSize;
+
+uniform vec3 ambient;
+
+void main(){
+	vec2 uv = gl_FragCoord.xy / screenSize;
+	// Nothing was drawn there, the clear color stays
+	if (texture(gDepth, uv).r == 1.0)
+		discard;
+	fragColor = vec4(ambient * texture(gAlbedoSpec, uv).rgb, 1.0);
+}
\ No newline at end of file
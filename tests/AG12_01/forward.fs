@@ -0,0 +1,57 @@
+#version 330 core
+out vec4 fragColor;
+
+in vec3 normal;
+in vec3 fragPos;
+in vec2 texCoords;
+
+struct Material {
+	sampler2D diffuse;
+	sampler2D specular;
+	float shininess;
+};
+uniform Material material;
+
+// Every light, 4 texels each: a PointLightData with the radius in the padding
+uniform samplerBuffer lights;
+uniform int numLights;
+uniform vec3 ambient;
+uniform vec3 viewPos;
+
+vec3 calcPointLight(int index, vec3 norm, vec3 fragPos, vec3 viewDir, vec3 albedo, float specularMap){
+	vec4 positionConstant = texelFetch(lights, index * 4);
+	vec4 ambientLinear = texelFetch(lights, index * 4 + 1);
+	vec4 diffuseQuadratic = texelFetch(lights, index * 4 + 2);
+	vec4 specularRadius = texelFetch(lights, index * 4 + 3);
+
+	float distance = length(positionConstant.xyz - fragPos);
+	if (distance > specularRadius.w)
+		return vec3(0.0);
+	float attenuation = 1.0 / (positionConstant.w + 
+						ambientLinear.w * distance + 
+						diffuseQuadratic.w * (distance * distance));
+
+	vec3 lightDir = normalize(positionConstant.xyz - fragPos);
+	float diff = max(dot(norm, lightDir), 0.0);
+	vec3 diffuse = diff * albedo * diffuseQuadratic.rgb;
+	
+	vec3 reflectDir = reflect(-lightDir, norm);
+	float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+	vec3 specular = spec * specularMap * specularRadius.rgb;
+	
+	return (ambientLinear.rgb * albedo + diffuse + specular) * attenuation;
+}
+
+void main(){
+	vec3 norm = normalize(normal);
+	vec3 viewDir = normalize(viewPos - fragPos);
+	vec3 albedo = texture(material.diffuse, texCoords).rgb;
+	float specularMap = texture(material.specular, texCoords).r;
+
+	// Every fragment drawn pays for every light, hidden ones too
+	vec3 color = ambient * albedo;
+	for (int i = 0; i < numLights; ++i)
+		color += calcPointLight(i, norm, fragPos, viewDir, albedo, specularMap);
+
+	fragColor = vec4(color, 1.0);
+}
\ No newline at end of file
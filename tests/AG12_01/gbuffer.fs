@@ -0,0 +1,27 @@
+#version 330 core
+// Read back by DeferredRenderer's lighting passes
+layout (location = 0) out vec4 albedoSpec;
+layout (location = 1) out vec2 encodedNormal;
+
+in vec3 normal;
+in vec3 fragPos;
+in vec2 texCoords;
+
+struct Material {
+	sampler2D diffuse;
+	sampler2D specular;
+	float shininess;
+};
+uniform Material material;
+
+// Folds the unit octahedron onto a square, 2 values keep the whole sphere of directions
+vec2 encodeNormal(vec3 n) {
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 folded = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return (n.z >= 0.0 ? n.xy : folded) * 0.5 + 0.5;
+}
+
+void main(){
+	albedoSpec = vec4(texture(material.diffuse, texCoords).rgb, texture(material.specular, texCoords).r);
+	encodedNormal = encodeNormal(normalize(normal));
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#version 330 core
+out vec4 fragColor;
+
+flat in vec4 positionConstant;
+flat in vec4 ambientLinear;
+flat in vec4 diffuseQuadratic;
+flat in vec4 specularRadius;
+
+// Set by DeferredRenderer
+uniform sampler2D gAlbedoSpec;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+uniform mat4 invViewProj;
+uniform vec2 screenSize;
+
+uniform vec3 viewPos;
+uniform float shininess;
+
+vec3 decodeNormal(vec2 encoded) {
+	encoded = encoded * 2.0 - 1.0;
+	vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float fold = max(-n.z, 0.0);
+	n.xy += vec2(n.x >= 0.0 ? -fold : fold, n.y >= 0.0 ? -fold : fold);
+	return normalize(n);
+}
+
+void main(){
+	vec2 uv = gl_FragCoord.xy / screenSize;
+	// World position back from the depth
+	vec4 position = invViewProj * vec4(vec3(uv, texture(gDepth, uv).r) * 2.0 - 1.0, 1.0);
+	vec3 fragPos = position.xyz / position.w;
+
+	float distance = length(positionConstant.xyz - fragPos);
+	if (distance > specularRadius.w)
+		discard;
+	float attenuation = 1.0 / (positionConstant.w + 
+						ambientLinear.w * distance + 
+						diffuseQuadratic.w * (distance * distance));
+
+	vec4 albedoSpec = texture(gAlbedoSpec, uv);
+	vec3 norm = decodeNormal(texture(gNormal, uv).rg);
+	vec3 viewDir = normalize(viewPos - fragPos);
+
+	vec3 lightDir = normalize(positionConstant.xyz - fragPos);
+	float diff = max(dot(norm, lightDir), 0.0);
+	vec3 diffuse = diff * albedoSpec.rgb * diffuseQuadratic.rgb;
+	
+	vec3 reflectDir = reflect(-lightDir, norm);
+	float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+	vec3 specular = spec * albedoSpec.a * specularRadius.rgb;
+	
+	fragColor = vec4((ambientLinear.rgb * albedoSpec.rgb + diffuse + specular) * attenuation, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+// The light of the instance, a PointLightData with the radius in the padding
+layout (location = 1) in vec4 aPositionConstant;
+layout (location = 2) in vec4 aAmbientLinear;
+layout (location = 3) in vec4 aDiffuseQuadratic;
+layout (location = 4) in vec4 aSpecularRadius;
+
+uniform mat4 viewProj;
+
+flat out vec4 positionConstant;
+flat out vec4 ambientLinear;
+flat out vec4 diffuseQuadratic;
+flat out vec4 specularRadius;
+
+void main() {
+	positionConstant = aPositionConstant;
+	ambientLinear = aAmbientLinear;
+	diffuseQuadratic = aDiffuseQuadratic;
+	specularRadius = aSpecularRadius;
+	gl_Position = viewProj * vec4(aPositionConstant.xyz + aPos * aSpecularRadius.w, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,349 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <iostream>
+#include <cstdint>
+#include <vector>
+#include "clustered_lights.h"
+#include "deferred_renderer.h"
+#include "frame_uniforms.h"
+#include "gl_state.h"
+#include "instance_renderer.h"
+#include "shader.h"
+
+#include <stb_image.h>
+
+// Lights stacked layers of cubes with growing numbers of point lights, once forward
+// with every fragment looping over every light and once deferred with light volumes
+// over a G-buffer, both into the same color and depth FBO. Forward pays for
+// fragments x lights, hidden fragments included, deferred for the pixels each light covers.
+
+const uint32_t k_LightCounts[] = { 16, 128, 1024, 4096 };
+const uint32_t k_GridSize = 32;
+const uint32_t k_Layers = 4;
+const uint32_t k_WarmupFrames = 5;
+const uint32_t k_Frames = 30;
+const uint32_t k_Width = 800;
+const uint32_t k_Height = 600;
+const glm::vec3 k_Ambient(0.05f, 0.05f, 0.05f);
+const float k_Shininess = 32.0f;
+
+struct Result {
+	double ms;	// Per frame, until the GPU is done
+	uint32_t lights;	// Drawn
+};
+
+struct Scene {
+	uint32_t VAO;
+	uint32_t textures[2];
+	glm::mat4 view;
+	glm::mat4 proj;
+	glm::vec3 viewPos;
+};
+
+uint32_t createVertexData() {	// Create VAO that compiles everything
+	float vertices[] = {
+		// Position				// UVs			// Normals
+		-0.5f, -0.5f, 0.5f,		0.0f, 0.0f,		0.0f, 0.0f, 1.0f, //Front
+		0.5f, -0.5f, 0.5f,		1.0f, 0.0f,		0.0f, 0.0f, 1.0f,
+		0.5f, 0.5f, 0.5f,		1.0f, 1.0f,		0.0f, 0.0f, 1.0f,
+		-0.5f, 0.5f, 0.5f,		0.0f, 1.0f,		0.0f, 0.0f, 1.0f,
+
+		0.5f, -0.5f, 0.5f,		0.0f, 0.0f,		1.0f, 0.0f, 0.0f,//Right
+		0.5f, -0.5f, -0.5f,		1.0f, 0.0f,		1.0f, 0.0f, 0.0f,
+		0.5f, 0.5f, -0.5f,		1.0f, 1.0f,		1.0f, 0.0f, 0.0f,
+		0.5f, 0.5f, 0.5f,		0.0f, 1.0f,		1.0f, 0.0f, 0.0f,
+
+		-0.5f, -0.5f, -0.5f,	1.0f, 0.0f,		0.0f, 0.0f, -1.0f,//Back
+		-0.5f, 0.5f, -0.5f,		1.0f, 1.0f,		0.0f, 0.0f, -1.0f,
+		0.5f, 0.5f, -0.5f,		0.0f, 1.0f,		0.0f, 0.0f, -1.0f,
+		0.5f, -0.5f, -0.5f,		0.0f, 0.0f,		0.0f, 0.0f, -1.0f,
+
+		-0.5f, -0.5f, 0.5f,		1.0f, 0.0f,		-1.0f, 0.0f, 0.0f,//Left
+		-0.5f, 0.5f, 0.5f,		1.0f, 1.0f,		-1.0f, 0.0f, 0.0f,
+		-0.5f, 0.5f, -0.5f,		0.0f, 1.0f,		-1.0f, 0.0f, 0.0f,
+		-0.5f, -0.5f, -0.5f,	0.0f, 0.0f,		-1.0f, 0.0f, 0.0f,
+
+		-0.5f, -0.5f, 0.5f,		0.0f, 1.0f,		0.0f, -1.0f, 0.0f,//Bottom
+		-0.5f, -0.5f, -0.5f,	0.0f, 0.0f,		0.0f, -1.0f, 0.0f,
+		0.5f, -0.5f, -0.5f,		1.0f, 0.0f,		0.0f, -1.0f, 0.0f,
+		0.5f, -0.5f, 0.5f,		1.0f, 1.0f,		0.0f, -1.0f, 0.0f,
+
+		-0.5f, 0.5f, 0.5f,		0.0f, 0.0f,		0.0f, 1.0f, 0.0f,//Top
+		0.5f, 0.5f, 0.5f,		1.0f, 0.0f,		0.0f, 1.0f, 0.0f,
+		0.5f, 0.5f, -0.5f,		1.0f, 1.0f,		0.0f, 1.0f, 0.0f,
+		-0.5f, 0.5f, -0.5f,		0.0f, 1.0f,		0.0f, 1.0f, 0.0f,
+	};
+	uint32_t indices[] = {
+		0, 1, 2,		0, 2, 3,	//Front
+		4, 5, 6,		4, 6, 7,	//Right
+		8, 9, 10,		8, 10, 11,	//Back
+		12, 13, 14,		12, 14, 15, //Left
+		16, 17, 18,		16, 18, 19, //Bottom
+		20, 21, 22,		20, 22, 23	//Top
+	};
+
+	uint32_t VAO, VBO, EBO;
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glGenBuffers(1, &EBO);
+
+	GLState::bindVertexArray(VAO);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);	// 3 + 2 + 3 vertex stride
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(5 * sizeof(float)));
+	glEnableVertexAttribArray(2);
+	GLState::bindVertexArray(0);
+
+	return VAO;
+}
+
+uint32_t createTexture(const char* path) {
+	uint32_t texture;
+	glGenTextures(1, &texture);
+	GLState::bindTexture(0, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	stbi_set_flip_vertically_on_load(true);
+	int width, height, nChannels;
+	unsigned char* data = stbi_load(path, &width, &height, &nChannels, 0);
+	if (data) {
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+	else {
+		std::cout << "Failed To Load Texture " << path << std::endl;
+	}
+	stbi_image_free(data);
+
+	return texture;
+}
+
+// Color texture and DEPTH_COMPONENT24 renderbuffer of the window's size
+uint32_t createFBO() {
+	uint32_t fbo;
+	glGenFramebuffers(1, &fbo);
+	GLState::bindFramebuffer(fbo);
+
+	uint32_t textureColor;
+	glGenTextures(1, &textureColor);
+	GLState::bindTexture(0, textureColor);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, k_Width, k_Height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureColor, 0);
+
+	uint32_t rbo;
+	glGenRenderbuffers(1, &rbo);
+	glBindRenderbuffer(GL_RENDERBUFFER, rbo);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, k_Width, k_Height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rbo);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cout << "Error FrameBuffer Not Complete" << std::endl;
+	}
+
+	return fbo;
+}
+
+// Small colored lights scattered through the layers, the radius goes in the padding
+std::vector<PointLightData> createLights(const uint32_t count) {
+	std::vector<PointLightData> lights(count);
+	for (uint32_t i = 0; i < count; i++) {
+		const float phase = i * 0.61f;
+		PointLightData& light = lights[i];
+		light.position = glm::vec3(((i * 37) % 997) / 997.0f * k_GridSize - k_GridSize * 0.5f,
+			((i * 13) % 101) / 101.0f * k_Layers * 1.5f, -(float)((i * 101) % 991) / 991.0f * k_GridSize);
+		const glm::vec3 color(0.5f + 0.5f * sinf(phase), 0.5f + 0.5f * sinf(phase + 2.1f), 0.5f + 0.5f * sinf(phase + 4.2f));
+		light.ambient = color * 0.01f;
+		light.diffuse = color * 0.15f;
+		light.specular = color * 0.05f;
+		light.constant = 1.0f;
+		light.linear = 2.0f;
+		light.quadratic = 8.0f;
+		light.padding = ClusteredLights::lightRadius(light);
+	}
+	return lights;
+}
+
+// Layers drawn far to near, so every hidden fragment is shaded before being covered
+void addCubes(InstanceRenderer* instances, const Scene& scene) {
+	instances->begin();
+	for (uint32_t z = 0; z < k_GridSize; z++) {
+		for (uint32_t layer = 0; layer < k_Layers; layer++) {
+			for (uint32_t x = 0; x < k_GridSize; x++) {
+				const glm::vec3 position(x - k_GridSize * 0.5f, layer * 1.5f, -(float)(k_GridSize - 1 - z));
+				instances->add(scene.VAO, 36, scene.textures, 2, glm::translate(glm::mat4(1.0f), position));
+			}
+		}
+	}
+}
+
+void setMaterial(const Shader& shader, const Scene& scene) {
+	shader.use();
+	shader.set("view", scene.view);
+	shader.set("proj", scene.proj);
+	shader.set("material.diffuse", 0);
+	shader.set("material.specular", 1);
+	shader.set("material.shininess", k_Shininess);
+}
+
+// Every fragment loops over all the lights, read from a buffer texture
+Result drawForward(const Shader& shader, const Scene& scene, const std::vector<PointLightData>& lights,
+	const uint32_t fbo, InstanceRenderer* instances) {
+	uint32_t buffer, texture;
+	glGenBuffers(1, &buffer);
+	GLState::bindBuffer(GL_TEXTURE_BUFFER, buffer);
+	glBufferData(GL_TEXTURE_BUFFER, lights.size() * sizeof(PointLightData), lights.data(), GL_STATIC_DRAW);
+	glGenTextures(1, &texture);
+	GLState::bindTexture(2, texture, GL_TEXTURE_BUFFER);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+
+	setMaterial(shader, scene);
+	shader.set("lights", 2);
+	shader.set("numLights", static_cast<int>(lights.size()));
+	shader.set("ambient", k_Ambient);
+	shader.set("viewPos", scene.viewPos);
+
+	double start = 0.0;
+	for (uint32_t frame = 0; frame < k_WarmupFrames + k_Frames; frame++) {
+		if (frame == k_WarmupFrames) {
+			glFinish();
+			start = glfwGetTime();
+		}
+		GLState::bindFramebuffer(fbo);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		addCubes(instances, scene);
+		instances->flush(shader);
+	}
+	glFinish();
+	const double ms = (glfwGetTime() - start) * 1000.0 / k_Frames;
+
+	GLState::forgetTexture(texture);
+	GLState::forgetBuffer(buffer);
+	glDeleteTextures(1, &texture);
+	glDeleteBuffers(1, &buffer);
+	return Result{ ms, static_cast<uint32_t>(lights.size()) };
+}
+
+// Geometry once into the G-buffer, then one volume per light in view
+Result drawDeferred(const Shader& geometry, const Shader& ambient, const Shader& volume, const Scene& scene,
+	const std::vector<PointLightData>& lights, const uint32_t fbo, InstanceRenderer* instances,
+	DeferredRenderer* deferred) {
+	setMaterial(geometry, scene);
+	ambient.use();
+	ambient.set("ambient", k_Ambient);
+	volume.use();
+	volume.set("viewPos", scene.viewPos);
+	volume.set("shininess", k_Shininess);
+
+	double start = 0.0;
+	for (uint32_t frame = 0; frame < k_WarmupFrames + k_Frames; frame++) {
+		if (frame == k_WarmupFrames) {
+			glFinish();
+			start = glfwGetTime();
+		}
+		deferred->beginGeometry();
+		addCubes(instances, scene);
+		instances->flush(geometry);
+
+		GLState::bindFramebuffer(fbo);
+		glClear(GL_COLOR_BUFFER_BIT);
+		deferred->beginLighting(fbo, scene.view, scene.proj);
+		deferred->drawFullScreen(ambient);
+		deferred->drawLights(volume, lights.data(), static_cast<uint32_t>(lights.size()));
+		deferred->endLighting();
+	}
+	glFinish();
+	return Result{ (glfwGetTime() - start) * 1000.0 / k_Frames, deferred->stats().lights };
+}
+
+void present(const uint32_t fbo) {
+	GLState::bindFramebuffer(0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+	glBlitFramebuffer(0, 0, k_Width, k_Height, 0, 0, k_Width, k_Height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+int main(int args, char* argv[]) {
+	if (!glfwInit()) {	// Initialize GLFW
+		std::cout << "Failed To Initialize GLFW" << std::endl;
+		return -1;
+	}
+
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);	// Use OpenGL 3.3
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);	// Core Profile
+	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);	// The targets keep the window size
+
+	GLFWwindow* window = glfwCreateWindow(k_Width, k_Height, "AG12_01", NULL, NULL);
+	if (!window) {
+		std::cout << "Failed To Create GLFW Window" << std::endl;
+		glfwTerminate();
+		return -1;
+	}
+
+	glfwMakeContextCurrent(window);	// Make the window's context current
+	glfwSwapInterval(0);	// Time the draws, not the display
+
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) { 	// Init GLAD
+		std::cout << "Failed To Initialize GLAD" << std::endl;
+		return -1;
+	}
+
+	{
+		Shader forward("../tests/AG12_01/scene.vs", "../tests/AG12_01/forward.fs");
+		Shader geometry("../tests/AG12_01/scene.vs", "../tests/AG12_01/gbuffer.fs");
+		Shader ambient("../tests/AG10_03/oit.vs", "../tests/AG12_01/ambient.fs");
+		Shader volume("../tests/AG12_01/light_volume.vs", "../tests/AG12_01/light_volume.fs");
+
+		Scene scene;
+		scene.VAO = createVertexData();
+		scene.textures[0] = createTexture("../tests/AG12/albedo.png");
+		scene.textures[1] = createTexture("../tests/AG12/specular.png");
+		scene.viewPos = glm::vec3(0.0f, 9.0f, 6.0f);
+		scene.view = glm::lookAt(scene.viewPos, glm::vec3(0.0f, 0.0f, -0.5f * k_GridSize), glm::vec3(0.0f, 1.0f, 0.0f));
+		scene.proj = glm::perspective(glm::radians(45.0f), (float)k_Width / k_Height, 0.1f, 100.0f);
+
+		const uint32_t fbo = createFBO();
+		InstanceRenderer instances;
+		DeferredRenderer deferred(k_Width, k_Height);
+
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		GLState::enable(GL_CULL_FACE);
+		GLState::cullFace(GL_BACK);
+		GLState::enable(GL_DEPTH_TEST);
+		GLState::depthFunc(GL_LESS);
+
+		std::cout << "Cubes " << k_GridSize * k_GridSize * k_Layers << std::endl;
+		for (const uint32_t count : k_LightCounts) {
+			const std::vector<PointLightData> lights = createLights(count);
+			const Result loop = drawForward(forward, scene, lights, fbo, &instances);
+			const Result volumes = drawDeferred(geometry, ambient, volume, scene, lights, fbo, &instances, &deferred);
+			present(fbo);
+			glfwSwapBuffers(window);
+			std::cout << "Lights " << count <<
+				", Forward " << loop.ms << " ms" <<
+				", Deferred " << volumes.lights << " volumes " << volumes.ms << " ms (" <<
+				loop.ms / volumes.ms << "x)" << std::endl;
+			glfwPollEvents();
+		}
+	}
+
+	glfwTerminate(); // Close
+	return 0; //Ends OK
+}
@@ -0,0 +1,20 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec3 aNormal;
+// Model matrix of the instance, streamed by InstanceRenderer
+layout (location = 5) in mat4 instanceModel;
+
+uniform mat4 view;
+uniform mat4 proj;
+
+out vec3 normal;
+out vec3 fragPos;
+out vec2 texCoords;
+
+void main() {
+	normal = transpose(inverse(mat3(instanceModel))) * aNormal;
+	fragPos = vec3(instanceModel * vec4(aPos, 1.0));
+	texCoords = aTexCoord;
+	gl_Position = proj * view * vec4(fragPos, 1.0);
+}
\ No newline at end of file